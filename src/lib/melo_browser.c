@@ -235,6 +235,23 @@ melo_browser_get_list (MeloBrowser *browser, const gchar *path, gint offset,
                            tags_fields);
 }
 
+gboolean
+melo_browser_write_list (MeloBrowser *browser, const gchar *path, gint offset,
+                         gint count, const gchar *token,
+                         MeloBrowserTagsMode tags_mode,
+                         MeloTagsFields tags_fields, MeloBrowserList *list,
+                         MeloBrowserListWriter *writer)
+{
+  MeloBrowserClass *bclass = MELO_BROWSER_GET_CLASS (browser);
+
+  /* Not supported */
+  if (!bclass->write_list)
+    return FALSE;
+
+  return bclass->write_list (browser, path, offset, count, token, tags_mode,
+                             tags_fields, list, writer);
+}
+
 MeloBrowserList *
 melo_browser_search (MeloBrowser *browser, const gchar *input, gint offset,
                      gint count, const gchar *token,
@@ -42,6 +42,7 @@ typedef struct _MeloBrowserPrivate MeloBrowserPrivate;
 typedef struct _MeloBrowserInfo MeloBrowserInfo;
 typedef struct _MeloBrowserList MeloBrowserList;
 typedef struct _MeloBrowserItem MeloBrowserItem;
+typedef struct _MeloBrowserListWriter MeloBrowserListWriter;
 
 typedef enum _MeloBrowserTagsMode MeloBrowserTagsMode;
 
@@ -64,6 +65,11 @@ struct _MeloBrowserClass {
                                 gint offset, gint count, const gchar *token,
                                 MeloBrowserTagsMode tags_mode,
                                 MeloTagsFields tags_fields);
+  gboolean (*write_list) (MeloBrowser *browser, const gchar *path,
+                          gint offset, gint count, const gchar *token,
+                          MeloBrowserTagsMode tags_mode,
+                          MeloTagsFields tags_fields, MeloBrowserList *list,
+                          MeloBrowserListWriter *writer);
   MeloBrowserList *(*search) (MeloBrowser *browser, const gchar *input,
                               gint offset, gint count, const gchar *token,
                               MeloBrowserTagsMode tags_mode,
@@ -141,6 +147,16 @@ MeloBrowserList *melo_browser_get_list (MeloBrowser *browser, const gchar *path,
                                         const gchar *token,
                                         MeloBrowserTagsMode tags_mode,
                                         MeloTagsFields tags_fields);
+/* Write list items directly with a list writer, without MeloBrowserItem: list
+ * count and tokens are set in list. FALSE is returned when not supported for
+ * this path and melo_browser_get_list() should be used.
+ */
+gboolean melo_browser_write_list (MeloBrowser *browser, const gchar *path,
+                                  gint offset, gint count, const gchar *token,
+                                  MeloBrowserTagsMode tags_mode,
+                                  MeloTagsFields tags_fields,
+                                  MeloBrowserList *list,
+                                  MeloBrowserListWriter *writer);
 MeloBrowserList *melo_browser_search (MeloBrowser *browser, const gchar *input,
                                       gint offset, gint count,
                                       const gchar *token,
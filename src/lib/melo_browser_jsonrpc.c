@@ -38,6 +38,14 @@ typedef enum {
    MELO_BROWSER_JSONRPC_LIST_FIELDS_TYPE | \
    MELO_BROWSER_JSONRPC_LIST_FIELDS_CMDS)
 
+/* List writer: items are written in their own buffer since list count and
+ * tokens, written before items, are only known at end of listing.
+ */
+struct _MeloBrowserListWriter {
+  MeloJSONWriter *items;
+  MeloBrowserJSONRPCListFields fields;
+};
+
 typedef enum {
   MELO_BROWSER_JSONRPC_TAGS_NONE = 0,
   MELO_BROWSER_JSONRPC_TAGS_NONE_CACHED,
@@ -201,53 +209,81 @@ melo_browser_jsonrpc_get_list_fields (JsonObject *obj)
   return fields;
 }
 
-JsonObject *
-melo_browser_jsonrpc_list_to_object (const MeloBrowserList *list,
-                                     MeloBrowserJSONRPCListFields fields,
-                                     MeloTagsFields tags_fields)
+MeloJSONWriter *
+melo_browser_list_writer_add_item (MeloBrowserListWriter *writer,
+                                   const gchar *name, const gchar *full_name,
+                                   const gchar *type, const gchar *add,
+                                   const gchar *remove)
 {
-  JsonArray *array;
-  JsonObject *object;
-  const GList *l;
+  MeloBrowserJSONRPCListFields fields = writer->fields;
+  MeloJSONWriter *w = writer->items;
+
+  /* Write item */
+  melo_json_writer_begin_object (w);
+  if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_NAME) {
+    melo_json_writer_member (w, "name");
+    melo_json_writer_string (w, name);
+  }
+  if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_FULL_NAME) {
+    melo_json_writer_member (w, "full_name");
+    melo_json_writer_string (w, full_name);
+  }
+  if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_TYPE) {
+    melo_json_writer_member (w, "type");
+    melo_json_writer_string (w, type);
+  }
+  if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_CMDS) {
+    melo_json_writer_member (w, "add");
+    melo_json_writer_string (w, add);
+    melo_json_writer_member (w, "remove");
+    melo_json_writer_string (w, remove);
+  }
 
-  /* Create object */
-  object = json_object_new ();
-  if (!object)
+  /* Tags value is written by caller */
+  if (!(fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_TAGS))
     return NULL;
+  melo_json_writer_member (w, "tags");
 
-  /* Add list properties */
-  json_object_set_string_member (object, "path", list->path);
-  json_object_set_int_member (object, "count", list->count);
-  json_object_set_string_member (object, "prev_token", list->prev_token);
-  json_object_set_string_member (object, "next_token", list->next_token);
+  return w;
+}
+
+MeloJSONWriter *
+melo_browser_list_writer_add_member (MeloBrowserListWriter *writer,
+                                     const gchar *name)
+{
+  melo_json_writer_member (writer->items, name);
+  return writer->items;
+}
+
+void
+melo_browser_list_writer_end_item (MeloBrowserListWriter *writer)
+{
+  melo_json_writer_end_object (writer->items);
+}
+
+static void
+melo_browser_jsonrpc_write_items (MeloBrowserListWriter *writer,
+                                  const MeloBrowserList *list,
+                                  MeloTagsFields tags_fields)
+{
+  MeloJSONWriter *w;
+  const GList *l;
 
-  /* Parse list and create array */
-  array = json_array_new ();
+  /* Write items of list */
   for (l = list->items; l != NULL; l = l->next) {
     MeloBrowserItem *item = (MeloBrowserItem *) l->data;
-    JsonObject *obj = json_object_new ();
-    if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_NAME)
-      json_object_set_string_member (obj, "name", item->name);
-    if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_FULL_NAME)
-      json_object_set_string_member (obj, "full_name", item->full_name);
-    if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_TYPE)
-      json_object_set_string_member (obj, "type", item->type);
-    if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_CMDS) {
-      json_object_set_string_member (obj, "add", item->add);
-      json_object_set_string_member (obj, "remove", item->remove);
-    }
-    if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_TAGS) {
-      if (item->tags) {
-        JsonObject *tags = melo_tags_to_json_object (item->tags, tags_fields);
-        json_object_set_object_member (obj, "tags", tags);
-      } else
-        json_object_set_null_member (obj, "tags");
+
+    w = melo_browser_list_writer_add_item (writer, item->name, item->full_name,
+                                           item->type, item->add,
+                                           item->remove);
+    if (w) {
+      if (item->tags)
+        melo_tags_write_json (item->tags, w, tags_fields);
+      else
+        melo_json_writer_null (w);
     }
-    json_array_add_object_element (array, obj);
+    melo_browser_list_writer_end_item (writer);
   }
-  json_object_set_array_member (object, "items", array);
-
-  return object;
 }
 
 static void
@@ -293,7 +329,7 @@ melo_browser_jsonrpc_get_tags_mode (JsonObject *obj, MeloBrowserTagsMode *mode,
 /* Method callbacks */
 static void
 melo_browser_jsonrpc_get_info (const gchar *method,
-                               JsonArray *s_params, JsonNode *params,
+                               MeloJSONRPCSchema *s_params, JsonNode *params,
                                JsonNode **result, JsonNode **error,
                                gpointer user_data)
 {
@@ -330,17 +366,16 @@ melo_browser_jsonrpc_get_info (const gchar *method,
 
 static void
 melo_browser_jsonrpc_get_list (const gchar *method,
-                               JsonArray *s_params, JsonNode *params,
-                               JsonNode **result, JsonNode **error,
+                               MeloJSONRPCSchema *s_params, JsonNode *params,
+                               MeloJSONWriter *result, JsonNode **error,
                                gpointer user_data)
 {
-  MeloBrowserJSONRPCListFields fields;
   MeloBrowserTagsMode tags_mode = MELO_BROWSER_TAGS_MODE_NONE;
   MeloTagsFields tags_fields = MELO_TAGS_FIELDS_NONE;
-  MeloBrowserList *list;
+  MeloBrowserListWriter writer;
+  MeloBrowserList *list = NULL;
   MeloBrowser *bro;
   JsonObject *obj;
-  GList *l;
   const gchar *path, *input;
   const gchar *token = NULL;
   gint offset, count;
@@ -364,7 +399,7 @@ melo_browser_jsonrpc_get_list (const gchar *method,
     path = json_object_get_string_member (obj, "path");
 
   /* Get fields */
-  fields = melo_browser_jsonrpc_get_list_fields (obj);
+  writer.fields = melo_browser_jsonrpc_get_list_fields (obj);
 
   /* Get list position */
   offset = json_object_get_int_member (obj, "offset");
@@ -375,40 +410,71 @@ melo_browser_jsonrpc_get_list (const gchar *method,
     token = json_object_get_string_member (obj, "token");
 
   /* Get tags if needed */
-  if (fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_TAGS)
+  if (writer.fields & MELO_BROWSER_JSONRPC_LIST_FIELDS_TAGS)
     melo_browser_jsonrpc_get_tags_mode (obj, &tags_mode, &tags_fields);
 
+  /* Create items writer, in format of result */
+  writer.items = melo_json_writer_new_full (result->format);
+  melo_json_writer_begin_array (writer.items);
+
+  /* Write browser list directly when supported */
+  if (g_strcmp0 (method, "browser.search")) {
+    list = melo_browser_list_new (path);
+    if (!melo_browser_write_list (bro, path, offset, count, token, tags_mode,
+                                  tags_fields, list, &writer)) {
+      melo_browser_list_free (list);
+      melo_json_writer_reset (writer.items);
+      melo_json_writer_begin_array (writer.items);
+      list = NULL;
+    }
+  }
+
   /* Get browser list */
-  if (!g_strcmp0 (method, "browser.search"))
-    list = melo_browser_search (bro, input, offset, count, token, tags_mode,
-                                tags_fields);
-  else
-    list = melo_browser_get_list (bro, path, offset, count, token, tags_mode,
+  if (!list) {
+    if (!g_strcmp0 (method, "browser.search"))
+      list = melo_browser_search (bro, input, offset, count, token, tags_mode,
                                   tags_fields);
+    else
+      list = melo_browser_get_list (bro, path, offset, count, token, tags_mode,
+                                    tags_fields);
+    if (list)
+      melo_browser_jsonrpc_write_items (&writer, list, tags_fields);
+  }
   json_object_unref (obj);
   g_object_unref (bro);
 
   /* No list provided */
   if (!list) {
+    melo_json_writer_free (writer.items, TRUE);
     *error = melo_jsonrpc_build_error_node (MELO_JSONRPC_ERROR_INVALID_REQUEST,
                                             "Method not available!");
     return;
   }
-
-  /* Create response with item list */
-  obj = melo_browser_jsonrpc_list_to_object (list, fields, tags_fields);
-
-  /* Free browser list */
+  melo_json_writer_end_array (writer.items);
+
+  /* Write response with item list */
+  melo_json_writer_begin_object (result);
+  melo_json_writer_member (result, "path");
+  melo_json_writer_string (result, list->path);
+  melo_json_writer_member (result, "count");
+  melo_json_writer_int (result, list->count);
+  melo_json_writer_member (result, "prev_token");
+  melo_json_writer_string (result, list->prev_token);
+  melo_json_writer_member (result, "next_token");
+  melo_json_writer_string (result, list->next_token);
+  melo_json_writer_member (result, "items");
+  melo_json_writer_raw (result, writer.items->str->str,
+                        writer.items->str->len);
+  melo_json_writer_end_object (result);
+
+  /* Free browser list and items */
+  melo_json_writer_free (writer.items, TRUE);
   melo_browser_list_free (list);
-
-  /* Return object */
-  *result = json_node_new (JSON_NODE_OBJECT);
-  json_node_take_object (*result, obj);
 }
 
 static void
 melo_browser_jsonrpc_search_hint (const gchar *method,
-                                  JsonArray *s_params, JsonNode *params,
+                                  MeloJSONRPCSchema *s_params, JsonNode *params,
                                   JsonNode **result, JsonNode **error,
                                   gpointer user_data)
 {
@@ -449,8 +515,8 @@ melo_browser_jsonrpc_search_hint (const gchar *method,
 
 static void
 melo_browser_jsonrpc_get_tags (const gchar *method,
-                               JsonArray *s_params, JsonNode *params,
-                               JsonNode **result, JsonNode **error,
+                               MeloJSONRPCSchema *s_params, JsonNode *params,
+                               MeloJSONWriter *result, JsonNode **error,
                                gpointer user_data)
 {
   MeloTagsFields fields = MELO_TAGS_FIELDS_FULL;
@@ -488,19 +554,15 @@ melo_browser_jsonrpc_get_tags (const gchar *method,
   json_object_unref (obj);
   g_object_unref (bro);
 
-  /* Parse list and create array */
-  obj = melo_tags_to_json_object (tags, fields);
+  /* Write tags: cover is written as binary data when supported */
+  melo_tags_write_json (tags, result, fields);
   if (tags)
     melo_tags_unref (tags);
-
-  /* Return object */
-  *result = json_node_new (JSON_NODE_OBJECT);
-  json_node_take_object (*result, obj);
 }
 
 static void
 melo_browser_jsonrpc_item_action (const gchar *method,
-                                  JsonArray *s_params, JsonNode *params,
+                                  MeloJSONRPCSchema *s_params, JsonNode *params,
                                   JsonNode **result, JsonNode **error,
                                   gpointer user_data)
 {
@@ -557,6 +619,7 @@ static MeloJSONRPCMethod melo_browser_jsonrpc_methods[] = {
     .result = "{\"type\":\"object\"}",
     .callback = melo_browser_jsonrpc_get_info,
     .user_data = NULL,
+    .concurrent = TRUE,
   },
   {
     .method = "get_list",
@@ -580,7 +643,7 @@ static MeloJSONRPCMethod melo_browser_jsonrpc_methods[] = {
               "  }"
               "]",
     .result = "{\"type\":\"object\"}",
-    .callback = melo_browser_jsonrpc_get_list,
+    .write_callback = melo_browser_jsonrpc_get_list,
     .user_data = NULL,
   },
   {
@@ -605,7 +668,7 @@ static MeloJSONRPCMethod melo_browser_jsonrpc_methods[] = {
               "  }"
               "]",
     .result = "{\"type\":\"object\"}",
-    .callback = melo_browser_jsonrpc_get_list,
+    .write_callback = melo_browser_jsonrpc_get_list,
     .user_data = NULL,
   },
   {
@@ -629,7 +692,7 @@ static MeloJSONRPCMethod melo_browser_jsonrpc_methods[] = {
               "  }"
               "]",
     .result = "{\"type\":\"object\"}",
-    .callback = melo_browser_jsonrpc_get_tags,
+    .write_callback = melo_browser_jsonrpc_get_tags,
     .user_data = NULL,
   },
   {
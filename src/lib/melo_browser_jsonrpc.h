@@ -44,6 +44,25 @@ JsonObject *melo_browser_jsonrpc_info_to_object (
                                            const MeloBrowserInfo *info,
                                            MeloBrowserJSONRPCInfoFields fields);
 
+/* List writer used by melo_browser_write_list(): when tags are requested,
+ * the returned JSON writer must be used to write tags object (or null) of the
+ * item. melo_browser_list_writer_end_item() must be called for each item.
+ */
+MeloJSONWriter *melo_browser_list_writer_add_item (
+                                                MeloBrowserListWriter *writer,
+                                                const gchar *name,
+                                                const gchar *full_name,
+                                                const gchar *type,
+                                                const gchar *add,
+                                                const gchar *remove);
+/* Add an extra member to current item, after its tags: the returned JSON
+ * writer must be used to write the member value.
+ */
+MeloJSONWriter *melo_browser_list_writer_add_member (
+                                                MeloBrowserListWriter *writer,
+                                                const gchar *name);
+void melo_browser_list_writer_end_item (MeloBrowserListWriter *writer);
+
 /* JSON-RPC methods */
 void melo_browser_jsonrpc_register_methods (void);
 void melo_browser_jsonrpc_unregister_methods (void);
@@ -267,7 +267,7 @@ bad_request:
 /* Method callbacks */
 static void
 melo_config_jsonrpc_get (const gchar *method,
-                         JsonArray *s_params, JsonNode *params,
+                         MeloJSONRPCSchema *s_params, JsonNode *params,
                          JsonNode **result, JsonNode **error,
                          gpointer user_data)
 {
@@ -310,7 +310,7 @@ melo_config_jsonrpc_get (const gchar *method,
 
 static void
 melo_config_jsonrpc_set (const gchar *method,
-                         JsonArray *s_params, JsonNode *params,
+                         MeloJSONRPCSchema *s_params, JsonNode *params,
                          JsonNode **result, JsonNode **error,
                          gpointer user_data)
 {
@@ -0,0 +1,478 @@
+/*
+ * melo_json_writer.c: Streaming JSON writer
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "melo_json_writer.h"
+
+/* Initial buffer size: large enough for most responses */
+#define MELO_JSON_WRITER_SIZE 4096
+
+/* MessagePack container being written */
+typedef struct {
+  gsize pos;
+  guint32 count;
+  gboolean map;
+} MeloJSONWriterContainer;
+
+MeloJSONWriter *
+melo_json_writer_new (void)
+{
+  return melo_json_writer_new_full (MELO_JSON_WRITER_FORMAT_JSON);
+}
+
+MeloJSONWriter *
+melo_json_writer_new_full (MeloJSONWriterFormat format)
+{
+  MeloJSONWriter *writer;
+
+  /* Allocate writer */
+  writer = g_slice_new (MeloJSONWriter);
+  writer->str = g_string_sized_new (MELO_JSON_WRITER_SIZE);
+  writer->comma = FALSE;
+  writer->format = format;
+  writer->stack = NULL;
+
+  /* Open containers are only tracked for MessagePack */
+  if (format == MELO_JSON_WRITER_FORMAT_MSGPACK)
+    writer->stack = g_array_new (FALSE, FALSE,
+                                 sizeof (MeloJSONWriterContainer));
+
+  return writer;
+}
+
+void
+melo_json_writer_reset (MeloJSONWriter *writer)
+{
+  /* Keep buffer for next document */
+  g_string_truncate (writer->str, 0);
+  writer->comma = FALSE;
+  if (writer->stack)
+    g_array_set_size (writer->stack, 0);
+}
+
+static void
+melo_json_writer_destroy (MeloJSONWriter *writer)
+{
+  if (writer->stack)
+    g_array_free (writer->stack, TRUE);
+  g_slice_free (MeloJSONWriter, writer);
+}
+
+gchar *
+melo_json_writer_free (MeloJSONWriter *writer, gboolean free_data)
+{
+  gchar *data;
+
+  /* Free writer and return data */
+  data = g_string_free (writer->str, free_data);
+  melo_json_writer_destroy (writer);
+
+  return data;
+}
+
+GBytes *
+melo_json_writer_free_to_bytes (MeloJSONWriter *writer)
+{
+  GBytes *bytes;
+
+  /* Free writer and return data with its length */
+  bytes = g_string_free_to_bytes (writer->str);
+  melo_json_writer_destroy (writer);
+
+  return bytes;
+}
+
+/* MessagePack encoding */
+static void
+melo_json_writer_msgpack_head (GString *str, guint8 type, guint64 value,
+                               guint size)
+{
+  gchar buf[9];
+  guint i;
+
+  /* Write type and big endian value */
+  buf[0] = type;
+  for (i = size; i > 0; i--, value >>= 8)
+    buf[i] = value & 0xff;
+  g_string_append_len (str, buf, size + 1);
+}
+
+static void
+melo_json_writer_msgpack_len (GString *str, guint64 len, guint8 fix,
+                              guint fix_max, guint8 type8, guint8 type16)
+{
+  /* Select smallest header: 32-bit type always follows 16-bit type */
+  if (fix && len <= fix_max)
+    melo_json_writer_msgpack_head (str, fix | len, 0, 0);
+  else if (type8 && len <= G_MAXUINT8)
+    melo_json_writer_msgpack_head (str, type8, len, 1);
+  else if (len <= G_MAXUINT16)
+    melo_json_writer_msgpack_head (str, type16, len, 2);
+  else
+    melo_json_writer_msgpack_head (str, type16 + 1, len, 4);
+}
+
+static void
+melo_json_writer_msgpack_str (GString *str, const gchar *value)
+{
+  gsize len = strlen (value);
+
+  /* Write string */
+  melo_json_writer_msgpack_len (str, len, 0xa0, 31, 0xd9, 0xda);
+  g_string_append_len (str, value, len);
+}
+
+static void
+melo_json_writer_msgpack_count (MeloJSONWriter *writer, gboolean member)
+{
+  MeloJSONWriterContainer *c;
+
+  /* Count map members and array elements of current container */
+  if (!writer->stack->len)
+    return;
+  c = &g_array_index (writer->stack, MeloJSONWriterContainer,
+                      writer->stack->len - 1);
+  if (c->map == member)
+    c->count++;
+}
+
+static void
+melo_json_writer_msgpack_begin (MeloJSONWriter *writer, gboolean map)
+{
+  MeloJSONWriterContainer c;
+
+  /* Reserve a 32-bit length, set when container is ended */
+  melo_json_writer_msgpack_count (writer, FALSE);
+  c.pos = writer->str->len;
+  c.count = 0;
+  c.map = map;
+  g_array_append_val (writer->stack, c);
+  melo_json_writer_msgpack_head (writer->str, map ? 0xdf : 0xdd, 0, 4);
+}
+
+static void
+melo_json_writer_msgpack_end (MeloJSONWriter *writer)
+{
+  MeloJSONWriterContainer *c;
+  gchar *len;
+
+  /* Set length of container */
+  if (!writer->stack->len)
+    return;
+  c = &g_array_index (writer->stack, MeloJSONWriterContainer,
+                      writer->stack->len - 1);
+  len = writer->str->str + c->pos + 1;
+  len[0] = c->count >> 24;
+  len[1] = c->count >> 16;
+  len[2] = c->count >> 8;
+  len[3] = c->count;
+  g_array_set_size (writer->stack, writer->stack->len - 1);
+}
+
+/* JSON encoding */
+static inline void
+melo_json_writer_separator (MeloJSONWriter *writer)
+{
+  /* Count value in MessagePack */
+  if (writer->stack) {
+    melo_json_writer_msgpack_count (writer, FALSE);
+    return;
+  }
+
+  /* Add a separator between two values */
+  if (writer->comma)
+    g_string_append_c (writer->str, ',');
+  writer->comma = TRUE;
+}
+
+static void
+melo_json_writer_append_string (GString *str, const gchar *value)
+{
+  static const gchar hex[] = "0123456789abcdef";
+  const gchar *p, *start;
+
+  /* Escape string: safe characters are appended by runs */
+  g_string_append_c (str, '"');
+  for (p = start = value; *p != '\0'; p++) {
+    guchar c = *p;
+
+    /* Nothing to escape */
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+
+    /* Append previous run and escaped character */
+    g_string_append_len (str, start, p - start);
+    start = p + 1;
+    switch (c) {
+      case '"':
+        g_string_append (str, "\\\"");
+        break;
+      case '\\':
+        g_string_append (str, "\\\\");
+        break;
+      case '\b':
+        g_string_append (str, "\\b");
+        break;
+      case '\f':
+        g_string_append (str, "\\f");
+        break;
+      case '\n':
+        g_string_append (str, "\\n");
+        break;
+      case '\r':
+        g_string_append (str, "\\r");
+        break;
+      case '\t':
+        g_string_append (str, "\\t");
+        break;
+      default:
+        g_string_append (str, "\\u00");
+        g_string_append_c (str, hex[c >> 4]);
+        g_string_append_c (str, hex[c & 0x0f]);
+    }
+  }
+  g_string_append_len (str, start, p - start);
+  g_string_append_c (str, '"');
+}
+
+static inline void
+melo_json_writer_null_value (MeloJSONWriter *writer)
+{
+  if (writer->stack)
+    melo_json_writer_msgpack_head (writer->str, 0xc0, 0, 0);
+  else
+    g_string_append (writer->str, "null");
+}
+
+void
+melo_json_writer_begin_object (MeloJSONWriter *writer)
+{
+  if (writer->stack) {
+    melo_json_writer_msgpack_begin (writer, TRUE);
+    return;
+  }
+  melo_json_writer_separator (writer);
+  g_string_append_c (writer->str, '{');
+  writer->comma = FALSE;
+}
+
+void
+melo_json_writer_end_object (MeloJSONWriter *writer)
+{
+  if (writer->stack) {
+    melo_json_writer_msgpack_end (writer);
+    return;
+  }
+  g_string_append_c (writer->str, '}');
+  writer->comma = TRUE;
+}
+
+void
+melo_json_writer_begin_array (MeloJSONWriter *writer)
+{
+  if (writer->stack) {
+    melo_json_writer_msgpack_begin (writer, FALSE);
+    return;
+  }
+  melo_json_writer_separator (writer);
+  g_string_append_c (writer->str, '[');
+  writer->comma = FALSE;
+}
+
+void
+melo_json_writer_end_array (MeloJSONWriter *writer)
+{
+  if (writer->stack) {
+    melo_json_writer_msgpack_end (writer);
+    return;
+  }
+  g_string_append_c (writer->str, ']');
+  writer->comma = TRUE;
+}
+
+void
+melo_json_writer_member (MeloJSONWriter *writer, const gchar *name)
+{
+  if (writer->stack) {
+    melo_json_writer_msgpack_count (writer, TRUE);
+    melo_json_writer_msgpack_str (writer->str, name);
+    return;
+  }
+  melo_json_writer_separator (writer);
+  melo_json_writer_append_string (writer->str, name);
+  g_string_append_c (writer->str, ':');
+  writer->comma = FALSE;
+}
+
+void
+melo_json_writer_string (MeloJSONWriter *writer, const gchar *value)
+{
+  melo_json_writer_separator (writer);
+  if (!value)
+    melo_json_writer_null_value (writer);
+  else if (writer->stack)
+    melo_json_writer_msgpack_str (writer->str, value);
+  else
+    melo_json_writer_append_string (writer->str, value);
+}
+
+void
+melo_json_writer_int (MeloJSONWriter *writer, gint64 value)
+{
+  melo_json_writer_separator (writer);
+  if (!writer->stack)
+    g_string_append_printf (writer->str, "%" G_GINT64_FORMAT, value);
+  else if (value >= -32 && value <= 0x7f)
+    melo_json_writer_msgpack_head (writer->str, value & 0xff, 0, 0);
+  else if (value >= G_MININT32 && value <= G_MAXINT32)
+    melo_json_writer_msgpack_head (writer->str, 0xd2, (guint32) value, 4);
+  else
+    melo_json_writer_msgpack_head (writer->str, 0xd3, value, 8);
+}
+
+void
+melo_json_writer_double (MeloJSONWriter *writer, gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+  guint64 v;
+
+  /* Write float 64 */
+  melo_json_writer_separator (writer);
+  if (writer->stack) {
+    memcpy (&v, &value, sizeof (v));
+    melo_json_writer_msgpack_head (writer->str, 0xcb, v, 8);
+    return;
+  }
+
+  /* A double is always written with a decimal point or an exponent */
+  g_string_append (writer->str, g_ascii_dtostr (buf, sizeof (buf), value));
+  if (!strpbrk (buf, ".eE"))
+    g_string_append (writer->str, ".0");
+}
+
+void
+melo_json_writer_boolean (MeloJSONWriter *writer, gboolean value)
+{
+  melo_json_writer_separator (writer);
+  if (writer->stack)
+    melo_json_writer_msgpack_head (writer->str, value ? 0xc3 : 0xc2, 0, 0);
+  else
+    g_string_append (writer->str, value ? "true" : "false");
+}
+
+void
+melo_json_writer_null (MeloJSONWriter *writer)
+{
+  melo_json_writer_separator (writer);
+  melo_json_writer_null_value (writer);
+}
+
+void
+melo_json_writer_binary (MeloJSONWriter *writer, const guchar *data,
+                         gsize len)
+{
+  gchar *str;
+
+  /* Write raw data */
+  melo_json_writer_separator (writer);
+  if (writer->stack) {
+    melo_json_writer_msgpack_len (writer->str, len, 0, 0, 0xc4, 0xc5);
+    g_string_append_len (writer->str, (const gchar *) data, len);
+    return;
+  }
+
+  /* Encode in base64 */
+  str = g_base64_encode (data, len);
+  melo_json_writer_append_string (writer->str, str);
+  g_free (str);
+}
+
+void
+melo_json_writer_raw (MeloJSONWriter *writer, const gchar *json, gssize len)
+{
+  melo_json_writer_separator (writer);
+  g_string_append_len (writer->str, json, len);
+}
+
+static void
+melo_json_writer_object (MeloJSONWriter *writer, JsonObject *obj)
+{
+  GList *members, *l;
+
+  /* Write members in insertion order */
+  melo_json_writer_begin_object (writer);
+  members = json_object_get_members (obj);
+  for (l = members; l != NULL; l = l->next) {
+    melo_json_writer_member (writer, l->data);
+    melo_json_writer_node (writer, json_object_get_member (obj, l->data));
+  }
+  g_list_free (members);
+  melo_json_writer_end_object (writer);
+}
+
+static void
+melo_json_writer_array (MeloJSONWriter *writer, JsonArray *array)
+{
+  guint count, i;
+
+  /* Write elements */
+  melo_json_writer_begin_array (writer);
+  count = json_array_get_length (array);
+  for (i = 0; i < count; i++)
+    melo_json_writer_node (writer, json_array_get_element (array, i));
+  melo_json_writer_end_array (writer);
+}
+
+void
+melo_json_writer_node (MeloJSONWriter *writer, JsonNode *node)
+{
+  /* Serialize node */
+  switch (json_node_get_node_type (node)) {
+    case JSON_NODE_OBJECT:
+      melo_json_writer_object (writer, json_node_get_object (node));
+      break;
+    case JSON_NODE_ARRAY:
+      melo_json_writer_array (writer, json_node_get_array (node));
+      break;
+    case JSON_NODE_VALUE:
+      switch (json_node_get_value_type (node)) {
+        case G_TYPE_INT64:
+          melo_json_writer_int (writer, json_node_get_int (node));
+          break;
+        case G_TYPE_DOUBLE:
+          melo_json_writer_double (writer, json_node_get_double (node));
+          break;
+        case G_TYPE_BOOLEAN:
+          melo_json_writer_boolean (writer, json_node_get_boolean (node));
+          break;
+        case G_TYPE_STRING:
+          melo_json_writer_string (writer, json_node_get_string (node));
+          break;
+        default:
+          melo_json_writer_null (writer);
+      }
+      break;
+    case JSON_NODE_NULL:
+    default:
+      melo_json_writer_null (writer);
+  }
+}
@@ -0,0 +1,88 @@
+/*
+ * melo_json_writer.h: Streaming JSON writer
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __MELO_JSON_WRITER_H__
+#define __MELO_JSON_WRITER_H__
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+G_BEGIN_DECLS
+
+/* JSON writer: values are appended to a growable buffer as they come, with
+ * the same compact format as a JsonGenerator. No tree is built, so the writer
+ * is the only allocation, whatever the size of the document.
+ * The same values can be written as MessagePack instead of JSON text: maps and
+ * arrays are then always written with a 32-bit length, which is set when the
+ * container is ended.
+ */
+typedef struct _MeloJSONWriter MeloJSONWriter;
+
+typedef enum {
+  MELO_JSON_WRITER_FORMAT_JSON = 0,
+  MELO_JSON_WRITER_FORMAT_MSGPACK,
+} MeloJSONWriterFormat;
+
+struct _MeloJSONWriter {
+  GString *str;
+  gboolean comma;
+  MeloJSONWriterFormat format;
+  GArray *stack;
+};
+
+MeloJSONWriter *melo_json_writer_new (void);
+MeloJSONWriter *melo_json_writer_new_full (MeloJSONWriterFormat format);
+void melo_json_writer_reset (MeloJSONWriter *writer);
+gchar *melo_json_writer_free (MeloJSONWriter *writer, gboolean free_data);
+GBytes *melo_json_writer_free_to_bytes (MeloJSONWriter *writer);
+
+/* Containers */
+void melo_json_writer_begin_object (MeloJSONWriter *writer);
+void melo_json_writer_end_object (MeloJSONWriter *writer);
+void melo_json_writer_begin_array (MeloJSONWriter *writer);
+void melo_json_writer_end_array (MeloJSONWriter *writer);
+
+/* Object member name: must be followed by a value */
+void melo_json_writer_member (MeloJSONWriter *writer, const gchar *name);
+
+/* Values: a NULL string is written as null */
+void melo_json_writer_string (MeloJSONWriter *writer, const gchar *value);
+void melo_json_writer_int (MeloJSONWriter *writer, gint64 value);
+void melo_json_writer_double (MeloJSONWriter *writer, gdouble value);
+void melo_json_writer_boolean (MeloJSONWriter *writer, gboolean value);
+void melo_json_writer_null (MeloJSONWriter *writer);
+
+/* Binary data: written as a base64 string in JSON and as raw data in
+ * MessagePack
+ */
+void melo_json_writer_binary (MeloJSONWriter *writer, const guchar *data,
+                              gsize len);
+
+/* Insert an already serialized value: it must be in the writer format */
+void melo_json_writer_raw (MeloJSONWriter *writer, const gchar *json,
+                           gssize len);
+
+/* Serialize a JSON node */
+void melo_json_writer_node (MeloJSONWriter *writer, JsonNode *node);
+
+G_END_DECLS
+
+#endif /* __MELO_JSON_WRITER_H__ */
@@ -27,19 +27,95 @@
 #include "config.h"
 #endif
 
+typedef enum {
+  MELO_JSONRPC_TYPE_INVALID = 0,
+  MELO_JSONRPC_TYPE_BOOLEAN,
+  MELO_JSONRPC_TYPE_INT,
+  MELO_JSONRPC_TYPE_DOUBLE,
+  MELO_JSONRPC_TYPE_STRING,
+  MELO_JSONRPC_TYPE_OBJECT,
+  MELO_JSONRPC_TYPE_ARRAY,
+} MeloJSONRPCType;
+
+/* Parameter descriptor */
+typedef struct _MeloJSONRPCParam {
+  gchar *name;
+  MeloJSONRPCType type;
+  gboolean required;
+} MeloJSONRPCParam;
+
+struct _MeloJSONRPCSchema {
+  gint ref_count;
+  /* Descriptor table */
+  MeloJSONRPCParam *params;
+  guint count;
+};
+
 typedef struct _MeloJSONRPCInternalMethod {
   /* Schema nodes */
-  JsonArray *params;
+  MeloJSONRPCSchema *params;
   JsonObject *result;
   /* Callback */
   MeloJSONRPCCallback callback;
+  MeloJSONRPCWriteCallback write_callback;
   gpointer user_data;
+  gboolean concurrent;
 
+  /* Shared between method tables */
+  gint ref_count;
 } MeloJSONRPCInternalMethod;
 
-/* List of groups and methods */
+/* List of groups and methods: the table is never modified once published, a
+ * new table is generated and swapped on (un)registration, with a new
+ * generation number. Each dispatching thread keeps a reference on the last
+ * table it has seen and only takes the mutex to get the new one when the
+ * generation has changed, so look ups don't share any written data and
+ * updates never wait for them. An old table is freed on its last unref.
+ */
 G_LOCK_DEFINE_STATIC (melo_jsonrpc_mutex);
 static GHashTable *melo_jsonrpc_methods = NULL;
+static gint melo_jsonrpc_methods_gen = 0;
+
+typedef struct {
+  GHashTable *methods;
+  gint gen;
+} MeloJSONRPCSnapshot;
+
+static void melo_jsonrpc_snapshot_free (gpointer data);
+static GPrivate melo_jsonrpc_snapshot =
+                                  G_PRIVATE_INIT (melo_jsonrpc_snapshot_free);
+
+/* Batch requests: elements calling a concurrent method are processed in
+ * parallel by the calling thread and at most MELO_JSONRPC_BATCH_CONCURRENCY - 1
+ * threads of a shared pool. Other elements are processed one by one by the
+ * calling thread, before it joins the pool tasks.
+ * The batch is shared with the pool tasks, so it is reference counted: a task
+ * started once all elements are taken only releases its reference, and the
+ * calling thread only waits for the elements, not for the tasks.
+ */
+#define MELO_JSONRPC_BATCH_THREADS 8
+#define MELO_JSONRPC_BATCH_CONCURRENCY 4
+
+typedef struct _MeloJSONRPCBatch {
+  JsonArray *array;
+  guint count;
+  /* Elements processed in parallel */
+  guint *parallel;
+  guint parallel_count;
+  gint next;
+  /* One response per element, in format of final response */
+  MeloJSONWriterFormat format;
+  MeloJSONWriter **writers;
+  gboolean *responses;
+  /* Processed elements */
+  GMutex mutex;
+  GCond cond;
+  guint done;
+  /* Calling thread and pool tasks */
+  gint ref_count;
+} MeloJSONRPCBatch;
+
+static GThreadPool *melo_jsonrpc_batch_pool;
 
 /* Helpers */
 static gchar *melo_jsonrpc_node_to_string (JsonNode *node);
@@ -52,6 +128,106 @@ static JsonNode *melo_jsonrpc_build_response_node (JsonNode *result,
                                                    JsonNode *error,
                                                    const gchar *id,
                                                    gint64 nid);
+static void melo_jsonrpc_write_response (MeloJSONWriter *writer,
+                                         JsonNode *response);
+
+/* Compile parameters schema */
+static MeloJSONRPCSchema *
+melo_jsonrpc_schema_new (JsonArray *array)
+{
+  MeloJSONRPCSchema *schema;
+  guint i;
+
+  /* Allocate schema and descriptor table */
+  schema = g_slice_new (MeloJSONRPCSchema);
+  schema->ref_count = 1;
+  schema->count = json_array_get_length (array);
+  schema->params = g_new0 (MeloJSONRPCParam, schema->count);
+
+  /* Compile each parameter: an invalid entry will never match */
+  for (i = 0; i < schema->count; i++) {
+    MeloJSONRPCParam *param = &schema->params[i];
+    JsonNode *node;
+    JsonObject *obj;
+    const gchar *type = NULL;
+
+    /* Parameter is required by default */
+    param->required = TRUE;
+
+    /* Get schema object */
+    node = json_array_get_element (array, i);
+    if (!node || json_node_get_node_type (node) != JSON_NODE_OBJECT) {
+      param->name = g_strdup ("");
+      continue;
+    }
+    obj = json_node_get_object (node);
+
+    /* Get name and type */
+    if (json_object_has_member (obj, "name"))
+      param->name = g_strdup (json_object_get_string_member (obj, "name"));
+    if (json_object_has_member (obj, "type"))
+      type = json_object_get_string_member (obj, "type");
+    if (!param->name || !type) {
+      g_free (param->name);
+      param->name = g_strdup ("");
+      continue;
+    }
+
+    /* Get type: only first letter of the type string is checked */
+    switch (type[0]) {
+      case 'b':
+        param->type = MELO_JSONRPC_TYPE_BOOLEAN;
+        break;
+      case 'i':
+        param->type = MELO_JSONRPC_TYPE_INT;
+        break;
+      case 'd':
+        param->type = MELO_JSONRPC_TYPE_DOUBLE;
+        break;
+      case 's':
+        param->type = MELO_JSONRPC_TYPE_STRING;
+        break;
+      case 'o':
+        param->type = MELO_JSONRPC_TYPE_OBJECT;
+        break;
+      case 'a':
+        param->type = MELO_JSONRPC_TYPE_ARRAY;
+        break;
+      default:
+        param->type = MELO_JSONRPC_TYPE_INVALID;
+    }
+
+    /* Get required flag */
+    node = json_object_get_member (obj, "required");
+    if (node && !json_node_get_boolean (node))
+      param->required = FALSE;
+  }
+
+  return schema;
+}
+
+static MeloJSONRPCSchema *
+melo_jsonrpc_schema_ref (MeloJSONRPCSchema *schema)
+{
+  g_atomic_int_inc (&schema->ref_count);
+  return schema;
+}
+
+static void
+melo_jsonrpc_schema_unref (MeloJSONRPCSchema *schema)
+{
+  guint i;
+
+  /* Still used */
+  if (!g_atomic_int_dec_and_test (&schema->ref_count))
+    return;
+
+  /* Free descriptor table */
+  for (i = 0; i < schema->count; i++)
+    g_free (schema->params[i].name);
+  g_free (schema->params);
+  g_slice_free (MeloJSONRPCSchema, schema);
+}
 
 /* Register a JSON-RPC method */
 static void
@@ -59,9 +235,13 @@ melo_jsonrpc_free_method (gpointer data)
 {
   MeloJSONRPCInternalMethod *m = data;
 
+  /* Still used by another table */
+  if (!g_atomic_int_dec_and_test (&m->ref_count))
+    return;
+
   /* Free nodes */
   if (m->params)
-    json_array_unref (m->params);
+    melo_jsonrpc_schema_unref (m->params);
   if (m->result)
     json_object_unref (m->result);
 
@@ -69,30 +249,112 @@ melo_jsonrpc_free_method (gpointer data)
   g_slice_free (MeloJSONRPCInternalMethod, m);
 }
 
-gboolean
-melo_jsonrpc_register_method (const gchar *group, const gchar *method,
-                              JsonArray *params, JsonObject *result,
-                              MeloJSONRPCCallback callback,
-                              gpointer user_data)
+static GHashTable *
+melo_jsonrpc_copy_methods (void)
+{
+  MeloJSONRPCInternalMethod *m;
+  GHashTableIter iter;
+  GHashTable *methods;
+  gpointer key;
+
+  /* Create new table */
+  methods = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                   melo_jsonrpc_free_method);
+  if (!melo_jsonrpc_methods)
+    return methods;
+
+  /* Copy current table: methods are shared */
+  g_hash_table_iter_init (&iter, melo_jsonrpc_methods);
+  while (g_hash_table_iter_next (&iter, &key, (gpointer *) &m)) {
+    g_atomic_int_inc (&m->ref_count);
+    g_hash_table_insert (methods, g_strdup (key), m);
+  }
+
+  return methods;
+}
+
+static void
+melo_jsonrpc_publish_methods (GHashTable *methods)
+{
+  GHashTable *old;
+
+  /* An empty table is not kept */
+  if (methods && !g_hash_table_size (methods)) {
+    g_hash_table_unref (methods);
+    methods = NULL;
+  }
+
+  /* Swap tables: threads still using old table keep a reference on it */
+  old = melo_jsonrpc_methods;
+  melo_jsonrpc_methods = methods;
+  g_atomic_int_inc (&melo_jsonrpc_methods_gen);
+  if (old)
+    g_hash_table_unref (old);
+}
+
+static void
+melo_jsonrpc_snapshot_free (gpointer data)
+{
+  MeloJSONRPCSnapshot *snap = data;
+
+  /* Release table of exiting thread */
+  if (snap->methods)
+    g_hash_table_unref (snap->methods);
+  g_slice_free (MeloJSONRPCSnapshot, snap);
+}
+
+static GHashTable *
+melo_jsonrpc_get_methods (void)
+{
+  MeloJSONRPCSnapshot *snap;
+  GHashTable *old;
+
+  /* Get table of current thread */
+  snap = g_private_get (&melo_jsonrpc_snapshot);
+  if (!snap) {
+    snap = g_slice_new (MeloJSONRPCSnapshot);
+    snap->methods = NULL;
+    snap->gen = -1;
+    g_private_set (&melo_jsonrpc_snapshot, snap);
+  }
+
+  /* Table is up to date */
+  if (snap->gen == g_atomic_int_get (&melo_jsonrpc_methods_gen))
+    return snap->methods;
+
+  /* Get a reference on current table */
+  old = snap->methods;
+  G_LOCK (melo_jsonrpc_mutex);
+  snap->methods = melo_jsonrpc_methods ?
+                  g_hash_table_ref (melo_jsonrpc_methods) : NULL;
+  snap->gen = melo_jsonrpc_methods_gen;
+  G_UNLOCK (melo_jsonrpc_mutex);
+  if (old)
+    g_hash_table_unref (old);
+
+  return snap->methods;
+}
+
+static gboolean
+melo_jsonrpc_add_method (const gchar *group, const gchar *method,
+                         MeloJSONRPCSchema *params, JsonObject *result,
+                         MeloJSONRPCCallback callback,
+                         MeloJSONRPCWriteCallback write_callback,
+                         gpointer user_data, gboolean concurrent)
 {
   MeloJSONRPCInternalMethod *m;
   gchar *complete_method;
+  GHashTable *methods;
 
   /* Create complete method */
   complete_method = g_strdup_printf ("%s.%s", group, method);
 
-  /* Lock method list access */
+  /* Lock method list update */
   G_LOCK (melo_jsonrpc_mutex);
 
-  /* Create hash table if not yet created */
-  if (!melo_jsonrpc_methods) {
-    melo_jsonrpc_methods = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                  g_free,
-                                                  melo_jsonrpc_free_method);
-  }
-
   /* Method already exists */
-  if (g_hash_table_lookup (melo_jsonrpc_methods, complete_method))
+  if (melo_jsonrpc_methods &&
+      g_hash_table_lookup (melo_jsonrpc_methods, complete_method))
     goto failed;
 
   /* Create new method handler */
@@ -104,12 +366,17 @@ melo_jsonrpc_register_method (const gchar *group, const gchar *method,
   m->params = params;
   m->result = result;
   m->callback = callback;
+  m->write_callback = write_callback;
   m->user_data = user_data;
+  m->concurrent = concurrent;
+  m->ref_count = 1;
 
-  /* Add method */
-  g_hash_table_insert (melo_jsonrpc_methods, complete_method, m);
+  /* Add method to a new table and publish it */
+  methods = melo_jsonrpc_copy_methods ();
+  g_hash_table_insert (methods, complete_method, m);
+  melo_jsonrpc_publish_methods (methods);
 
-  /* Unlock method list access */
+  /* Unlock method list update */
   G_UNLOCK (melo_jsonrpc_mutex);
 
   return TRUE;
@@ -120,6 +387,33 @@ failed:
   return FALSE;
 }
 
+gboolean
+melo_jsonrpc_register_method (const gchar *group, const gchar *method,
+                              JsonArray *params, JsonObject *result,
+                              MeloJSONRPCCallback callback,
+                              gpointer user_data)
+{
+  MeloJSONRPCSchema *schema = NULL;
+
+  /* Compile parameters schema */
+  if (params)
+    schema = melo_jsonrpc_schema_new (params);
+
+  /* Register method: params and result are kept by caller on failure */
+  if (!melo_jsonrpc_add_method (group, method, schema, result, callback,
+                                NULL, user_data, FALSE)) {
+    if (schema)
+      melo_jsonrpc_schema_unref (schema);
+    return FALSE;
+  }
+
+  /* Parameters are only needed by schema */
+  if (params)
+    json_array_unref (params);
+
+  return TRUE;
+}
+
 void
 melo_jsonrpc_unregister_method (const gchar *group, const gchar *method)
 {
@@ -128,19 +422,20 @@ melo_jsonrpc_unregister_method (const gchar *group, const gchar *method)
   /* Create complete method */
   complete_method = g_strdup_printf ("%s.%s", group, method);
 
-  /* Lock method list access */
+  /* Lock method list update */
   G_LOCK (melo_jsonrpc_mutex);
 
-  /* Remove method */
-  g_hash_table_remove (melo_jsonrpc_methods, complete_method);
+  /* Remove method from a new table and publish it */
+  if (melo_jsonrpc_methods &&
+      g_hash_table_contains (melo_jsonrpc_methods, complete_method)) {
+    GHashTable *methods;
 
-  /* Free hash table if empty */
-  if (!g_hash_table_size (melo_jsonrpc_methods)) {
-    g_hash_table_unref (melo_jsonrpc_methods);
-    melo_jsonrpc_methods = NULL;
+    methods = melo_jsonrpc_copy_methods ();
+    g_hash_table_remove (methods, complete_method);
+    melo_jsonrpc_publish_methods (methods);
   }
 
-  /* Unlock method list access */
+  /* Unlock method list update */
   G_UNLOCK (melo_jsonrpc_mutex);
 
   /* Free complete method */
@@ -154,7 +449,7 @@ melo_jsonrpc_register_methods (const gchar *group, MeloJSONRPCMethod *methods,
 {
   JsonParser *parser;
   JsonObject *result;
-  JsonArray *params;
+  MeloJSONRPCSchema *params;
   JsonNode *node;
   guint errors = 0, i;
   gboolean ret;
@@ -173,8 +468,8 @@ melo_jsonrpc_register_methods (const gchar *group, MeloJSONRPCMethod *methods,
       if (json_node_get_node_type (node) != JSON_NODE_ARRAY)
         continue;
 
-      /* Get array */
-      params = json_node_dup_array (node);
+      /* Compile array */
+      params = melo_jsonrpc_schema_new (json_node_get_array (node));
     } else
       params = NULL;
 
@@ -184,8 +479,11 @@ melo_jsonrpc_register_methods (const gchar *group, MeloJSONRPCMethod *methods,
       node = json_parser_get_root (parser);
 
       /* Node result type must be an object */
-      if (json_node_get_node_type (node) != JSON_NODE_OBJECT)
+      if (json_node_get_node_type (node) != JSON_NODE_OBJECT) {
+        if (params)
+          melo_jsonrpc_schema_unref (params);
         continue;
+      }
 
       /* Get array */
       result = json_node_dup_object (node);
@@ -193,14 +491,16 @@ melo_jsonrpc_register_methods (const gchar *group, MeloJSONRPCMethod *methods,
       result = NULL;
 
     /* Register method */
-    ret = melo_jsonrpc_register_method (group, methods[i].method, params,
-                                        result, methods[i].callback,
-                                        methods[i].user_data);
+    ret = melo_jsonrpc_add_method (group, methods[i].method, params, result,
+                                   methods[i].callback,
+                                   methods[i].write_callback,
+                                   methods[i].user_data,
+                                   methods[i].concurrent);
 
     /* Failed to register method */
     if (!ret) {
       if (params)
-        json_array_unref (params);
+        melo_jsonrpc_schema_unref (params);
       if (result)
         json_object_unref (result);
       errors++;
@@ -225,16 +525,20 @@ melo_jsonrpc_unregister_methods (const gchar *group, MeloJSONRPCMethod *methods,
 }
 
 /* Parse JSON-RPC request */
-static JsonNode *
-melo_jsonrpc_parse_node (JsonNode *node)
+static gboolean
+melo_jsonrpc_parse_node (JsonNode *node, MeloJSONWriter *writer)
 {
   MeloJSONRPCInternalMethod *m;
+  GHashTable *methods;
   MeloJSONRPCCallback callback = NULL;
+  MeloJSONRPCWriteCallback write_callback = NULL;
   gpointer user_data = NULL;
-  JsonArray *s_params = NULL;
+  MeloJSONRPCSchema *s_params = NULL;
+  MeloJSONWriter *res_writer;
   JsonNode *result = NULL;
   JsonNode *error = NULL;
   JsonNode *params;
+  JsonNode *res;
   JsonObject *obj;
   const char *version;
   const char *method;
@@ -279,298 +583,401 @@ melo_jsonrpc_parse_node (JsonNode *node)
       goto invalid;
   }
 
-  /* Get registered method */
-  G_LOCK (melo_jsonrpc_mutex);
-  if (melo_jsonrpc_methods) {
-    m = g_hash_table_lookup (melo_jsonrpc_methods, method);
+  /* Get registered method from table of current thread */
+  methods = melo_jsonrpc_get_methods ();
+  if (methods) {
+    m = g_hash_table_lookup (methods, method);
     if (m) {
       callback = m->callback;
+      write_callback = m->write_callback;
       user_data = m->user_data;
       if (m->params)
-        s_params = json_array_ref (m->params);
+        s_params = melo_jsonrpc_schema_ref (m->params);
     }
   }
-  G_UNLOCK (melo_jsonrpc_mutex);
 
   /* Check if id is present */
   if (!json_object_has_member (obj, "id")) {
     /* This is a notification: try to call callback */
-    if (callback) {
+    if (write_callback) {
+      res_writer = melo_json_writer_new_full (writer->format);
+      write_callback (method, s_params, params, res_writer, &error, user_data);
+      melo_json_writer_free (res_writer, TRUE);
+    } else if (callback)
       callback (method, s_params, params, &result, &error, user_data);
-      if (s_params)
-        json_array_unref (s_params);
-      if (error)
-        json_node_free (error);
-      if (result)
-        json_node_free (result);
-    }
-    return NULL;
+    if (s_params)
+      melo_jsonrpc_schema_unref (s_params);
+    if (error)
+      json_node_free (error);
+    if (result)
+      json_node_free (result);
+    return FALSE;
   }
 
   /* Get id */
   nid = json_object_get_int_member (obj, "id");
   id = json_object_get_string_member (obj, "id");
 
-  /* No callback provided */
-  if (!callback)
-    goto not_found;
-
-  /* Call user callback */
-  callback (method, s_params, params, &result, &error, user_data);
-  if (s_params)
-    json_array_unref (s_params);
+  /* Call user callback writing its result directly */
+  if (write_callback) {
+    res_writer = melo_json_writer_new_full (writer->format);
+    write_callback (method, s_params, params, res_writer, &error, user_data);
+    if (s_params)
+      melo_jsonrpc_schema_unref (s_params);
+
+    /* Write response with result */
+    if (!error && res_writer->str->len) {
+      melo_json_writer_begin_object (writer);
+      melo_json_writer_member (writer, "jsonrpc");
+      melo_json_writer_string (writer, "2.0");
+      melo_json_writer_member (writer, "result");
+      melo_json_writer_raw (writer, res_writer->str->str,
+                            res_writer->str->len);
+      melo_json_writer_member (writer, "id");
+      if (nid < 0 || id)
+        melo_json_writer_string (writer, id);
+      else
+        melo_json_writer_int (writer, nid);
+      melo_json_writer_end_object (writer);
+      melo_json_writer_free (res_writer, TRUE);
+      return TRUE;
+    }
+    melo_json_writer_free (res_writer, TRUE);
+  } else {
+    /* No callback provided */
+    if (!callback)
+      goto not_found;
+
+    /* Call user callback */
+    callback (method, s_params, params, &result, &error, user_data);
+    if (s_params)
+      melo_jsonrpc_schema_unref (s_params);
+  }
 
   /* No error or result */
   if (!error && !result)
     goto not_found;
 
   /* Build response */
-  return melo_jsonrpc_build_response_node (result, error, id, nid);
+  res = melo_jsonrpc_build_response_node (result, error, id, nid);
+  melo_jsonrpc_write_response (writer, res);
+  return TRUE;
 
 invalid:
-  return melo_jsonrpc_build_error (NULL, -1,
-                                        MELO_JSONRPC_ERROR_INVALID_REQUEST,
-                                        "Invalid request");
+  res = melo_jsonrpc_build_error (NULL, -1, MELO_JSONRPC_ERROR_INVALID_REQUEST,
+                                  "Invalid request");
+  melo_jsonrpc_write_response (writer, res);
+  return TRUE;
 not_found:
-  return melo_jsonrpc_build_error (id, nid,
-                                        MELO_JSONRPC_ERROR_METHOD_NOT_FOUND,
-                                        "Method not found");
+  res = melo_jsonrpc_build_error (id, nid, MELO_JSONRPC_ERROR_METHOD_NOT_FOUND,
+                                  "Method not found");
+  melo_jsonrpc_write_response (writer, res);
+  return TRUE;
 internal:
-  return melo_jsonrpc_build_error (id, -1,
-                                        MELO_JSONRPC_ERROR_INTERNAL_ERROR,
-                                        "Internal error");
+  res = melo_jsonrpc_build_error (id, -1, MELO_JSONRPC_ERROR_INTERNAL_ERROR,
+                                  "Internal error");
+  melo_jsonrpc_write_response (writer, res);
+  return TRUE;
 }
 
-gchar *
-melo_jsonrpc_parse_request (const gchar *request, gsize length, GError **eror)
+static void
+melo_jsonrpc_batch_unref (MeloJSONRPCBatch *batch)
+{
+  if (!g_atomic_int_dec_and_test (&batch->ref_count))
+    return;
+
+  /* Free batch: responses have been gathered by the calling thread */
+  json_array_unref (batch->array);
+  g_mutex_clear (&batch->mutex);
+  g_cond_clear (&batch->cond);
+  g_free (batch->responses);
+  g_free (batch->writers);
+  g_free (batch->parallel);
+  g_slice_free (MeloJSONRPCBatch, batch);
+}
+
+static void
+melo_jsonrpc_batch_run (MeloJSONRPCBatch *batch)
+{
+  guint done = 0;
+  gint n, i;
+
+  /* Process next parallel element until end of batch */
+  while ((n = g_atomic_int_add (&batch->next, 1)) < batch->parallel_count) {
+    i = batch->parallel[n];
+    batch->writers[i] = melo_json_writer_new_full (batch->format);
+    batch->responses[i] = melo_jsonrpc_parse_node (
+                                       json_array_get_element (batch->array, i),
+                                       batch->writers[i]);
+    done++;
+  }
+
+  /* Nothing processed: all elements were taken by other threads */
+  if (!done)
+    return;
+
+  /* Signal end of batch */
+  g_mutex_lock (&batch->mutex);
+  batch->done += done;
+  if (batch->done == batch->parallel_count)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->mutex);
+}
+
+static void
+melo_jsonrpc_batch_func (gpointer data, gpointer user_data)
+{
+  MeloJSONRPCBatch *batch = data;
+
+  /* Process remaining elements, if any */
+  melo_jsonrpc_batch_run (batch);
+  melo_jsonrpc_batch_unref (batch);
+}
+
+static guint
+melo_jsonrpc_parse_batch (JsonArray *array, guint count,
+                          MeloJSONWriter *writer)
+{
+  static gsize init = 0;
+  MeloJSONRPCBatch *batch;
+  GHashTable *methods;
+  gboolean *serial;
+  guint res_count = 0, tasks, i;
+
+  /* Create shared pool */
+  if (g_once_init_enter (&init)) {
+    melo_jsonrpc_batch_pool = g_thread_pool_new (melo_jsonrpc_batch_func,
+                                                 NULL,
+                                                 MELO_JSONRPC_BATCH_THREADS,
+                                                 FALSE, NULL);
+    g_once_init_leave (&init, 1);
+  }
+
+  /* Create batch: tasks may outlive the request */
+  batch = g_slice_new0 (MeloJSONRPCBatch);
+  batch->array = json_array_ref (array);
+  batch->count = count;
+  batch->parallel = g_new (guint, count);
+  batch->format = writer->format;
+  batch->writers = g_new0 (MeloJSONWriter *, count);
+  batch->responses = g_new0 (gboolean, count);
+  g_mutex_init (&batch->mutex);
+  g_cond_init (&batch->cond);
+
+  /* Select elements calling a concurrent method */
+  serial = g_new0 (gboolean, count);
+  methods = melo_jsonrpc_get_methods ();
+  for (i = 0; i < count; i++) {
+    MeloJSONRPCInternalMethod *m = NULL;
+    JsonNode *node;
+
+    /* Get method of element */
+    node = json_array_get_element (array, i);
+    if (node && JSON_NODE_HOLDS_OBJECT (node))
+      node = json_object_get_member (json_node_get_object (node), "method");
+    else
+      node = NULL;
+    if (methods && node && JSON_NODE_HOLDS_VALUE (node) &&
+        json_node_get_value_type (node) == G_TYPE_STRING)
+      m = g_hash_table_lookup (methods, json_node_get_string (node));
+
+    /* Add to parallel elements */
+    if (m && m->concurrent)
+      batch->parallel[batch->parallel_count++] = i;
+    else
+      serial[i] = TRUE;
+  }
+
+  /* Push tasks to pool */
+  tasks = batch->parallel_count > 1 ?
+          MIN (batch->parallel_count, MELO_JSONRPC_BATCH_CONCURRENCY) - 1 : 0;
+  batch->ref_count = tasks + 1;
+  for (i = 0; i < tasks; i++)
+    g_thread_pool_push (melo_jsonrpc_batch_pool, batch, NULL);
+
+  /* Process other elements in calling thread, then parallel elements */
+  for (i = 0; i < count; i++) {
+    if (!serial[i])
+      continue;
+    batch->writers[i] = melo_json_writer_new_full (batch->format);
+    batch->responses[i] = melo_jsonrpc_parse_node (
+                                           json_array_get_element (array, i),
+                                           batch->writers[i]);
+  }
+  g_free (serial);
+  melo_jsonrpc_batch_run (batch);
+
+  /* Wait for elements still processed by pool tasks */
+  g_mutex_lock (&batch->mutex);
+  while (batch->done < batch->parallel_count)
+    g_cond_wait (&batch->cond, &batch->mutex);
+  g_mutex_unlock (&batch->mutex);
+
+  /* Gather responses in request order */
+  for (i = 0; i < count; i++) {
+    MeloJSONWriter *w = batch->writers[i];
+
+    if (batch->responses[i]) {
+      melo_json_writer_raw (writer, w->str->str, w->str->len);
+      res_count++;
+    }
+    melo_json_writer_free (w, TRUE);
+  }
+
+  /* Release batch */
+  melo_jsonrpc_batch_unref (batch);
+
+  return res_count;
+}
+
+gboolean
+melo_jsonrpc_parse_request_node (JsonNode *request, MeloJSONWriter *writer)
 {
-  JsonParser *parser;
   JsonNodeType type;
-  JsonNode *req;
   JsonNode *res;
-  GError *err = NULL;
-  gchar *str;
-
-  /* Create parser */
-  parser = json_parser_new ();
-  if (!parser)
-    return melo_jsonrpc_build_error_str (MELO_JSONRPC_ERROR_INTERNAL_ERROR,
-                                         "Internal error");
 
-  /* Parse request */
-  if (!json_parser_load_from_data (parser, request, length, &err) ||
-      (req = json_parser_get_root (parser)) == NULL) {
-    g_clear_error (&err);
-    goto parse_error;
+  /* Request cannot be decoded */
+  if (!request) {
+    res = melo_jsonrpc_build_error (NULL, -1, MELO_JSONRPC_ERROR_PARSE_ERROR,
+                                    "Parse error");
+    melo_jsonrpc_write_response (writer, res);
+    return TRUE;
   }
 
   /* Get node type */
-  type = json_node_get_node_type (req);
+  type = json_node_get_node_type (request);
 
   /* Parse node */
   if (type == JSON_NODE_OBJECT) {
     /* Parse single request */
-    res = melo_jsonrpc_parse_node (req);
+    return melo_jsonrpc_parse_node (request, writer);
   } else if (type == JSON_NODE_ARRAY) {
     /* Parse multiple requests: batch */
     JsonArray *req_array;
-    JsonArray *res_array;
-    JsonNode *node;
-    guint count, i;
+    guint count;
 
     /* Get array from node */
-    req_array = json_node_get_array (req);
+    req_array = json_node_get_array (request);
     count = json_array_get_length (req_array);
     if (!count)
       goto invalid;
 
-    /* Create a new array for response */
-    res_array = json_array_sized_new (count);
-    res = json_node_new (JSON_NODE_ARRAY);
-    json_node_take_array (res, res_array);
-
-    /* Parse each elements of array */
-    for (i = 0; i < count; i++) {
-      /* Get element */
-      node = json_array_get_element (req_array, i);
+    /* Parse each elements of array and add responses to array */
+    melo_json_writer_begin_array (writer);
+    if (!melo_jsonrpc_parse_batch (req_array, count, writer))
+      return FALSE;
+    melo_json_writer_end_array (writer);
+    return TRUE;
+  }
 
-      /* Process requesit */
-      node = melo_jsonrpc_parse_node (node);
+invalid:
+  res = melo_jsonrpc_build_error (NULL, -1, MELO_JSONRPC_ERROR_INVALID_REQUEST,
+                                  "Invalid request");
+  melo_jsonrpc_write_response (writer, res);
+  return TRUE;
+}
 
-      /* Add new response to array */
-      if (node)
-        json_array_add_element (res_array, node);
-    }
+gchar *
+melo_jsonrpc_parse_request (const gchar *request, gsize length, GError **eror)
+{
+  MeloJSONWriter *writer;
+  JsonParser *parser;
+  JsonNode *req;
+  GError *err = NULL;
 
-    /* Check if array is empty */
-    count = json_array_get_length (res_array);
-    if (!count) {
-      json_node_free (res);
-      goto empty;
-    }
-  } else
-    goto invalid;
+  /* Create parser */
+  parser = json_parser_new ();
+  if (!parser)
+    return melo_jsonrpc_build_error_str (MELO_JSONRPC_ERROR_INTERNAL_ERROR,
+                                         "Internal error");
 
-  /* No response */
-  if (!res)
-    goto empty;
+  /* Parse request */
+  if (!json_parser_load_from_data (parser, request, length, &err) ||
+      (req = json_parser_get_root (parser)) == NULL) {
+    g_clear_error (&err);
+    g_object_unref (parser);
+    return melo_jsonrpc_build_error_str (MELO_JSONRPC_ERROR_PARSE_ERROR,
+                                         "Parse error");
+  }
 
-  /* Generate final string */
-  str = melo_jsonrpc_node_to_string (res);
+  /* Responses are written in a single buffer */
+  writer = melo_json_writer_new ();
+  if (!melo_jsonrpc_parse_request_node (req, writer)) {
+    melo_json_writer_free (writer, TRUE);
+    writer = NULL;
+  }
 
-  /* Free parser and root node */
-  json_node_free (res);
+  /* Free parser */
   g_object_unref (parser);
 
-  return str;
-
-parse_error:
-  g_object_unref (parser);
-  return melo_jsonrpc_build_error_str (MELO_JSONRPC_ERROR_PARSE_ERROR,
-                                       "Parse error");
-invalid:
-  g_object_unref (parser);
-  return melo_jsonrpc_build_error_str (MELO_JSONRPC_ERROR_INVALID_REQUEST,
-                                       "Invalid request");
-empty:
-  g_object_unref (parser);
-  return NULL;
+  /* Return final string */
+  return writer ? melo_json_writer_free (writer, FALSE) : NULL;
 }
 
 /* Params utils */
 static gboolean
-melo_jsonrpc_add_node (JsonNode *node, JsonObject *schema,
+melo_jsonrpc_add_node (JsonNode *node, const MeloJSONRPCParam *param,
                        JsonObject *obj, JsonArray *array)
 {
   GType vtype = G_TYPE_INVALID;
-  const gchar *s_name;
-  const gchar *s_type;
   JsonNodeType type;
 
-  /* Get name and type from schema */
-  s_name = json_object_get_string_member (schema, "name");
-  s_type = json_object_get_string_member (schema, "type");
-  if (!s_name || !s_type)
-    return FALSE;
-
   /* Get type */
   type = json_node_get_node_type (node);
   if (type == JSON_NODE_VALUE)
     vtype = json_node_get_value_type (node);
 
-  /* Check type:
-   * We check only first letter of the type string.
-   */
-  switch (s_type[0]) {
-    case 'b':
-      /* Boolean: check type */
+  /* Check type */
+  switch (param->type) {
+    case MELO_JSONRPC_TYPE_BOOLEAN:
       if (vtype != G_TYPE_BOOLEAN)
         return FALSE;
-
-      /* Add to object / array */
-      if (obj || array) {
-        gboolean v;
-        v = json_node_get_boolean (node);
-        if (obj)
-          json_object_set_boolean_member (obj, s_name, v);
-        else
-          json_array_add_boolean_element (array, v);
-        break;
-      }
       break;
-    case 'i':
-      /* Integer: check type */
+    case MELO_JSONRPC_TYPE_INT:
       if (vtype != G_TYPE_INT64)
         return FALSE;
-
-      /* Add to object / array */
-      if (obj || array) {
-        gint64 v;
-        v = json_node_get_int (node);
-        if (obj)
-          json_object_set_int_member (obj, s_name, v);
-        else
-          json_array_add_int_element (array, v);
-      }
       break;
-    case 'd':
-      /* Double: check type */
+    case MELO_JSONRPC_TYPE_DOUBLE:
       if (vtype != G_TYPE_DOUBLE)
         return FALSE;
-
-      /* Add to object / array */
-      if (obj || array) {
-        gdouble v;
-        v = json_node_get_double (node);
-        if (obj)
-          json_object_set_double_member (obj, s_name, v);
-        else
-          json_array_add_double_element (array, v);
-      }
       break;
-    case 's':
-      /* String: check type */
+    case MELO_JSONRPC_TYPE_STRING:
       if (vtype != G_TYPE_STRING)
         return FALSE;
-
-      /* Add to object / array */
-      if (obj || array) {
-        const gchar *v;
-        v = json_node_get_string (node);
-        if (obj)
-          json_object_set_string_member (obj, s_name, v);
-        else
-          json_array_add_string_element (array, v);
-      }
       break;
-    case 'o':
-      /* Object: check type */
+    case MELO_JSONRPC_TYPE_OBJECT:
       if (type != JSON_NODE_OBJECT)
         return FALSE;
-
-      /* Add to object / array */
-      if (obj || array) {
-        JsonObject *v;
-        v = json_node_dup_object (node);
-        if (obj)
-          json_object_set_object_member (obj, s_name, v);
-        else
-          json_array_add_object_element (array, v);
-      }
       break;
-    case 'a':
-      /* Array: check type */
+    case MELO_JSONRPC_TYPE_ARRAY:
       if (type != JSON_NODE_ARRAY)
         return FALSE;
-
-      /* Add to object / array */
-      if (obj || array) {
-        JsonArray *v;
-        v = json_node_dup_array (node);
-        if (obj)
-          json_object_set_array_member (obj, s_name, v);
-        else
-          json_array_add_array_element (array, v);
-      }
       break;
     default:
       return FALSE;
   }
+
+  /* Add to object / array: objects and arrays are shared, not copied */
+  if (obj)
+    json_object_set_member (obj, param->name, json_node_copy (node));
+  else if (array)
+    json_array_add_element (array, json_node_copy (node));
+
   return TRUE;
 }
 
 static gboolean
-melo_jsonrpc_get_json_node (JsonArray *schema_params, JsonNode *params,
+melo_jsonrpc_get_json_node (MeloJSONRPCSchema *schema, JsonNode *params,
                             JsonObject *obj, JsonArray *array,
                             JsonNode **error)
 {
-  JsonObject *schema;
+  const MeloJSONRPCParam *param;
   JsonNodeType type;
   JsonNode *node;
-  guint count, i;
+  guint i;
 
   /* Check schema */
-  if (!schema_params)
+  if (!schema)
     return FALSE;
 
   /* No params to check */
@@ -582,52 +989,38 @@ melo_jsonrpc_get_json_node (JsonArray *schema_params, JsonNode *params,
     return FALSE;
   }
 
-  /* Get element count from schema */
-  count = json_array_get_length (schema_params);
-
   /* Get type */
   type = json_node_get_node_type (params);
 
   /* Already an object */
   if (type == JSON_NODE_OBJECT) {
-    const gchar *name;
     JsonObject *o;
 
     /* Get object */
     o = json_node_get_object (params);
 
     /* Parse object */
-    for (i = 0; i < count; i++) {
-      /* Get next schema object */
-      schema = json_array_get_object_element (schema_params, i);
-      if (!schema)
-        goto failed;
-
-      /* Get parameter name */
-      name = json_object_get_string_member (schema, "name");
-      if (!name)
-        goto failed;
+    for (i = 0; i < schema->count; i++) {
+      param = &schema->params[i];
 
       /* Get node */
-      node = json_object_get_member (o, name);
+      node = json_object_get_member (o, param->name);
       if (!node) {
-        /* Get required flag: failed if not defined or TRUE */
-        node = json_object_get_member (schema, "required");
-        if (!node || (node && json_node_get_boolean (node)))
+        /* Parameter is required */
+        if (param->required)
           goto failed;
 
         /* When not required:
          *  - skip when converting to an object,
          *  - stop when converting to an array.
          */
-        if (obj)
-            continue;
         if (array)
-        return TRUE;
+          return TRUE;
+        continue;
       }
 
       /* Check node type */
-      if (!melo_jsonrpc_add_node (node, schema, obj, array))
+      if (!melo_jsonrpc_add_node (node, param, obj, array))
         goto failed;
     }
   } else if (type == JSON_NODE_ARRAY) {
@@ -638,18 +1031,14 @@ melo_jsonrpc_get_json_node (JsonArray *schema_params, JsonNode *params,
     a = json_node_get_array (params);
     params_count = json_array_get_length (a);
 
-    /* Parse object */
-    for (i = 0; i < count; i++) {
-      /* Get next schema object */
-      schema = json_array_get_object_element (schema_params, i);
-      if (!schema)
-        goto failed;
+    /* Parse array */
+    for (i = 0; i < schema->count; i++) {
+      param = &schema->params[i];
 
       /* No more parameters available */
       if (i >= params_count) {
-        /* Get required flag: failed if not defined or TRUE */
-        node = json_object_get_member (schema, "required");
-        if (!node || (node && json_node_get_boolean (node)))
+        /* Parameter is required */
+        if (param->required)
           goto failed;
 
         /* If this parameter was not required: stop conversion */
@@ -658,11 +1047,9 @@ melo_jsonrpc_get_json_node (JsonArray *schema_params, JsonNode *params,
 
       /* Get node */
       node = json_array_get_element (a, i);
-      if (!node)
-        goto failed;
 
       /* Check node type */
-      if (!melo_jsonrpc_add_node (node, schema, obj, array))
+      if (!node || !melo_jsonrpc_add_node (node, param, obj, array))
         goto failed;
     }
   }
@@ -676,18 +1063,26 @@ failed:
 }
 
 gboolean
-melo_jsonrpc_check_params (JsonArray *schema_params, JsonNode *params,
+melo_jsonrpc_check_params (MeloJSONRPCSchema *schema_params, JsonNode *params,
                            JsonNode **error)
 {
   return melo_jsonrpc_get_json_node (schema_params, params, NULL, NULL, error);
 }
 
 JsonObject *
-melo_jsonrpc_get_object (JsonArray *schema_params, JsonNode *params,
+melo_jsonrpc_get_object (MeloJSONRPCSchema *schema_params, JsonNode *params,
                          JsonNode **error)
 {
   JsonObject *obj;
 
+  /* Use request object: members are not copied */
+  if (schema_params && params &&
+      json_node_get_node_type (params) == JSON_NODE_OBJECT) {
+    if (!melo_jsonrpc_get_json_node (schema_params, params, NULL, NULL, error))
+      return NULL;
+    return json_object_ref (json_node_get_object (params));
+  }
+
   /* Allocate new object */
   obj = json_object_new ();
 
@@ -701,17 +1096,21 @@ melo_jsonrpc_get_object (JsonArray *schema_params, JsonNode *params,
 }
 
 JsonArray *
-melo_jsonrpc_get_array (JsonArray *schema_params, JsonNode *params,
+melo_jsonrpc_get_array (MeloJSONRPCSchema *schema_params, JsonNode *params,
                         JsonNode **error)
 {
   JsonArray *array;
-  guint count;
 
-  /* Get array length */
-  count = json_array_get_length (schema_params);
+  /* Use request array: elements are not copied */
+  if (schema_params && params &&
+      json_node_get_node_type (params) == JSON_NODE_ARRAY) {
+    if (!melo_jsonrpc_get_json_node (schema_params, params, NULL, NULL, error))
+      return NULL;
+    return json_array_ref (json_node_get_array (params));
+  }
 
   /* Allocate new array */
-  array = json_array_sized_new (count);
+  array = json_array_sized_new (schema_params ? schema_params->count : 0);
 
   /* Get array */
   if (!melo_jsonrpc_get_json_node (schema_params, params, NULL, array, error)) {
@@ -746,6 +1145,15 @@ melo_jsonrpc_node_to_string (JsonNode *node)
   return str;
 }
 
+static void
+melo_jsonrpc_write_response (MeloJSONWriter *writer, JsonNode *response)
+{
+  /* Append response in writer format */
+  if (response)
+    melo_json_writer_node (writer, response);
+  json_node_free (response);
+}
+
 static JsonNode *
 melo_jsonrpc_build_response_node (JsonNode *result, JsonNode *error,
                                   const gchar *id, gint64 nid)
@@ -25,6 +25,8 @@
 #include <glib.h>
 #include <json-glib/json-glib.h>
 
+#include "melo_json_writer.h"
+
 /* JSON RPC error codes */
 typedef enum {
   MELO_JSONRPC_ERROR_PARSE_ERROR = -32700,
@@ -35,12 +37,26 @@ typedef enum {
   MELO_JSONRPC_ERROR_SERVER_ERROR = -32000,
 } MeloJSONRPCError;
 
+/* Compiled parameters schema: generated once when method is registered */
+typedef struct _MeloJSONRPCSchema MeloJSONRPCSchema;
+
 /* Callback for method */
 typedef void (*MeloJSONRPCCallback) (const gchar *method,
-                                     JsonArray *schema_params, JsonNode *params,
+                                     MeloJSONRPCSchema *schema_params,
+                                     JsonNode *params,
                                      JsonNode **result, JsonNode **error,
                                      gpointer user_data);
 
+/* Callback for method writing its result directly: the result is written as
+ * a single JSON value with the writer, or error is set and nothing is written.
+ */
+typedef void (*MeloJSONRPCWriteCallback) (const gchar *method,
+                                          MeloJSONRPCSchema *schema_params,
+                                          JsonNode *params,
+                                          MeloJSONWriter *result,
+                                          JsonNode **error,
+                                          gpointer user_data);
+
 /* Method definition */
 typedef struct _MeloJSONRPCMethod {
   /* Method name */
@@ -48,12 +64,18 @@ typedef struct _MeloJSONRPCMethod {
   /* Params and result schemas */
   const gchar *params;
   const gchar *result;
-  /* Method callback */
+  /* Method callback: write_callback is used instead of callback when set */
   MeloJSONRPCCallback callback;
+  MeloJSONRPCWriteCallback write_callback;
   gpointer user_data;
+  /* Callback is thread safe: it can run in parallel with other elements of a
+   * batch. Other methods are always called one at a time by the thread
+   * parsing the batch.
+   */
+  gboolean concurrent;
 } MeloJSONRPCMethod;
 
-/* Register a JSON-RPC method */
+/* Register a JSON-RPC method: params and result are taken only on success */
 gboolean melo_jsonrpc_register_method (const gchar *group, const gchar *method,
                                        JsonArray *params, JsonObject *result,
                                        MeloJSONRPCCallback callback,
@@ -70,12 +92,23 @@ void melo_jsonrpc_unregister_methods (const gchar *group,
 gchar *melo_jsonrpc_parse_request (const gchar *request, gsize length,
                                    GError **eror);
 
-/* Parameters utils */
-gboolean melo_jsonrpc_check_params (JsonArray *schema_params, JsonNode *params,
-                                    JsonNode **error);
-JsonArray *melo_jsonrpc_get_array (JsonArray *schema_params, JsonNode *params,
-                                   JsonNode **error);
-JsonObject *melo_jsonrpc_get_object (JsonArray *schema_params,
+/* Parse a decoded JSON-RPC request: responses are written with writer, in its
+ * format, and FALSE is returned when there is no response to send. A NULL
+ * request, which could not be decoded, is answered with a parse error.
+ */
+gboolean melo_jsonrpc_parse_request_node (JsonNode *request,
+                                          MeloJSONWriter *writer);
+
+/* Parameters utils: when parameters are already an object (or an array),
+ * the request object (or array) is returned with a new reference, once
+ * checked against the schema. It is not stripped: it can hold members not
+ * described in the schema (or extra elements), which must be ignored.
+ */
+gboolean melo_jsonrpc_check_params (MeloJSONRPCSchema *schema_params,
+                                    JsonNode *params, JsonNode **error);
+JsonArray *melo_jsonrpc_get_array (MeloJSONRPCSchema *schema_params,
+                                   JsonNode *params, JsonNode **error);
+JsonObject *melo_jsonrpc_get_object (MeloJSONRPCSchema *schema_params,
                                      JsonNode *params, JsonNode **error);
 
 /* Utils */
@@ -246,7 +246,7 @@ melo_module_jsonrpc_list_to_array (GList *list,
 /* Method callbacks */
 static void
 melo_module_jsonrpc_get_list (const gchar *method,
-                              JsonArray *s_params, JsonNode *params,
+                              MeloJSONRPCSchema *s_params, JsonNode *params,
                               JsonNode **result, JsonNode **error,
                               gpointer user_data)
 {
@@ -282,7 +282,7 @@ melo_module_jsonrpc_get_list (const gchar *method,
 
 static void
 melo_module_jsonrpc_get_info (const gchar *method,
-                              JsonArray *s_params, JsonNode *params,
+                              MeloJSONRPCSchema *s_params, JsonNode *params,
                               JsonNode **result, JsonNode **error,
                               gpointer user_data)
 {
@@ -319,7 +319,8 @@ melo_module_jsonrpc_get_info (const gchar *method,
 
 static void
 melo_module_jsonrpc_get_browser_list (const gchar *method,
-                                      JsonArray *s_params, JsonNode *params,
+                                      MeloJSONRPCSchema *s_params,
+                                      JsonNode *params,
                                       JsonNode **result, JsonNode **error,
                                       gpointer user_data)
 {
@@ -362,7 +363,8 @@ melo_module_jsonrpc_get_browser_list (const gchar *method,
 
 static void
 melo_module_jsonrpc_get_player_list (const gchar *method,
-                                     JsonArray *s_params, JsonNode *params,
+                                     MeloJSONRPCSchema *s_params,
+                                     JsonNode *params,
                                      JsonNode **result, JsonNode **error,
                                      gpointer user_data)
 {
@@ -405,7 +407,8 @@ melo_module_jsonrpc_get_player_list (const gchar *method,
 
 static void
 melo_module_jsonrpc_get_full_list (const gchar *method,
-                                   JsonArray *s_params, JsonNode *params,
+                                   MeloJSONRPCSchema *s_params,
+                                   JsonNode *params,
                                    JsonNode **result, JsonNode **error,
                                    gpointer user_data)
 {
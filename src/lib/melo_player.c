@@ -593,6 +593,10 @@ melo_player_status_new (MeloPlayerState state, const gchar *name,
   status->priv->name = g_strdup (name);
   status->priv->tags = tags;
 
+  /* Use media duration until player gets it */
+  if (tags)
+    status->duration = tags->duration;
+
   return status;
 }
 
@@ -213,6 +213,76 @@ melo_player_jsonrpc_status_to_object (const MeloPlayerStatus *status,
   return obj;
 }
 
+void
+melo_player_jsonrpc_write_status (MeloJSONWriter *writer,
+                                   const MeloPlayerStatus *status,
+                                   MeloPlayerJSONRPCStatusFields fields,
+                                   MeloTagsFields tags_fields,
+                                   gint64 tags_timestamp)
+{
+  /* Same output than melo_player_jsonrpc_status_to_object() */
+  melo_json_writer_begin_object (writer);
+  if (fields & MELO_PLAYER_JSONRPC_STATUS_FIELDS_STATE) {
+    melo_json_writer_member (writer, "state");
+    melo_json_writer_string (writer,
+                             melo_player_state_to_string (status->state));
+    if (status->state == MELO_PLAYER_STATE_ERROR) {
+      melo_player_status_lock (status);
+      melo_json_writer_member (writer, "error");
+      melo_json_writer_string (writer,
+                               melo_player_status_lock_get_error (status));
+      melo_player_status_unlock (status);
+    }
+    melo_json_writer_member (writer, "buffer");
+    melo_json_writer_int (writer, status->buffer_percent);
+  }
+  if (fields & MELO_PLAYER_JSONRPC_STATUS_FIELDS_NAME) {
+    melo_player_status_lock (status);
+    melo_json_writer_member (writer, "name");
+    melo_json_writer_string (writer, melo_player_status_lock_get_name (status));
+    melo_player_status_unlock (status);
+  }
+  if (fields & MELO_PLAYER_JSONRPC_STATUS_FIELDS_POS) {
+    melo_json_writer_member (writer, "pos");
+    melo_json_writer_int (writer, status->pos);
+  }
+  if (fields & MELO_PLAYER_JSONRPC_STATUS_FIELDS_DURATION) {
+    melo_json_writer_member (writer, "duration");
+    melo_json_writer_int (writer, status->duration);
+  }
+  if (fields & MELO_PLAYER_JSONRPC_STATUS_FIELDS_PLAYLIST) {
+    melo_json_writer_member (writer, "has_prev");
+    melo_json_writer_boolean (writer, status->has_prev);
+    melo_json_writer_member (writer, "has_next");
+    melo_json_writer_boolean (writer, status->has_next);
+  }
+  if (fields & MELO_PLAYER_JSONRPC_STATUS_FIELDS_VOLUME) {
+    melo_json_writer_member (writer, "volume");
+    melo_json_writer_double (writer, status->volume);
+  }
+  if (fields & MELO_PLAYER_JSONRPC_STATUS_FIELDS_MUTE) {
+    melo_json_writer_member (writer, "mute");
+    melo_json_writer_boolean (writer, status->mute);
+  }
+  if (fields & MELO_PLAYER_JSONRPC_STATUS_FIELDS_TAGS) {
+    MeloTags *tags;
+
+    /* Get tags from status */
+    tags = melo_player_status_get_tags (status);
+    if (tags) {
+      if (tags_timestamp <= 0 || melo_tags_updated (tags, tags_timestamp)) {
+        melo_json_writer_member (writer, "tags");
+        melo_tags_write_json (tags, writer, tags_fields);
+      }
+      melo_tags_unref (tags);
+    } else {
+      melo_json_writer_member (writer, "tags");
+      melo_json_writer_null (writer);
+    }
+  }
+  melo_json_writer_end_object (writer);
+}
+
 static JsonArray *
 melo_player_jsonrpc_list_to_array (GList *list,
                                    MeloPlayerJSONRPCInfoFields fields,
@@ -271,7 +341,7 @@ melo_player_jsonrpc_list_to_array (GList *list,
 /* Method callbacks */
 static void
 melo_player_jsonrpc_get_list (const gchar *method,
-                              JsonArray *s_params, JsonNode *params,
+                              MeloJSONRPCSchema *s_params, JsonNode *params,
                               JsonNode **result, JsonNode **error,
                               gpointer user_data)
 {
@@ -324,7 +394,7 @@ melo_player_jsonrpc_get_list (const gchar *method,
 
 static void
 melo_player_jsonrpc_get_info (const gchar *method,
-                              JsonArray *s_params, JsonNode *params,
+                              MeloJSONRPCSchema *s_params, JsonNode *params,
                               JsonNode **result, JsonNode **error,
                               gpointer user_data)
 {
@@ -361,7 +431,7 @@ melo_player_jsonrpc_get_info (const gchar *method,
 
 static void
 melo_player_jsonrpc_set_state (const gchar *method,
-                               JsonArray *s_params, JsonNode *params,
+                               MeloJSONRPCSchema *s_params, JsonNode *params,
                                JsonNode **result, JsonNode **error,
                                gpointer user_data)
 {
@@ -403,7 +473,7 @@ melo_player_jsonrpc_set_state (const gchar *method,
 
 static void
 melo_player_jsonrpc_set_pos (const gchar *method,
-                             JsonArray *s_params, JsonNode *params,
+                             MeloJSONRPCSchema *s_params, JsonNode *params,
                              JsonNode **result, JsonNode **error,
                              gpointer user_data)
 {
@@ -442,7 +512,7 @@ melo_player_jsonrpc_set_pos (const gchar *method,
 
 static void
 melo_player_jsonrpc_set_volume (const gchar *method,
-                                JsonArray *s_params, JsonNode *params,
+                                MeloJSONRPCSchema *s_params, JsonNode *params,
                                 JsonNode **result, JsonNode **error,
                                 gpointer user_data)
 {
@@ -481,7 +551,7 @@ melo_player_jsonrpc_set_volume (const gchar *method,
 
 static void
 melo_player_jsonrpc_set_mute (const gchar *method,
-                                JsonArray *s_params, JsonNode *params,
+                                MeloJSONRPCSchema *s_params, JsonNode *params,
                                 JsonNode **result, JsonNode **error,
                                 gpointer user_data)
 {
@@ -520,8 +590,8 @@ melo_player_jsonrpc_set_mute (const gchar *method,
 
 static void
 melo_player_jsonrpc_get_status (const gchar *method,
-                                JsonArray *s_params, JsonNode *params,
-                                JsonNode **result, JsonNode **error,
+                                MeloJSONRPCSchema *s_params, JsonNode *params,
+                                MeloJSONWriter *result, JsonNode **error,
                                 gpointer user_data)
 {
   MeloPlayerJSONRPCStatusFields fields = MELO_PLAYER_JSONRPC_STATUS_FIELDS_NONE;
@@ -567,19 +637,15 @@ melo_player_jsonrpc_get_status (const gchar *method,
   if (!status)
     return;
 
-  /* Generate status */
-  obj = melo_player_jsonrpc_status_to_object (status, fields,
-                                              tags_fields, tags_ts);
+  /* Write status */
+  melo_player_jsonrpc_write_status (result, status, fields, tags_fields,
+                                    tags_ts);
   melo_player_status_unref (status);
-
-  /* Return result */
-  *result = json_node_new (JSON_NODE_OBJECT);
-  json_node_take_object (*result, obj);
 }
 
 static void
 melo_player_jsonrpc_action (const gchar *method,
-                            JsonArray *s_params, JsonNode *params,
+                            MeloJSONRPCSchema *s_params, JsonNode *params,
                             JsonNode **result, JsonNode **error,
                             gpointer user_data)
 {
@@ -711,7 +777,7 @@ static MeloJSONRPCMethod melo_player_jsonrpc_methods[] = {
               "  }"
               "]",
     .result = "{\"type\":\"object\"}",
-    .callback = melo_player_jsonrpc_get_status,
+    .write_callback = melo_player_jsonrpc_get_status,
     .user_data = NULL,
   },
   {
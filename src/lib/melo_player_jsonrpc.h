@@ -60,6 +60,11 @@ JsonObject * melo_player_jsonrpc_status_to_object (
                                            MeloPlayerJSONRPCStatusFields fields,
                                            MeloTagsFields tags_fields,
                                            gint64 tags_timestamp);
+void melo_player_jsonrpc_write_status (MeloJSONWriter *writer,
+                                       const MeloPlayerStatus *status,
+                                       MeloPlayerJSONRPCStatusFields fields,
+                                       MeloTagsFields tags_fields,
+                                       gint64 tags_timestamp);
 /* JSON-RPC methods */
 void melo_player_jsonrpc_register_methods (void);
 void melo_player_jsonrpc_unregister_methods (void);
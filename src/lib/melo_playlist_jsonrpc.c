@@ -125,11 +125,50 @@ melo_playlist_jsonrpc_list_to_array (const GList *list,
   return array;
 }
 
+static void
+melo_playlist_jsonrpc_write_list (MeloJSONWriter *writer, const GList *list,
+                                  MeloPlaylistJSONRPCListFields fields,
+                                  MeloTagsFields tags_fields)
+{
+  const GList *l;
+
+  /* Same output than melo_playlist_jsonrpc_list_to_array() */
+  melo_json_writer_begin_array (writer);
+  for (l = list; l != NULL; l = l->next) {
+    MeloPlaylistItem *item = (MeloPlaylistItem *) l->data;
+
+    melo_json_writer_begin_object (writer);
+    if (fields & MELO_PLAYLIST_JSONRPC_LIST_FIELDS_NAME) {
+      melo_json_writer_member (writer, "name");
+      melo_json_writer_string (writer, item->name);
+    }
+    if (fields & MELO_PLAYLIST_JSONRPC_LIST_FIELDS_FULL_NAME) {
+      melo_json_writer_member (writer, "full_name");
+      melo_json_writer_string (writer, item->full_name);
+    }
+    if (fields & MELO_PLAYLIST_JSONRPC_LIST_FIELDS_CMDS) {
+      melo_json_writer_member (writer, "can_play");
+      melo_json_writer_boolean (writer, item->can_play);
+      melo_json_writer_member (writer, "can_remove");
+      melo_json_writer_boolean (writer, item->can_remove);
+    }
+    if (fields & MELO_PLAYLIST_JSONRPC_LIST_FIELDS_TAGS) {
+      melo_json_writer_member (writer, "tags");
+      if (item->tags)
+        melo_tags_write_json (item->tags, writer, tags_fields);
+      else
+        melo_json_writer_null (writer);
+    }
+    melo_json_writer_end_object (writer);
+  }
+  melo_json_writer_end_array (writer);
+}
+
 /* Method callbacks */
 static void
 melo_playlist_jsonrpc_get_list (const gchar *method,
-                               JsonArray *s_params, JsonNode *params,
-                               JsonNode **result, JsonNode **error,
+                               MeloJSONRPCSchema *s_params, JsonNode *params,
+                               MeloJSONWriter *result, JsonNode **error,
                                gpointer user_data)
 {
   MeloPlaylistJSONRPCListFields fields = MELO_PLAYLIST_JSONRPC_LIST_FIELDS_NONE;
@@ -174,27 +213,22 @@ melo_playlist_jsonrpc_get_list (const gchar *method,
     return;
   }
 
-  /* Create a new object */
-  obj = json_object_new ();
-  json_object_set_string_member (obj, "current", list->current);
-
-  /* Create array from list */
-  array = melo_playlist_jsonrpc_list_to_array (list->items, fields,
-                                               tags_fields);
-  json_object_set_array_member (obj, "items", array);
+  /* Write list */
+  melo_json_writer_begin_object (result);
+  melo_json_writer_member (result, "current");
+  melo_json_writer_string (result, list->current);
+  melo_json_writer_member (result, "items");
+  melo_playlist_jsonrpc_write_list (result, list->items, fields, tags_fields);
+  melo_json_writer_end_object (result);
 
   /* Free playlist list */
   melo_playlist_list_free (list);
-
-  /* Return array */
-  *result = json_node_new (JSON_NODE_OBJECT);
-  json_node_take_object (*result, obj);
 }
 
 static void
 melo_playlist_jsonrpc_get_tags (const gchar *method,
-                                JsonArray *s_params, JsonNode *params,
-                                JsonNode **result, JsonNode **error,
+                                MeloJSONRPCSchema *s_params, JsonNode *params,
+                                MeloJSONWriter *result, JsonNode **error,
                                 gpointer user_data)
 {
   MeloTagsFields fields = MELO_TAGS_FIELDS_FULL;
@@ -232,18 +266,15 @@ melo_playlist_jsonrpc_get_tags (const gchar *method,
   json_object_unref (obj);
   g_object_unref (plist);
 
-  /* Parse list and create array */
-  obj = melo_tags_to_json_object (tags, fields);
-  melo_tags_unref (tags);
-
-  /* Return object */
-  *result = json_node_new (JSON_NODE_OBJECT);
-  json_node_take_object (*result, obj);
+  /* Write tags: cover is written as binary data when supported */
+  melo_tags_write_json (tags, result, fields);
+  if (tags)
+    melo_tags_unref (tags);
 }
 
 static void
 melo_playlist_jsonrpc_item_action (const gchar *method,
-                                  JsonArray *s_params, JsonNode *params,
+                                  MeloJSONRPCSchema *s_params, JsonNode *params,
                                   JsonNode **result, JsonNode **error,
                                   gpointer user_data)
 {
@@ -300,7 +331,7 @@ static MeloJSONRPCMethod melo_playlist_jsonrpc_methods[] = {
               "  }"
               "]",
     .result = "{\"type\":\"object\"}",
-    .callback = melo_playlist_jsonrpc_get_list,
+    .write_callback = melo_playlist_jsonrpc_get_list,
     .user_data = NULL,
   },
   {
@@ -314,7 +345,7 @@ static MeloJSONRPCMethod melo_playlist_jsonrpc_methods[] = {
               "  }"
               "]",
     .result = "{\"type\":\"object\"}",
-    .callback = melo_playlist_jsonrpc_get_tags,
+    .write_callback = melo_playlist_jsonrpc_get_tags,
     .user_data = NULL,
   },
   {
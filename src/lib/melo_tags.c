@@ -102,6 +102,10 @@ melo_tags_copy (MeloTags *tags)
   ntags->date = tags->date;
   ntags->track = tags->track;
   ntags->tracks = tags->tracks;
+  ntags->duration = tags->duration;
+  ntags->bitrate = tags->bitrate;
+  ntags->samplerate = tags->samplerate;
+  ntags->channels = tags->channels;
   npriv = ntags->priv;
 
   /* Lock cover access */
@@ -140,6 +144,14 @@ melo_tags_merge (MeloTags *tags, MeloTags *old_tags)
     tags->track = old_tags->track;
   if (!tags->tracks)
     tags->tracks = old_tags->tracks;
+  if (!tags->duration)
+    tags->duration = old_tags->duration;
+  if (!tags->bitrate)
+    tags->bitrate = old_tags->bitrate;
+  if (!tags->samplerate)
+    tags->samplerate = old_tags->samplerate;
+  if (!tags->channels)
+    tags->channels = old_tags->channels;
 
   /* Lock cover access */
   g_mutex_lock (&priv->mutex);
@@ -262,13 +274,10 @@ melo_tags_get_cover_type (MeloTags *tags)
 }
 
 gboolean
-melo_tags_set_cover_url (MeloTags *tags, GObject *obj, const gchar *path,
-                         const gchar *type)
+melo_tags_append_cover_url (GString *str, GObject *obj, const gchar *path)
 {
-  MeloTagsPrivate *priv = tags->priv;
   const gchar *otype = NULL;
   const gchar *id = NULL;
-  gchar *url = NULL;
   gchar del ='/';
 
   /* Lock object */
@@ -288,26 +297,52 @@ melo_tags_set_cover_url (MeloTags *tags, GObject *obj, const gchar *path,
     otype = "playlist";
   }
 
-  /* No ID found */
-  if (!id)
-    goto failed;
+  /* No ID or path found */
+  if (!id || !path) {
+    g_object_unref (obj);
+    return FALSE;
+  }
 
   G_LOCK (melo_tags_mutex);
 
   /* Generate cover URL from ID and path */
-  if (!path)
-    url = NULL;
-  else if (melo_tags_cover_url_base)
-    url = g_strdup_printf ("%s/%s/%s%c%s", melo_tags_cover_url_base, otype, id,
-                           del, path);
+  if (melo_tags_cover_url_base)
+    g_string_append_printf (str, "%s/%s/%s%c%s", melo_tags_cover_url_base,
+                            otype, id, del, path);
   else
-    url = g_strdup_printf ("%s/%s%c%s", otype, id, path, del, path);
+    g_string_append_printf (str, "%s/%s%c%s", otype, id, del, path);
 
   G_UNLOCK (melo_tags_mutex);
 
   /* Free object */
   g_object_unref (obj);
 
+  return TRUE;
+}
+
+gboolean
+melo_tags_set_cover_url (MeloTags *tags, GObject *obj, const gchar *path,
+                         const gchar *type)
+{
+  MeloTagsPrivate *priv = tags->priv;
+  gchar *url = NULL;
+  GString *str;
+
+  /* Object must be supported */
+  if (!MELO_IS_BROWSER (obj) && !MELO_IS_PLAYER (obj) &&
+      !MELO_IS_PLAYLIST (obj))
+    return FALSE;
+
+  /* Generate cover URL: no path resets it, no object ID is an error */
+  if (path) {
+    str = g_string_new (NULL);
+    if (!melo_tags_append_cover_url (str, obj, path)) {
+      g_string_free (str, TRUE);
+      return FALSE;
+    }
+    url = g_string_free (str, FALSE);
+  }
+
   /* Lock cover access */
   g_mutex_lock (&priv->mutex);
 
@@ -328,10 +363,6 @@ melo_tags_set_cover_url (MeloTags *tags, GObject *obj, const gchar *path,
   g_mutex_unlock (&priv->mutex);
 
   return TRUE;
-
-failed:
-  g_object_unref (obj);
-  return FALSE;
 }
 
 void
@@ -490,6 +521,19 @@ melo_tags_new_from_gst_tag_list (const GstTagList *tlist, MeloTagsFields fields)
     gst_tag_list_get_uint (tlist, GST_TAG_TRACK_NUMBER, &tags->track);
   if (fields & MELO_TAGS_FIELDS_TRACKS)
     gst_tag_list_get_uint (tlist, GST_TAG_TRACK_COUNT, &tags->tracks);
+  if (fields & MELO_TAGS_FIELDS_BITRATE &&
+      !gst_tag_list_get_uint (tlist, GST_TAG_BITRATE, &tags->bitrate))
+    gst_tag_list_get_uint (tlist, GST_TAG_NOMINAL_BITRATE, &tags->bitrate);
+
+  /* Get duration */
+  if (fields & MELO_TAGS_FIELDS_DURATION) {
+    guint64 duration;
+
+    /* Convert to ms */
+    if (gst_tag_list_get_uint64 (tlist, GST_TAG_DURATION, &duration) &&
+        GST_CLOCK_TIME_IS_VALID (duration))
+      tags->duration = duration / GST_MSECOND;
+  }
 
   /* Get date */
   if (fields & MELO_TAGS_FIELDS_DATE) {
@@ -579,6 +623,55 @@ melo_tags_new_from_gst_tag_list (const GstTagList *tlist, MeloTagsFields fields)
   return tags;
 }
 
+MeloTags *
+melo_tags_new_from_gst_discoverer_info (GstDiscovererInfo *info,
+                                        MeloTagsFields fields)
+{
+  const GstTagList *tlist;
+  GstClockTime duration;
+  GList *streams;
+  MeloTags *tags;
+
+  /* Get tags and audio streams */
+  tlist = gst_discoverer_info_get_tags (info);
+  streams = gst_discoverer_info_get_audio_streams (info);
+  if (!tlist && !streams)
+    return NULL;
+
+  /* Fill MeloTags from GstTagList */
+  tags = tlist ? melo_tags_new_from_gst_tag_list (tlist, fields) :
+                 melo_tags_new ();
+  if (!tags) {
+    gst_discoverer_stream_info_list_free (streams);
+    return NULL;
+  }
+
+  /* Get duration of media */
+  duration = gst_discoverer_info_get_duration (info);
+  if (fields & MELO_TAGS_FIELDS_DURATION && GST_CLOCK_TIME_IS_VALID (duration))
+    tags->duration = duration / GST_MSECOND;
+
+  /* Get details of first audio stream */
+  if (streams) {
+    GstDiscovererAudioInfo *audio = streams->data;
+    guint bitrate;
+
+    /* Use maximum bitrate when average is not known */
+    bitrate = gst_discoverer_audio_info_get_bitrate (audio);
+    if (!bitrate)
+      bitrate = gst_discoverer_audio_info_get_max_bitrate (audio);
+    if (fields & MELO_TAGS_FIELDS_BITRATE && bitrate)
+      tags->bitrate = bitrate;
+    if (fields & MELO_TAGS_FIELDS_SAMPLERATE)
+      tags->samplerate = gst_discoverer_audio_info_get_sample_rate (audio);
+    if (fields & MELO_TAGS_FIELDS_CHANNELS)
+      tags->channels = gst_discoverer_audio_info_get_channels (audio);
+    gst_discoverer_stream_info_list_free (streams);
+  }
+
+  return tags;
+}
+
 MeloTagsFields
 melo_tags_get_fields_from_json_array (JsonArray *array)
 {
@@ -619,6 +712,14 @@ melo_tags_get_fields_from_json_array (JsonArray *array)
       fields |= MELO_TAGS_FIELDS_COVER;
     else if (!g_strcmp0 (field, "cover_url"))
       fields |= MELO_TAGS_FIELDS_COVER_URL;
+    else if (!g_strcmp0 (field, "duration"))
+      fields |= MELO_TAGS_FIELDS_DURATION;
+    else if (!g_strcmp0 (field, "bitrate"))
+      fields |= MELO_TAGS_FIELDS_BITRATE;
+    else if (!g_strcmp0 (field, "samplerate"))
+      fields |= MELO_TAGS_FIELDS_SAMPLERATE;
+    else if (!g_strcmp0 (field, "channels"))
+      fields |= MELO_TAGS_FIELDS_CHANNELS;
   }
 
   return fields;
@@ -650,6 +751,14 @@ melo_tags_add_to_json_object (MeloTags *tags, JsonObject *obj,
     json_object_set_int_member (obj, "track", tags->track);
   if (fields & MELO_TAGS_FIELDS_TRACKS)
     json_object_set_int_member (obj, "tracks", tags->tracks);
+  if (fields & MELO_TAGS_FIELDS_DURATION)
+    json_object_set_int_member (obj, "duration", tags->duration);
+  if (fields & MELO_TAGS_FIELDS_BITRATE)
+    json_object_set_int_member (obj, "bitrate", tags->bitrate);
+  if (fields & MELO_TAGS_FIELDS_SAMPLERATE)
+    json_object_set_int_member (obj, "samplerate", tags->samplerate);
+  if (fields & MELO_TAGS_FIELDS_CHANNELS)
+    json_object_set_int_member (obj, "channels", tags->channels);
 
   /* Convert image to base64 */
   if (fields & MELO_TAGS_FIELDS_COVER) {
@@ -714,6 +823,112 @@ melo_tags_to_json_object (MeloTags *tags, MeloTagsFields fields)
   return obj;
 }
 
+void
+melo_tags_write_json (MeloTags *tags, MeloJSONWriter *writer,
+                      MeloTagsFields fields)
+{
+  MeloTagsPrivate *priv;
+  gboolean cover_type = FALSE;
+
+  /* Same output than melo_tags_to_json_object() */
+  melo_json_writer_begin_object (writer);
+  if (!tags || fields == MELO_TAGS_FIELDS_NONE) {
+    melo_json_writer_end_object (writer);
+    return;
+  }
+  priv = tags->priv;
+
+  /* Set timestamp in any case */
+  melo_json_writer_member (writer, "timestamp");
+  melo_json_writer_int (writer, priv->timestamp);
+
+  /* Write tags */
+  if (fields & MELO_TAGS_FIELDS_TITLE) {
+    melo_json_writer_member (writer, "title");
+    melo_json_writer_string (writer, tags->title);
+  }
+  if (fields & MELO_TAGS_FIELDS_ARTIST) {
+    melo_json_writer_member (writer, "artist");
+    melo_json_writer_string (writer, tags->artist);
+  }
+  if (fields & MELO_TAGS_FIELDS_ALBUM) {
+    melo_json_writer_member (writer, "album");
+    melo_json_writer_string (writer, tags->album);
+  }
+  if (fields & MELO_TAGS_FIELDS_GENRE) {
+    melo_json_writer_member (writer, "genre");
+    melo_json_writer_string (writer, tags->genre);
+  }
+  if (fields & MELO_TAGS_FIELDS_DATE) {
+    melo_json_writer_member (writer, "date");
+    melo_json_writer_int (writer, tags->date);
+  }
+  if (fields & MELO_TAGS_FIELDS_TRACK) {
+    melo_json_writer_member (writer, "track");
+    melo_json_writer_int (writer, tags->track);
+  }
+  if (fields & MELO_TAGS_FIELDS_TRACKS) {
+    melo_json_writer_member (writer, "tracks");
+    melo_json_writer_int (writer, tags->tracks);
+  }
+  if (fields & MELO_TAGS_FIELDS_DURATION) {
+    melo_json_writer_member (writer, "duration");
+    melo_json_writer_int (writer, tags->duration);
+  }
+  if (fields & MELO_TAGS_FIELDS_BITRATE) {
+    melo_json_writer_member (writer, "bitrate");
+    melo_json_writer_int (writer, tags->bitrate);
+  }
+  if (fields & MELO_TAGS_FIELDS_SAMPLERATE) {
+    melo_json_writer_member (writer, "samplerate");
+    melo_json_writer_int (writer, tags->samplerate);
+  }
+  if (fields & MELO_TAGS_FIELDS_CHANNELS) {
+    melo_json_writer_member (writer, "channels");
+    melo_json_writer_int (writer, tags->channels);
+  }
+
+  /* No cover requested */
+  if (!(fields & (MELO_TAGS_FIELDS_COVER | MELO_TAGS_FIELDS_COVER_URL))) {
+    melo_json_writer_end_object (writer);
+    return;
+  }
+
+  /* Lock cover */
+  g_mutex_lock (&priv->mutex);
+
+  /* Encode image in base64 when exclusive cover is not set */
+  if (fields & MELO_TAGS_FIELDS_COVER && priv->cover &&
+      (!(fields & MELO_TAGS_FIELDS_COVER_EX) ||
+       !(fields & MELO_TAGS_FIELDS_COVER_URL) || !priv->cover_url)) {
+    const guchar *data;
+    gsize size;
+
+    /* Write cover: raw data is encoded by writer, when needed */
+    data = g_bytes_get_data (priv->cover, &size);
+    melo_json_writer_member (writer, "cover");
+    melo_json_writer_binary (writer, data, size);
+    melo_json_writer_member (writer, "cover_type");
+    melo_json_writer_string (writer, priv->cover_type);
+    cover_type = TRUE;
+  }
+
+  /* Write cover URL: cover type is written only once */
+  if (fields & MELO_TAGS_FIELDS_COVER_URL && priv->cover_url) {
+    melo_json_writer_member (writer, "cover_url");
+    melo_json_writer_string (writer, priv->cover_url);
+    if (!cover_type) {
+      melo_json_writer_member (writer, "cover_type");
+      melo_json_writer_string (writer, priv->cover_type);
+    }
+  }
+
+  /* Unlock cover */
+  g_mutex_unlock (&priv->mutex);
+
+  melo_json_writer_end_object (writer);
+}
+
 void
 melo_tags_unref (MeloTags *tags)
 {
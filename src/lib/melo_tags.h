@@ -24,8 +24,11 @@
 
 #include <glib.h>
 #include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
 #include <json-glib/json-glib.h>
 
+#include "melo_json_writer.h"
+
 typedef struct _MeloTags MeloTags;
 typedef struct _MeloTagsPrivate MeloTagsPrivate;
 typedef enum _MeloTagsFields MeloTagsFields;
@@ -39,6 +42,12 @@ struct _MeloTags {
   guint track;
   guint tracks;
 
+  /* Stream details: duration (in ms), bitrate (in bps) and sample rate */
+  gint duration;
+  guint bitrate;
+  guint samplerate;
+  guint channels;
+
   /*< private >*/
   MeloTagsPrivate *priv;
 };
@@ -61,6 +70,12 @@ enum _MeloTagsFields {
    */
   MELO_TAGS_FIELDS_COVER_EX = (1 << 9),
 
+  /* Stream details */
+  MELO_TAGS_FIELDS_DURATION = (1 << 10),
+  MELO_TAGS_FIELDS_BITRATE = (1 << 11),
+  MELO_TAGS_FIELDS_SAMPLERATE = (1 << 12),
+  MELO_TAGS_FIELDS_CHANNELS = (1 << 13),
+
   /* Full tags definition with:
    *  - MELO_TAGS_FIELDS_FULL: cover_url or cover (if cover_url isn't found),
    *  - MELO_TAGS_FIELDS_FULL_COVER: cover and cover_url,
@@ -96,17 +111,23 @@ void melo_tags_copy_cover_url (MeloTags *tags, const gchar *url,
 gboolean melo_tags_has_cover_url (MeloTags *tags);
 gchar *melo_tags_get_cover_url (MeloTags *tags);
 void melo_tags_set_cover_url_base (const gchar *base);
+gboolean melo_tags_append_cover_url (GString *str, GObject *obj,
+                                     const gchar *path);
 gboolean melo_tags_get_cover_from_url (const gchar *url, GBytes **data,
                                        gchar **type);
 
 /* Gstreamer helper */
 MeloTags *melo_tags_new_from_gst_tag_list (const GstTagList *tlist,
                                            MeloTagsFields fields);
+MeloTags *melo_tags_new_from_gst_discoverer_info (GstDiscovererInfo *info,
+                                                  MeloTagsFields fields);
 
 /* JSON-RPC helper */
 MeloTagsFields melo_tags_get_fields_from_json_array (JsonArray *array);
 void melo_tags_add_to_json_object (MeloTags *tags, JsonObject *object,
                                    MeloTagsFields fields);
 JsonObject *melo_tags_to_json_object (MeloTags *tags, MeloTagsFields fields);
+void melo_tags_write_json (MeloTags *tags, MeloJSONWriter *writer,
+                           MeloTagsFields fields);
 
 #endif /* __MELO_TAGS_H__ */
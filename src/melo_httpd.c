@@ -61,6 +61,9 @@ struct _MeloHTTPDPrivate {
   /* Thread pools */
   GThreadPool *jsonrpc_pool;
   GThreadPool *cover_pool;
+
+  /* Cover thumbnails */
+  MeloHTTPDCover *cover;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (MeloHTTPD, melo_httpd, G_TYPE_OBJECT)
@@ -81,9 +84,14 @@ melo_httpd_finalize (GObject *gobject)
   /* Free HTTP server */
   g_object_unref (priv->server);
 
-  /* Free thread pools */
+  /* Free thread pools: wait for running thumbnail workers, since they still
+   * use the cover context freed below
+   */
   g_thread_pool_free (priv->jsonrpc_pool, TRUE, FALSE);
-  g_thread_pool_free (priv->cover_pool, TRUE, FALSE);
+  g_thread_pool_free (priv->cover_pool, TRUE, TRUE);
+
+  /* Free cover thumbnails context */
+  melo_httpd_cover_free (priv->cover);
 
   /* free authentication */
   g_object_unref (priv->auth_domain);
@@ -110,6 +118,7 @@ static void
 melo_httpd_init (MeloHTTPD *self)
 {
   MeloHTTPDPrivate *priv = melo_httpd_get_instance_private (self);
+  gchar *path;
 
   self->priv = priv;
   priv->username = NULL;
@@ -131,11 +140,16 @@ melo_httpd_init (MeloHTTPD *self)
                           NULL);
   priv->auth_enabled = FALSE;
 
+  /* Create cover thumbnails context */
+  path = g_strdup_printf ("%s/melo/covers", g_get_user_cache_dir ());
+  priv->cover = melo_httpd_cover_new (priv->server, path);
+  g_free (path);
+
   /* Init thread pools */
   priv->jsonrpc_pool = g_thread_pool_new (melo_httpd_jsonrpc_thread_handler,
                                           priv->server, 10, FALSE, NULL);
   priv->cover_pool = g_thread_pool_new (melo_httpd_cover_thread_handler,
-                                        priv->server, 10, FALSE, NULL);
+                                        priv->cover, 10, FALSE, NULL);
 
   /* Create an avahi client */
   priv->avahi = melo_avahi_new ();
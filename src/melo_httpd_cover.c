@@ -20,17 +20,258 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
 #include "melo_tags.h"
 
 #include "melo_httpd_cover.h"
 
+/* Maximal time allowed to generate a thumbnail */
+#define MELO_HTTPD_COVER_SCALE_TIMEOUT (5 * GST_SECOND)
+
+/* Thumbnail sizes (in pixels) available with the size query parameter */
+static const guint melo_httpd_cover_sizes[] = { 64, 256, 512 };
+
+struct _MeloHTTPDCover {
+  SoupServer *server;
+  gchar *path;
+
+  /* Thumbnails in generation and thumbnails which cannot be generated */
+  GMutex mutex;
+  GCond cond;
+  GHashTable *pending;
+  GHashTable *failed;
+};
+
+MeloHTTPDCover *
+melo_httpd_cover_new (SoupServer *server, const gchar *path)
+{
+  MeloHTTPDCover *cover;
+  guint i;
+
+  /* Allocate cover context */
+  cover = g_slice_new0 (MeloHTTPDCover);
+  cover->server = server;
+  cover->path = g_strdup (path);
+
+  /* Init pending thumbnails list */
+  g_mutex_init (&cover->mutex);
+  g_cond_init (&cover->cond);
+  cover->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          NULL);
+  cover->failed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         NULL);
+
+  /* Create a thumbnails directory for each size */
+  for (i = 0; i < G_N_ELEMENTS (melo_httpd_cover_sizes); i++) {
+    gchar *dir;
+
+    dir = g_strdup_printf ("%s/%u", path, melo_httpd_cover_sizes[i]);
+    g_mkdir_with_parents (dir, 0700);
+    g_free (dir);
+  }
+
+  return cover;
+}
+
+void
+melo_httpd_cover_free (MeloHTTPDCover *cover)
+{
+  /* Free pending and failed thumbnails lists */
+  g_hash_table_unref (cover->pending);
+  g_hash_table_unref (cover->failed);
+  g_cond_clear (&cover->cond);
+  g_mutex_clear (&cover->mutex);
+
+  /* Free cover context */
+  g_free (cover->path);
+  g_slice_free (MeloHTTPDCover, cover);
+}
+
+static guint
+melo_httpd_cover_get_size (SoupURI *uri)
+{
+  GHashTable *query;
+  const gchar *value;
+  guint64 size = 0;
+  guint i;
+
+  /* Get size from query */
+  if (!soup_uri_get_query (uri))
+    return 0;
+  query = soup_form_decode (soup_uri_get_query (uri));
+  value = g_hash_table_lookup (query, "size");
+  if (value)
+    size = g_ascii_strtoull (value, NULL, 10);
+  g_hash_table_unref (query);
+
+  /* Original cover requested */
+  if (!size)
+    return 0;
+
+  /* Select smallest thumbnail which fits the requested size */
+  for (i = 0; i < G_N_ELEMENTS (melo_httpd_cover_sizes); i++)
+    if (size <= melo_httpd_cover_sizes[i])
+      return melo_httpd_cover_sizes[i];
+
+  /* Use the biggest thumbnail */
+  return melo_httpd_cover_sizes[i - 1];
+}
+
+static gboolean
+melo_httpd_cover_scale (GBytes *cover, guint size, const gchar *filename)
+{
+  GstElement *pipeline, *src, *sink;
+  GFileOutputStream *output;
+  GInputStream *input;
+  GstMessage *msg;
+  GstBus *bus;
+  GFile *file;
+  gboolean ret = FALSE;
+  gchar *desc;
+
+  /* Open output file */
+  file = g_file_new_for_path (filename);
+  output = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL);
+  g_object_unref (file);
+  if (!output)
+    return FALSE;
+
+  /* Create scale pipeline: keep aspect ratio and never upscale */
+  desc = g_strdup_printf ("giostreamsrc name=src ! decodebin ! videoconvert ! "
+                          "videoscale ! video/x-raw,width=[1,%u],"
+                          "height=[1,%u],pixel-aspect-ratio=1/1 ! "
+                          "jpegenc ! giostreamsink name=sink", size, size);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (!pipeline) {
+    g_object_unref (output);
+    return FALSE;
+  }
+
+  /* Set input and output streams */
+  input = g_memory_input_stream_new_from_bytes (cover);
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (src, "stream", input, NULL);
+  g_object_set (sink, "stream", output, NULL);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+
+  /* Generate thumbnail */
+  bus = gst_element_get_bus (pipeline);
+  if (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE) {
+    /* Wait end of stream */
+    msg = gst_bus_timed_pop_filtered (bus, MELO_HTTPD_COVER_SCALE_TIMEOUT,
+                                      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (msg) {
+      ret = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+      gst_message_unref (msg);
+    }
+  }
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  /* Close streams */
+  if (!g_output_stream_close (G_OUTPUT_STREAM (output), NULL, NULL))
+    ret = FALSE;
+  g_object_unref (output);
+  g_object_unref (input);
+
+  return ret;
+}
+
+static gchar *
+melo_httpd_cover_get_md5 (const gchar *url, GBytes *data)
+{
+  const gchar *name;
+  guint i;
+
+  /* Covers of library are already named by their MD5: "<md5>.jpg|png" */
+  name = strrchr (url, '/');
+  name = name ? name + 1 : url;
+  for (i = 0; i < 32 && g_ascii_isxdigit (name[i]); i++);
+  if (i == 32 && (!g_strcmp0 (name + i, ".jpg") ||
+                  !g_strcmp0 (name + i, ".png")))
+    return g_strndup (name, 32);
+
+  /* Calculate MD5 of cover */
+  return g_compute_checksum_for_bytes (G_CHECKSUM_MD5, data);
+}
+
+static GBytes *
+melo_httpd_cover_get_thumbnail (MeloHTTPDCover *cover, GBytes *data,
+                                const gchar *md5, guint size)
+{
+  GMappedFile *file;
+  GBytes *thumb;
+  gchar *path;
+
+  /* Thumbnails are named by the MD5 of the original cover */
+  path = g_strdup_printf ("%s/%u/%s.jpg", cover->path, size, md5);
+
+  /* Wait for the same thumbnail in generation by another request */
+  g_mutex_lock (&cover->mutex);
+  while (g_hash_table_contains (cover->pending, path))
+    g_cond_wait (&cover->cond, &cover->mutex);
+
+  /* Thumbnail generation has already failed */
+  if (g_hash_table_contains (cover->failed, path)) {
+    g_mutex_unlock (&cover->mutex);
+    g_free (path);
+    return NULL;
+  }
+
+  /* Generate thumbnail if not yet cached */
+  if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+    gboolean ret;
+    gchar *tmp;
+
+    /* Mark thumbnail as pending */
+    g_hash_table_add (cover->pending, g_strdup (path));
+    g_mutex_unlock (&cover->mutex);
+
+    /* Scale cover in a temporary file and then move it into cache */
+    tmp = g_strconcat (path, ".tmp", NULL);
+    ret = melo_httpd_cover_scale (data, size, tmp) && !g_rename (tmp, path);
+    if (!ret)
+      g_unlink (tmp);
+    g_free (tmp);
+
+    /* Wake up requests waiting for this thumbnail: a failure is not retried
+     * until restart
+     */
+    g_mutex_lock (&cover->mutex);
+    g_hash_table_remove (cover->pending, path);
+    if (!ret)
+      g_hash_table_add (cover->failed, g_strdup (path));
+    g_cond_broadcast (&cover->cond);
+  }
+  g_mutex_unlock (&cover->mutex);
+
+  /* Map thumbnail */
+  file = g_mapped_file_new (path, FALSE, NULL);
+  g_free (path);
+  if (!file)
+    return NULL;
+  thumb = g_mapped_file_get_bytes (file);
+  g_mapped_file_unref (file);
+
+  return thumb;
+}
+
 void
 melo_httpd_cover_thread_handler (gpointer data, gpointer user_data)
 {
-  SoupServer *server = SOUP_SERVER (user_data);
+  MeloHTTPDCover *hcover = (MeloHTTPDCover *) user_data;
+  SoupServer *server = hcover->server;
   SoupMessage *msg = SOUP_MESSAGE (data);
   SoupBuffer *buffer;
   SoupURI *uri;
@@ -39,6 +280,7 @@ melo_httpd_cover_thread_handler (gpointer data, gpointer user_data)
   const char *cover_data;
   const gchar *url;
   gsize size;
+  guint thumb_size;
 
   /* Get URL from request */
   uri = soup_message_get_uri (msg);
@@ -54,6 +296,23 @@ melo_httpd_cover_thread_handler (gpointer data, gpointer user_data)
     return;
   }
 
+  /* Replace cover with a thumbnail: original cover is sent on failure */
+  thumb_size = melo_httpd_cover_get_size (uri);
+  if (thumb_size) {
+    GBytes *thumb;
+    gchar *md5;
+
+    md5 = melo_httpd_cover_get_md5 (url, cover);
+    thumb = melo_httpd_cover_get_thumbnail (hcover, cover, md5, thumb_size);
+    g_free (md5);
+    if (thumb) {
+      g_bytes_unref (cover);
+      g_free (type);
+      type = g_strdup ("image/jpeg");
+      cover = thumb;
+    }
+  }
+
   /* Set response status */
   soup_message_set_status (msg, SOUP_STATUS_OK);
   if (type)
@@ -25,6 +25,11 @@
 #include <glib.h>
 #include <libsoup/soup.h>
 
+typedef struct _MeloHTTPDCover MeloHTTPDCover;
+
+MeloHTTPDCover *melo_httpd_cover_new (SoupServer *server, const gchar *path);
+void melo_httpd_cover_free (MeloHTTPDCover *cover);
+
 void melo_httpd_cover_thread_handler (gpointer data, gpointer user_data);
 void melo_httpd_cover_handler (SoupServer *server, SoupMessage *msg,
                                const char *path, GHashTable *query,
@@ -26,33 +26,114 @@
 #include "melo_jsonrpc.h"
 
 #include "melo_httpd_jsonrpc.h"
+#include "melo_httpd_msgpack.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
 
+static gboolean
+melo_httpd_jsonrpc_accept_msgpack (SoupMessage *msg, gboolean def)
+{
+  const char *accept;
+  gboolean ret = def;
+  GSList *list, *l;
+
+  /* No preference: answer in request format */
+  accept = soup_message_headers_get_one (msg->request_headers, "Accept");
+  if (!accept)
+    return def;
+
+  /* Use first supported type in client preference order */
+  list = soup_header_parse_quality_list (accept, NULL);
+  for (l = list; l != NULL; l = l->next) {
+    if (melo_httpd_msgpack_is_type (l->data)) {
+      ret = TRUE;
+      break;
+    }
+    if (!g_ascii_strcasecmp (l->data, "application/json")) {
+      ret = FALSE;
+      break;
+    }
+    if (!g_strcmp0 (l->data, "*/*"))
+      break;
+  }
+  soup_header_free_list (list);
+
+  return ret;
+}
+
 void
 melo_httpd_jsonrpc_thread_handler (gpointer data, gpointer user_data)
 {
   SoupServer *server = SOUP_SERVER (user_data);
   SoupMessage *msg = SOUP_MESSAGE (data);
+  JsonParser *parser = NULL;
+  MeloJSONWriter *writer;
+  gboolean msgpack, ret;
+  const char *type;
   GError *err = NULL;
+  JsonNode *req;
+  GBytes *bytes;
+  gsize len;
   char *res;
 
-  /* Parse request */
-  res = melo_jsonrpc_parse_request (msg->request_body->data,
-                                    msg->request_body->length,
-                                    &err);
+  /* Get request format */
+  type = soup_message_headers_get_content_type (msg->request_headers, NULL);
+  msgpack = melo_httpd_msgpack_is_type (type);
 
   /* Set response status */
   soup_message_set_status (msg, SOUP_STATUS_OK);
-  if (!res)
+  soup_message_headers_append (msg->response_headers, "Vary", "Accept");
+
+  /* Parse JSON request and send response in JSON */
+  if (!msgpack && !melo_httpd_jsonrpc_accept_msgpack (msg, FALSE)) {
+    res = melo_jsonrpc_parse_request (msg->request_body->data,
+                                      msg->request_body->length,
+                                      &err);
+    if (res)
+      soup_message_set_response (msg, "application/json", SOUP_MEMORY_TAKE,
+                                 res, strlen (res));
+    soup_server_unpause_message (server, msg);
     return;
+  }
+
+  /* Decode request: an invalid document is answered with a parse error */
+  if (msgpack)
+    req = melo_httpd_msgpack_decode ((const guchar *) msg->request_body->data,
+                                     msg->request_body->length);
+  else {
+    /* Parse JSON request: node is owned by parser */
+    parser = json_parser_new ();
+    if (!json_parser_load_from_data (parser, msg->request_body->data,
+                                     msg->request_body->length, NULL))
+      req = NULL;
+    else
+      req = json_parser_get_root (parser);
+  }
+
+  /* Parse request and write response in negotiated format */
+  if (melo_httpd_jsonrpc_accept_msgpack (msg, msgpack)) {
+    writer = melo_json_writer_new_full (MELO_JSON_WRITER_FORMAT_MSGPACK);
+    type = MELO_HTTPD_MSGPACK_TYPE;
+  } else {
+    writer = melo_json_writer_new ();
+    type = "application/json";
+  }
+  ret = melo_jsonrpc_parse_request_node (req, writer);
+  if (parser)
+    g_object_unref (parser);
+  else if (req)
+    json_node_free (req);
 
-  /* Set response */
-  soup_message_set_response (msg, "application/json", SOUP_MEMORY_TAKE,
-                             res, strlen (res));
+  /* Send response */
+  bytes = melo_json_writer_free_to_bytes (writer);
+  if (ret) {
+    res = g_bytes_unref_to_data (bytes, &len);
+    soup_message_set_response (msg, type, SOUP_MEMORY_TAKE, res, len);
+  } else
+    g_bytes_unref (bytes);
   soup_server_unpause_message (server, msg);
 }
 
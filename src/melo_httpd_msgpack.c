@@ -0,0 +1,307 @@
+/*
+ * melo_httpd_msgpack.c: MessagePack transport for JSON-RPC
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "melo_httpd_msgpack.h"
+
+/* Maximum nesting of arrays and maps */
+#define MELO_HTTPD_MSGPACK_MAX_DEPTH 32
+
+typedef struct {
+  const guchar *data;
+  gsize len;
+  gsize pos;
+  GString *str;
+} MeloHTTPDMsgpackReader;
+
+gboolean
+melo_httpd_msgpack_is_type (const gchar *type)
+{
+  return !g_strcmp0 (type, MELO_HTTPD_MSGPACK_TYPE) ||
+         !g_strcmp0 (type, MELO_HTTPD_MSGPACK_TYPE_X);
+}
+
+/* MessagePack decoding */
+static gboolean
+melo_httpd_msgpack_read_uint (MeloHTTPDMsgpackReader *r, guint size,
+                              guint64 *value)
+{
+  guint i;
+
+  /* Check length */
+  if (r->len - r->pos < size)
+    return FALSE;
+
+  /* Read big endian value */
+  *value = 0;
+  for (i = 0; i < size; i++)
+    *value = (*value << 8) | r->data[r->pos++];
+
+  return TRUE;
+}
+
+static gboolean
+melo_httpd_msgpack_read_value (MeloHTTPDMsgpackReader *r,
+                               JsonBuilder *builder, guint depth);
+
+static gboolean
+melo_httpd_msgpack_read_str (MeloHTTPDMsgpackReader *r, guint64 len,
+                             JsonBuilder *builder, gboolean is_key)
+{
+  /* Check length */
+  if (r->len - r->pos < len)
+    return FALSE;
+
+  /* Copy string to get a NULL terminated string */
+  g_string_truncate (r->str, 0);
+  g_string_append_len (r->str, (const gchar *) r->data + r->pos, len);
+  r->pos += len;
+
+  /* Add member name or string */
+  if (is_key)
+    json_builder_set_member_name (builder, r->str->str);
+  else
+    json_builder_add_string_value (builder, r->str->str);
+
+  return TRUE;
+}
+
+static gboolean
+melo_httpd_msgpack_read_bin (MeloHTTPDMsgpackReader *r, guint64 len,
+                             JsonBuilder *builder)
+{
+  gchar *str;
+
+  /* Check length */
+  if (r->len - r->pos < len)
+    return FALSE;
+
+  /* Add as base64 string */
+  str = g_base64_encode (r->data + r->pos, len);
+  json_builder_add_string_value (builder, str);
+  r->pos += len;
+  g_free (str);
+
+  return TRUE;
+}
+
+static gboolean
+melo_httpd_msgpack_read_array (MeloHTTPDMsgpackReader *r, guint64 count,
+                               JsonBuilder *builder, guint depth)
+{
+  guint64 i;
+
+  /* Too many levels */
+  if (depth >= MELO_HTTPD_MSGPACK_MAX_DEPTH)
+    return FALSE;
+
+  /* Read elements */
+  json_builder_begin_array (builder);
+  for (i = 0; i < count; i++)
+    if (!melo_httpd_msgpack_read_value (r, builder, depth + 1))
+      return FALSE;
+  json_builder_end_array (builder);
+
+  return TRUE;
+}
+
+static gboolean
+melo_httpd_msgpack_read_map (MeloHTTPDMsgpackReader *r, guint64 count,
+                             JsonBuilder *builder, guint depth)
+{
+  guint64 i, len;
+  guchar c;
+
+  /* Too many levels */
+  if (depth >= MELO_HTTPD_MSGPACK_MAX_DEPTH)
+    return FALSE;
+
+  /* Read members: only string keys are supported */
+  json_builder_begin_object (builder);
+  for (i = 0; i < count; i++) {
+    if (r->pos >= r->len)
+      return FALSE;
+    c = r->data[r->pos++];
+    if ((c & 0xe0) == 0xa0)
+      len = c & 0x1f;
+    else if (c < 0xd9 || c > 0xdb ||
+             !melo_httpd_msgpack_read_uint (r, 1 << (c - 0xd9), &len))
+      return FALSE;
+    if (!melo_httpd_msgpack_read_str (r, len, builder, TRUE) ||
+        !melo_httpd_msgpack_read_value (r, builder, depth + 1))
+      return FALSE;
+  }
+  json_builder_end_object (builder);
+
+  return TRUE;
+}
+
+static gboolean
+melo_httpd_msgpack_read_value (MeloHTTPDMsgpackReader *r,
+                               JsonBuilder *builder, guint depth)
+{
+  guint64 v;
+  guint32 u;
+  gdouble d;
+  gfloat f;
+  guchar c;
+
+  /* Get type */
+  if (r->pos >= r->len)
+    return FALSE;
+  c = r->data[r->pos++];
+
+  /* Fixed types */
+  if (c <= 0x7f) {
+    json_builder_add_int_value (builder, c);
+    return TRUE;
+  } else if (c >= 0xe0) {
+    json_builder_add_int_value (builder, (gint8) c);
+    return TRUE;
+  } else if ((c & 0xf0) == 0x80)
+    return melo_httpd_msgpack_read_map (r, c & 0x0f, builder, depth);
+  else if ((c & 0xf0) == 0x90)
+    return melo_httpd_msgpack_read_array (r, c & 0x0f, builder, depth);
+  else if ((c & 0xe0) == 0xa0)
+    return melo_httpd_msgpack_read_str (r, c & 0x1f, builder, FALSE);
+
+  switch (c) {
+    case 0xc0:
+      json_builder_add_null_value (builder);
+      break;
+    case 0xc2:
+    case 0xc3:
+      json_builder_add_boolean_value (builder, c == 0xc3);
+      break;
+    case 0xc4:
+    case 0xc5:
+    case 0xc6:
+      /* Binary */
+      return melo_httpd_msgpack_read_uint (r, 1 << (c - 0xc4), &v) &&
+             melo_httpd_msgpack_read_bin (r, v, builder);
+    case 0xca:
+      /* Float 32: NaN and infinity have no JSON representation */
+      if (!melo_httpd_msgpack_read_uint (r, 4, &v))
+        return FALSE;
+      u = v;
+      memcpy (&f, &u, sizeof (f));
+      if (!isfinite (f))
+        return FALSE;
+      json_builder_add_double_value (builder, f);
+      break;
+    case 0xcb:
+      /* Float 64 */
+      if (!melo_httpd_msgpack_read_uint (r, 8, &v))
+        return FALSE;
+      memcpy (&d, &v, sizeof (d));
+      if (!isfinite (d))
+        return FALSE;
+      json_builder_add_double_value (builder, d);
+      break;
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf:
+      /* Unsigned integer */
+      if (!melo_httpd_msgpack_read_uint (r, 1 << (c - 0xcc), &v))
+        return FALSE;
+      if (v > G_MAXINT64)
+        json_builder_add_double_value (builder, v);
+      else
+        json_builder_add_int_value (builder, v);
+      break;
+    case 0xd0:
+      /* Signed integers */
+      if (!melo_httpd_msgpack_read_uint (r, 1, &v))
+        return FALSE;
+      json_builder_add_int_value (builder, (gint8) v);
+      break;
+    case 0xd1:
+      if (!melo_httpd_msgpack_read_uint (r, 2, &v))
+        return FALSE;
+      json_builder_add_int_value (builder, (gint16) v);
+      break;
+    case 0xd2:
+      if (!melo_httpd_msgpack_read_uint (r, 4, &v))
+        return FALSE;
+      json_builder_add_int_value (builder, (gint32) v);
+      break;
+    case 0xd3:
+      if (!melo_httpd_msgpack_read_uint (r, 8, &v))
+        return FALSE;
+      json_builder_add_int_value (builder, (gint64) v);
+      break;
+    case 0xd9:
+    case 0xda:
+    case 0xdb:
+      /* String */
+      return melo_httpd_msgpack_read_uint (r, 1 << (c - 0xd9), &v) &&
+             melo_httpd_msgpack_read_str (r, v, builder, FALSE);
+    case 0xdc:
+    case 0xdd:
+      /* Array */
+      return melo_httpd_msgpack_read_uint (r, 2 << (c - 0xdc), &v) &&
+             melo_httpd_msgpack_read_array (r, v, builder, depth);
+    case 0xde:
+    case 0xdf:
+      /* Map */
+      return melo_httpd_msgpack_read_uint (r, 2 << (c - 0xde), &v) &&
+             melo_httpd_msgpack_read_map (r, v, builder, depth);
+    default:
+      /* Extension types are not supported */
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+JsonNode *
+melo_httpd_msgpack_decode (const guchar *data, gsize len)
+{
+  MeloHTTPDMsgpackReader r;
+  JsonBuilder *builder;
+  JsonNode *node = NULL;
+  JsonNode *root;
+
+  /* Init reader */
+  r.data = data;
+  r.len = len;
+  r.pos = 0;
+  r.str = g_string_new (NULL);
+
+  /* Decode document in an array, since a builder root cannot be a value:
+   * trailing data is not allowed
+   */
+  builder = json_builder_new ();
+  json_builder_begin_array (builder);
+  if (melo_httpd_msgpack_read_value (&r, builder, 0) && r.pos == r.len) {
+    json_builder_end_array (builder);
+    root = json_builder_get_root (builder);
+    node = json_array_dup_element (json_node_get_array (root), 0);
+    json_node_free (root);
+  }
+  g_object_unref (builder);
+  g_string_free (r.str, TRUE);
+
+  return node;
+}
@@ -0,0 +1,40 @@
+/*
+ * melo_httpd_msgpack.h: MessagePack transport for JSON-RPC
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __MELO_HTTPD_MSGPACK_H__
+#define __MELO_HTTPD_MSGPACK_H__
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+
+/* MessagePack content types */
+#define MELO_HTTPD_MSGPACK_TYPE "application/msgpack"
+#define MELO_HTTPD_MSGPACK_TYPE_X "application/x-msgpack"
+
+gboolean melo_httpd_msgpack_is_type (const gchar *type);
+
+/* Decode a MessagePack document: binary values are converted to base64
+ * strings. NULL is returned when document is invalid. Responses are encoded
+ * directly by a MeloJSONWriter in MessagePack format.
+ */
+JsonNode *melo_httpd_msgpack_decode (const guchar *data, gsize len);
+
+#endif /* __MELO_HTTPD_MSGPACK_H__ */
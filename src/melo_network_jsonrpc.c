@@ -292,7 +292,8 @@ melo_network_jsonrpc_ap_list_to_array (GList *list,
 /* Method callbacks */
 static void
 melo_network_jsonrpc_get_device_list (const gchar *method,
-                                     JsonArray *s_params, JsonNode *params,
+                                     MeloJSONRPCSchema *s_params,
+                                     JsonNode *params,
                                      JsonNode **result, JsonNode **error,
                                      gpointer user_data)
 {
@@ -327,7 +328,7 @@ melo_network_jsonrpc_get_device_list (const gchar *method,
 
 static void
 melo_network_jsonrpc_scan_wifi (const gchar *method,
-                                JsonArray *s_params, JsonNode *params,
+                                MeloJSONRPCSchema *s_params, JsonNode *params,
                                 JsonNode **result, JsonNode **error,
                                 gpointer user_data)
 {
@@ -23,11 +23,28 @@
 #include <gio/gio.h>
 #include <gst/pbutils/pbutils.h>
 
+#include "melo_tags_file.h"
+#include "melo_discoverer_file.h"
 #include "melo_browser_file.h"
 
 #define MELO_BROWSER_FILE_ID "melo_browser_file_id"
 #define MELO_BROWSER_FILE_ID_LENGTH 8
 
+/* Maximum directory listings kept in cache */
+#define MELO_BROWSER_FILE_DIRS_CACHE_SIZE 32
+
+/* Above this count of files in a page, all songs of the directory are fetched
+ * from database with a single request.
+ */
+#define MELO_BROWSER_FILE_SONG_LOOKUP_MAX 32
+
+/* Discoverers shared by on-demand tags requests and timeout of a request */
+#define MELO_BROWSER_FILE_DISCOVERERS 2
+#define MELO_BROWSER_FILE_DISCOVER_TIMEOUT (5 * GST_SECOND)
+
+/* Workers reading tags of files listed with a caching tags mode */
+#define MELO_BROWSER_FILE_READERS 1
+
 /* File browser info */
 static MeloBrowserInfo melo_browser_file_info = {
   .name = "Browse files",
@@ -36,13 +53,43 @@ static MeloBrowserInfo melo_browser_file_info = {
   .tags_cache_support = FALSE,
 };
 
+/* Directory entry */
+typedef struct {
+  gchar *name;
+  gchar *full_name;
+  gboolean is_file;
+} MeloBrowserFileEntry;
+
+/* File to read in background */
+typedef struct {
+  GFile *file;
+  gchar *uri;
+  gint path_id;
+  gchar *name;
+} MeloBrowserFileRead;
+
+/* Sorted directory listing: valid until directory modification time changes */
+typedef struct {
+  gint ref_count;
+  gchar *uri;
+  guint64 mtime;
+  gint64 last_use;
+  guint count;
+  MeloBrowserFileEntry *entries;
+} MeloBrowserFileDir;
+
 static gint vms_cmp (GObject *a, GObject *b);
 static void vms_added(GVolumeMonitor *monitor, GObject *obj,
                       MeloBrowserFilePrivate *priv);
+static void melo_browser_file_add_volume (GObject *obj,
+                                          MeloBrowserFilePrivate *priv);
 static void vms_removed(GVolumeMonitor *monitor, GObject *obj,
                         MeloBrowserFilePrivate *priv);
 static void on_discovered (GstDiscoverer *discoverer, GstDiscovererInfo *info,
                            GError *error, gpointer user_data);
+static void on_finished (GstDiscoverer *discoverer, gpointer user_data);
+static void melo_browser_file_read_func (gpointer data, gpointer user_data);
+static void melo_browser_file_dir_unref (MeloBrowserFileDir *dir);
 static void melo_browser_file_set_id (GObject *obj,
                                       MeloBrowserFilePrivate *priv);
 static const MeloBrowserInfo *melo_browser_file_get_info (MeloBrowser *browser);
@@ -71,9 +118,15 @@ struct _MeloBrowserFilePrivate {
   GMutex mutex;
   GList *vms;
   GHashTable *ids;
+  GMutex shortcuts_mutex;
   GHashTable *shortcuts;
   MeloFileDB *fdb;
   GstDiscoverer *discoverer;
+  gboolean discovering;
+  MeloDiscovererFile *discoverers;
+  GThreadPool *readers;
+  GMutex dirs_mutex;
+  GHashTable *dirs;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (MeloBrowserFile, melo_browser_file, MELO_TYPE_BROWSER)
@@ -85,13 +138,28 @@ melo_browser_file_finalize (GObject *gobject)
   MeloBrowserFilePrivate *priv =
                           melo_browser_file_get_instance_private (browser_file);
 
+  /* Wait end of background reads: they can add URIs to discoverer */
+  g_thread_pool_free (priv->readers, FALSE, TRUE);
+
   /* Stop discoverer and release it */
   gst_discoverer_stop (priv->discoverer);
   gst_object_unref (priv->discoverer);
 
+  /* Commit pending discovered tags */
+  if (priv->discovering)
+    melo_file_db_batch_end (priv->fdb);
+
+  /* Cancel pending tags requests and release discoverers */
+  melo_discoverer_file_cancel (priv->discoverers);
+  g_object_unref (priv->discoverers);
+
   /* Release volume monitor */
   g_object_unref (priv->monitor);
 
+  /* Free directory listings cache */
+  g_hash_table_unref (priv->dirs);
+  g_mutex_clear (&priv->dirs_mutex);
+
   /* Clear mutex */
   g_mutex_clear (&priv->mutex);
 
@@ -100,6 +168,7 @@ melo_browser_file_finalize (GObject *gobject)
   g_hash_table_remove_all (priv->ids);
   g_hash_table_unref (priv->shortcuts);
   g_hash_table_unref (priv->ids);
+  g_mutex_clear (&priv->shortcuts_mutex);
 
   /* Free volume and mount list */
   g_list_free_full (priv->vms, g_object_unref);
@@ -167,17 +236,33 @@ melo_browser_file_init (MeloBrowserFile *self)
   g_signal_connect (priv->monitor, "mount_removed",
                     (GCallback) vms_removed, priv);
 
-  /* Init Hash table for shortcuts */
+  /* Init Hash table for shortcuts: listings can run in parallel */
+  g_mutex_init (&priv->shortcuts_mutex);
   priv->shortcuts = g_hash_table_new_full (g_str_hash, g_str_equal,
                                            g_free, g_free);
 
+  /* Init directory listings cache: key is owned by listing */
+  g_mutex_init (&priv->dirs_mutex);
+  priv->dirs = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                      (GDestroyNotify)
+                                        melo_browser_file_dir_unref);
+
   /* Create a new Gstreamer discoverer for async tags discovering */
   priv->discoverer = gst_discoverer_new (GST_SECOND, NULL);
   gst_discoverer_start (priv->discoverer);
 
-  /* Subscribe to discovered event of discoverer */
+  /* Subscribe to discovered and finished events of discoverer */
   g_signal_connect (priv->discoverer, "discovered",
                     (GCallback) on_discovered, self);
+  g_signal_connect (priv->discoverer, "finished",
+                    (GCallback) on_finished, self);
+
+  /* Create discoverers pool for on-demand tags requests */
+  priv->discoverers = melo_discoverer_file_new (MELO_BROWSER_FILE_DISCOVERERS);
+
+  /* Create workers for background tags reading */
+  priv->readers = g_thread_pool_new (melo_browser_file_read_func, self,
+                                     MELO_BROWSER_FILE_READERS, FALSE, NULL);
 }
 
 void
@@ -190,7 +275,14 @@ melo_browser_file_set_local_path (MeloBrowserFile *bfile, const gchar *path)
 void
 melo_browser_file_set_db (MeloBrowserFile *bfile, MeloFileDB *fdb)
 {
-  bfile->priv->fdb = fdb;
+  MeloBrowserFilePrivate *priv = bfile->priv;
+
+  priv->fdb = fdb;
+
+  /* Register volumes already mounted */
+  g_mutex_lock (&priv->mutex);
+  g_list_foreach (priv->vms, (GFunc) melo_browser_file_add_volume, priv);
+  g_mutex_unlock (&priv->mutex);
 }
 
 static const MeloBrowserInfo *
@@ -243,6 +335,49 @@ vms_cmp (GObject *a, GObject *b)
   return ret;
 }
 
+static gchar *
+melo_browser_file_get_mount_root (GMount *mount)
+{
+  gchar *uri, *path;
+  GFile *root;
+
+  /* Get unescaped URI of mount root */
+  root = g_mount_get_root (mount);
+  uri = g_file_get_uri (root);
+  path = g_uri_unescape_string (uri, NULL);
+  g_object_unref (root);
+  g_free (uri);
+
+  return path;
+}
+
+static void
+melo_browser_file_add_volume (GObject *obj, MeloBrowserFilePrivate *priv)
+{
+  GVolume *vol;
+  gchar *uuid, *root;
+
+  /* Only mounts of a volume with an UUID are registered */
+  if (!priv->fdb || !G_IS_MOUNT (obj))
+    return;
+  uuid = g_mount_get_uuid (G_MOUNT (obj));
+  if (!uuid) {
+    vol = g_mount_get_volume (G_MOUNT (obj));
+    if (!vol)
+      return;
+    uuid = g_volume_get_identifier (vol, G_VOLUME_IDENTIFIER_KIND_UUID);
+    g_object_unref (vol);
+    if (!uuid)
+      return;
+  }
+
+  /* Songs of volume are available from its new mount point */
+  root = melo_browser_file_get_mount_root (G_MOUNT (obj));
+  melo_file_db_add_volume (priv->fdb, uuid, root);
+  g_free (root);
+  g_free (uuid);
+}
+
 static void
 vms_added(GVolumeMonitor *monitor, GObject *obj, MeloBrowserFilePrivate *priv)
 {
@@ -254,6 +389,9 @@ vms_added(GVolumeMonitor *monitor, GObject *obj, MeloBrowserFilePrivate *priv)
                                     (GCompareFunc) vms_cmp);
   melo_browser_file_set_id (obj, priv);
 
+  /* Register volume in database */
+  melo_browser_file_add_volume (obj, priv);
+
   /* Unlock volume/mount list */
   g_mutex_unlock (&priv->mutex);
 }
@@ -270,6 +408,15 @@ vms_removed(GVolumeMonitor *monitor, GObject *obj, MeloBrowserFilePrivate *priv)
   id = g_object_get_data (obj, MELO_BROWSER_FILE_ID);
   g_hash_table_remove (priv->ids, id);
 
+  /* Unregister volume from database */
+  if (priv->fdb && G_IS_MOUNT (obj)) {
+    gchar *root;
+
+    root = melo_browser_file_get_mount_root (G_MOUNT (obj));
+    melo_file_db_remove_volume (priv->fdb, root);
+    g_free (root);
+  }
+
   /* Remove from volume / mount list */
   priv->vms = g_list_remove (priv->vms, obj);
   g_object_unref (obj);
@@ -312,22 +459,13 @@ melo_brower_file_fix_path (const gchar *path)
 }
 
 static MeloTags *
-melo_browser_file_discover_tags (MeloBrowserFile *bfile,
-                                 GstDiscovererInfo *info, const gchar *path,
-                                 gint path_id, const gchar *file)
+melo_browser_file_add_tags (MeloBrowserFile *bfile, MeloTags *tags,
+                            const gchar *path, gint path_id,
+                            const gchar *file)
 {
   MeloBrowserFilePrivate *priv = bfile->priv;
-  const GstTagList *gtags;
-  MeloTags *tags = NULL;
   gchar *cover_file = NULL;
 
-  /* Get GstTagLsit */
-  gtags = gst_discoverer_info_get_tags (info);
-
-  /* Convert to MeloTags */
-  if (gtags)
-    tags = melo_tags_new_from_gst_tag_list (gtags, MELO_TAGS_FIELDS_FULL);
-
   /* Add file to database if tags are available */
   if (priv->fdb && tags) {
     if (path)
@@ -345,6 +483,41 @@ melo_browser_file_discover_tags (MeloBrowserFile *bfile,
   return tags;
 }
 
+static MeloTags *
+melo_browser_file_discover_tags (MeloBrowserFile *bfile,
+                                 GstDiscovererInfo *info, const gchar *path,
+                                 gint path_id, const gchar *file)
+{
+  MeloTags *tags;
+
+  /* Convert tags and stream details to MeloTags */
+  tags = melo_tags_new_from_gst_discoverer_info (info, MELO_TAGS_FIELDS_FULL);
+
+  /* Add file to database */
+  return melo_browser_file_add_tags (bfile, tags, path, path_id, file);
+}
+
+static MeloTags *
+melo_browser_file_read_tags (MeloBrowserFile *bfile, GFile *gfile,
+                             const gchar *path, gint path_id,
+                             const gchar *file)
+{
+  gchar *filename;
+  MeloTags *tags;
+
+  /* Only local files can be read directly */
+  filename = g_file_get_path (gfile);
+  if (!filename)
+    return NULL;
+
+  /* Read tags from file without discoverer */
+  tags = melo_tags_file_read (filename, MELO_TAGS_FIELDS_FULL);
+  g_free (filename);
+
+  /* Add file to database */
+  return melo_browser_file_add_tags (bfile, tags, path, path_id, file);
+}
+
 static void
 on_discovered (GstDiscoverer *discoverer, GstDiscovererInfo *info,
                GError *error, gpointer user_data)
@@ -370,23 +543,123 @@ on_discovered (GstDiscoverer *discoverer, GstDiscovererInfo *info,
   g_free (file);
 }
 
-static GList *
-melo_browser_file_list (MeloBrowserFile * bfile, GFile *dir,
-                        MeloBrowserTagsMode tags_mode,
-                        MeloTagsFields tags_fields)
+static void
+on_finished (GstDiscoverer *discoverer, gpointer user_data)
+{
+  MeloBrowserFile *bfile = user_data;
+  MeloBrowserFilePrivate *priv = bfile->priv;
+
+  /* Lock discovering flag */
+  g_mutex_lock (&priv->mutex);
+
+  /* All pending URIs have been discovered: commit tags to database */
+  if (priv->discovering) {
+    melo_file_db_batch_end (priv->fdb);
+    priv->discovering = FALSE;
+  }
+
+  /* Unlock discovering flag */
+  g_mutex_unlock (&priv->mutex);
+}
+
+static void
+melo_browser_file_discover_async (MeloBrowserFile *bfile, const gchar *uri)
+{
+  MeloBrowserFilePrivate *priv = bfile->priv;
+
+  /* Lock discovering flag */
+  g_mutex_lock (&priv->mutex);
+
+  /* Group all discovered tags until discoverer is finished */
+  if (!priv->discovering) {
+    melo_file_db_batch_begin (priv->fdb);
+    priv->discovering = TRUE;
+  }
+
+  /* Add URI to discoverer pending list */
+  gst_discoverer_discover_uri_async (priv->discoverer, uri);
+
+  /* Unlock discovering flag */
+  g_mutex_unlock (&priv->mutex);
+}
+
+static void
+melo_browser_file_read_func (gpointer data, gpointer user_data)
+{
+  MeloBrowserFileRead *task = (MeloBrowserFileRead *) data;
+  MeloBrowserFile *bfile = user_data;
+  MeloTags *tags;
+
+  /* Read tags from file and add them to database */
+  tags = melo_browser_file_read_tags (bfile, task->file, NULL, task->path_id,
+                                      task->name);
+  if (tags) {
+    melo_tags_unref (tags);
+  } else {
+    /* Format not supported: add URI to discoverer pending list */
+    melo_browser_file_discover_async (bfile, task->uri);
+  }
+
+  /* Free file */
+  g_object_unref (task->file);
+  g_free (task->uri);
+  g_free (task->name);
+  g_slice_free (MeloBrowserFileRead, task);
+}
+
+static void
+melo_browser_file_read_async (MeloBrowserFile *bfile, GFile *dir,
+                              const gchar *uri, gint path_id,
+                              const gchar *name)
+{
+  MeloBrowserFileRead *task;
+
+  /* Push file to background readers */
+  task = g_slice_new (MeloBrowserFileRead);
+  task->file = g_file_get_child (dir, name);
+  task->uri = g_strdup (uri);
+  task->path_id = path_id;
+  task->name = g_strdup (name);
+  g_thread_pool_push (bfile->priv->readers, task, NULL);
+}
+
+static void
+melo_browser_file_dir_unref (MeloBrowserFileDir *dir)
+{
+  guint i;
+
+  if (!g_atomic_int_dec_and_test (&dir->ref_count))
+    return;
+
+  /* Free entries */
+  for (i = 0; i < dir->count; i++) {
+    g_free (dir->entries[i].name);
+    g_free (dir->entries[i].full_name);
+  }
+  g_free (dir->entries);
+  g_free (dir->uri);
+  g_slice_free (MeloBrowserFileDir, dir);
+}
+
+static gint
+melo_browser_file_entry_cmp (const MeloBrowserFileEntry *a,
+                             const MeloBrowserFileEntry *b)
+{
+  /* Directories first, then files, sorted by name */
+  if (a->is_file != b->is_file)
+    return a->is_file ? 1 : -1;
+  return g_strcmp0 (a->name, b->name);
+}
+
+static MeloBrowserFileDir *
+melo_browser_file_dir_new (MeloBrowserFile *bfile, GFile *dir, gchar *uri,
+                           guint64 mtime)
 {
   MeloBrowserFilePrivate *priv = bfile->priv;
-  GstDiscoverer *disco = NULL;
+  MeloBrowserFileDir *d;
   GFileEnumerator *dir_enum;
   GFileInfo *info;
-  GList *dir_list = NULL;
-  GList *list = NULL;
-  gchar *path, *path_uri;
-  gint path_id;
-
-  /* Get details */
-  if (g_file_query_file_type (dir, 0, NULL) != G_FILE_TYPE_DIRECTORY)
-    return NULL;
+  GArray *entries;
 
   /* Get list of directory */
   dir_enum = g_file_enumerate_children (dir,
@@ -395,157 +668,341 @@ melo_browser_file_list (MeloBrowserFile * bfile, GFile *dir,
                                     G_FILE_ATTRIBUTE_STANDARD_TARGET_URI ","
                                     G_FILE_ATTRIBUTE_STANDARD_NAME,
                                     0, NULL, NULL);
-  if (!dir_enum)
+  if (!dir_enum) {
+    g_free (uri);
     return NULL;
+  }
 
-  /* Get path from directory */
-  path_uri = g_file_get_uri (dir);
-  path = g_uri_unescape_string (path_uri, NULL);
-  g_free (path_uri);
-
-  /* Get path ID for faster database find / insertion */
-  melo_file_db_get_path_id (priv->fdb, path, TRUE, &path_id);
-
-  /* Create list */
+  /* Create entry list */
+  entries = g_array_new (FALSE, FALSE, sizeof (MeloBrowserFileEntry));
   while ((info = g_file_enumerator_next_file (dir_enum, NULL, NULL))) {
-    MeloBrowserItem *item;
-    const gchar *itype;
-    gchar *name;
-    gchar *add = NULL;
+    MeloBrowserFileEntry entry;
     GFileType type;
-    GList **l;
 
-    /* Get item type */
+    /* Get entry type */
     type = g_file_info_get_file_type (info);
-    if (type == G_FILE_TYPE_REGULAR) {
-      itype = "file";
-      name = g_strdup (g_file_info_get_name (info));
-      add = g_strdup ("Add to playlist");
-      l = &list;
-    } else if (type == G_FILE_TYPE_DIRECTORY) {
-      itype = "directory";
-      name = g_strdup (g_file_info_get_name (info));
-      l = &dir_list;
+    if (type == G_FILE_TYPE_REGULAR || type == G_FILE_TYPE_DIRECTORY) {
+      entry.name = g_strdup (g_file_info_get_name (info));
+      entry.is_file = type == G_FILE_TYPE_REGULAR;
     } else if (type == G_FILE_TYPE_SHORTCUT ||
                type == G_FILE_TYPE_MOUNTABLE) {
-      const gchar *uri;
+      const gchar *target;
       gchar *sha1;
-      itype = "directory";
-      l = &dir_list;
-      uri = g_file_info_get_attribute_string (info,
-                                          G_FILE_ATTRIBUTE_STANDARD_TARGET_URI);
 
       /* Calculate sha1 from target URI */
+      target = g_file_info_get_attribute_string (info,
+                                          G_FILE_ATTRIBUTE_STANDARD_TARGET_URI);
       sha1 = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
-                                          (const guchar *) uri, strlen (uri));
+                                          (const guchar *) target,
+                                          strlen (target));
 
       /* Keep only MELO_BROWSER_FILE_ID_LENGTH first characters to create ID */
-      name = g_strndup (sha1, MELO_BROWSER_FILE_ID_LENGTH);
+      entry.name = g_strndup (sha1, MELO_BROWSER_FILE_ID_LENGTH);
+      entry.is_file = FALSE;
       g_free (sha1);
 
       /* Add shortcut to hash table */
-      if (!g_hash_table_lookup (priv->shortcuts, name))
-        g_hash_table_insert (priv->shortcuts, g_strdup (name), g_strdup (uri));
+      g_mutex_lock (&priv->shortcuts_mutex);
+      if (!g_hash_table_lookup (priv->shortcuts, entry.name))
+        g_hash_table_insert (priv->shortcuts, g_strdup (entry.name),
+                             g_strdup (target));
+      g_mutex_unlock (&priv->shortcuts_mutex);
     } else {
       g_object_unref (info);
       continue;
     }
 
-    /* Create a new browser item */
-    item = melo_browser_item_new (NULL, itype);
-    item->name = name;
-    item->full_name = g_strdup (g_file_info_get_display_name (info));
-    item->add = add;
+    /* Add entry */
+    entry.full_name = g_strdup (g_file_info_get_display_name (info));
+    g_array_append_val (entries, entry);
+    g_object_unref (info);
+  }
+  g_object_unref (dir_enum);
 
-    /* Insert into list */
-    if (type == G_FILE_TYPE_REGULAR) {
-      if (tags_mode != MELO_BROWSER_TAGS_MODE_NONE) {
-        MeloTags *tags = NULL;
-
-        /* Get file from database */
-        tags = melo_file_db_get_song (priv->fdb, G_OBJECT (bfile),
-                         tags_mode == MELO_BROWSER_TAGS_MODE_NONE_WITH_CACHING ?
-                                            MELO_TAGS_FIELDS_NONE : tags_fields,
-                         MELO_FILE_DB_FIELDS_PATH_ID, path_id,
-                         MELO_FILE_DB_FIELDS_FILE, name,
-                         MELO_FILE_DB_FIELDS_END);
-
-        /* No tags available in database */
-        if (!tags) {
-          gchar *file_uri;
-
-          /* Generate complete file URI */
-          file_uri = g_strdup_printf ("%s/%s", path, name);
-
-          if (tags_mode == MELO_BROWSER_TAGS_MODE_FULL) {
-            GstDiscovererInfo *info;
-
-            /* Create a new discoverer if not yet done */
-            if (!disco)
-              disco = gst_discoverer_new (GST_SECOND, NULL);
-
-            /* Get tags from URI */
-            info = gst_discoverer_discover_uri (disco, file_uri, NULL);
-            if (info) {
-              tags = melo_browser_file_discover_tags (bfile, info, NULL,
-                                                      path_id, name);
-              g_object_unref (info);
-            }
-          } else if (tags_mode == MELO_BROWSER_TAGS_MODE_NONE_WITH_CACHING ||
-                     tags_mode == MELO_BROWSER_TAGS_MODE_FULL_WITH_CACHING) {
-            /* Add URI to discoverer pending list */
-            gst_discoverer_discover_uri_async (priv->discoverer, file_uri);
-          }
-          g_free (file_uri);
-        }
-
-        /* Add tags to item */
-        if (tags) {
-          if (tags_mode == MELO_BROWSER_TAGS_MODE_NONE_WITH_CACHING)
-            melo_tags_unref (tags);
-          else
-            item->tags = tags;
-        }
+  /* Sort entries */
+  g_array_sort (entries, (GCompareFunc) melo_browser_file_entry_cmp);
+
+  /* Create directory listing */
+  d = g_slice_new (MeloBrowserFileDir);
+  d->ref_count = 1;
+  d->uri = uri;
+  d->mtime = mtime;
+  d->last_use = g_get_monotonic_time ();
+  d->count = entries->len;
+  d->entries = (MeloBrowserFileEntry *) g_array_free (entries, FALSE);
+
+  return d;
+}
+
+static MeloBrowserFileDir *
+melo_browser_file_get_dir (MeloBrowserFile *bfile, GFile *dir)
+{
+  MeloBrowserFilePrivate *priv = bfile->priv;
+  MeloBrowserFileDir *d;
+  GFileInfo *info;
+  guint64 mtime = 0;
+  gchar *uri;
+
+  /* Get details */
+  info = g_file_query_info (dir, G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                                 G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                                 G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            0, NULL, NULL);
+  if (!info)
+    return NULL;
+  if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY) {
+    g_object_unref (info);
+    return NULL;
+  }
+
+  /* Get modification time: virtual directories have none */
+  if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+    mtime = g_file_info_get_attribute_uint64 (info,
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED) *
+            G_USEC_PER_SEC +
+            g_file_info_get_attribute_uint32 (info,
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  g_object_unref (info);
+
+  /* Find directory listing in cache */
+  uri = g_file_get_uri (dir);
+  g_mutex_lock (&priv->dirs_mutex);
+  d = g_hash_table_lookup (priv->dirs, uri);
+  if (d && d->mtime == mtime) {
+    d->last_use = g_get_monotonic_time ();
+    g_atomic_int_inc (&d->ref_count);
+    g_mutex_unlock (&priv->dirs_mutex);
+    g_free (uri);
+    return d;
+  }
+  g_mutex_unlock (&priv->dirs_mutex);
+
+  /* Enumerate directory */
+  d = melo_browser_file_dir_new (bfile, dir, uri, mtime);
+  if (!d || !mtime)
+    return d;
+
+  /* Add to cache */
+  g_mutex_lock (&priv->dirs_mutex);
+  if (g_hash_table_size (priv->dirs) >= MELO_BROWSER_FILE_DIRS_CACHE_SIZE &&
+      !g_hash_table_contains (priv->dirs, d->uri)) {
+    MeloBrowserFileDir *oldest = NULL, *o;
+    GHashTableIter iter;
+
+    /* Remove least recently used listing */
+    g_hash_table_iter_init (&iter, priv->dirs);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &o))
+      if (!oldest || o->last_use < oldest->last_use)
+        oldest = o;
+    g_hash_table_remove (priv->dirs, oldest->uri);
+  }
+  g_atomic_int_inc (&d->ref_count);
+  g_hash_table_replace (priv->dirs, d->uri, d);
+  g_mutex_unlock (&priv->dirs_mutex);
+
+  return d;
+}
+
+static gboolean
+melo_browser_file_list_song (const gchar *path, const gchar *file, gint id,
+                             MeloTags *tags, gpointer user_data)
+{
+  GHashTable *songs = (GHashTable *) user_data;
+
+  /* Add song tags to hash table */
+  g_hash_table_insert (songs, g_strdup (file), tags);
+
+  return TRUE;
+}
+
+static MeloTags *
+melo_browser_file_list_tags (MeloBrowserFile *bfile, GFile *dir,
+                             const gchar *path, gint path_id,
+                             GHashTable *songs, const gchar *name,
+                             MeloBrowserTagsMode tags_mode,
+                             MeloTagsFields tags_fields)
+{
+  MeloBrowserFilePrivate *priv = bfile->priv;
+  MeloTags *tags;
+
+  /* Get file from database songs */
+  if (songs) {
+    tags = g_hash_table_lookup (songs, name);
+    if (tags)
+      melo_tags_ref (tags);
+  } else
+    tags = melo_file_db_get_song (priv->fdb, G_OBJECT (bfile), tags_fields,
+                                  MELO_FILE_DB_FIELDS_PATH_ID, path_id,
+                                  MELO_FILE_DB_FIELDS_FILE, name,
+                                  MELO_FILE_DB_FIELDS_END);
+
+  /* No tags available in database: try to read them from file, only when
+   * tags are returned by listing (cached tags are read in background)
+   */
+  if (!tags && tags_mode == MELO_BROWSER_TAGS_MODE_FULL) {
+    GFile *child = g_file_get_child (dir, name);
+
+    tags = melo_browser_file_read_tags (bfile, child, NULL, path_id, name);
+    g_object_unref (child);
+  }
+
+  /* Format not supported: use a discoverer */
+  if (!tags) {
+    gchar *file_uri;
+
+    /* Generate complete file URI */
+    file_uri = g_strdup_printf ("%s/%s", path, name);
+
+    if (tags_mode == MELO_BROWSER_TAGS_MODE_FULL) {
+      GstDiscovererInfo *info;
+
+      /* Get tags from URI */
+      info = melo_discoverer_file_discover (priv->discoverers, file_uri,
+                                          MELO_BROWSER_FILE_DISCOVER_TIMEOUT,
+                                          NULL);
+      if (info) {
+        tags = melo_browser_file_discover_tags (bfile, info, NULL, path_id,
+                                                name);
+        g_object_unref (info);
       }
-      list = g_list_prepend (list, item);
-    } else {
-      dir_list = g_list_prepend (dir_list, item);
+    } else if (tags_mode == MELO_BROWSER_TAGS_MODE_NONE_WITH_CACHING ||
+               tags_mode == MELO_BROWSER_TAGS_MODE_FULL_WITH_CACHING) {
+      /* Read tags in background or with discoverer */
+      melo_browser_file_read_async (bfile, dir, file_uri, path_id, name);
     }
-    g_object_unref (info);
+    g_free (file_uri);
   }
-  g_object_unref (dir_enum);
-  g_free (path);
 
-  /* Free discoverer */
-  if (disco)
-    gst_object_unref (disco);
+  /* Tags are only cached */
+  if (tags && tags_mode == MELO_BROWSER_TAGS_MODE_NONE_WITH_CACHING) {
+    melo_tags_unref (tags);
+    tags = NULL;
+  }
 
-  /* Sort both lists */
-  list = g_list_sort (list, (GCompareFunc) melo_browser_item_cmp);
-  dir_list = g_list_sort (dir_list, (GCompareFunc) melo_browser_item_cmp);
+  return tags;
+}
 
-  /* Merge both list */
-  return g_list_concat (dir_list, list);
+static gboolean
+melo_browser_file_list (MeloBrowserFile * bfile, GFile *dir,
+                        MeloBrowserList *list, gint offset, gint count,
+                        MeloBrowserTagsMode tags_mode,
+                        MeloTagsFields tags_fields)
+{
+  MeloBrowserFilePrivate *priv = bfile->priv;
+  GHashTable *songs = NULL;
+  MeloBrowserFileDir *d;
+  gchar *path = NULL;
+  gint path_id = 0;
+  guint i, end, files = 0;
+
+  /* Get sorted directory listing */
+  d = melo_browser_file_get_dir (bfile, dir);
+  if (!d)
+    return FALSE;
+  list->count = d->count;
+
+  /* Get requested page */
+  if (offset < 0)
+    offset = 0;
+  if ((guint) offset > d->count)
+    offset = d->count;
+  end = count < 0 || (guint) count > d->count - offset ? d->count :
+                                                          offset + count;
+  for (i = offset; i < end; i++)
+    if (d->entries[i].is_file)
+      files++;
+
+  /* Prepare tags lookup for files of the page */
+  if (files && tags_mode != MELO_BROWSER_TAGS_MODE_NONE) {
+    gchar *path_uri;
+
+    /* Get path from directory */
+    path_uri = g_file_get_uri (dir);
+    path = g_uri_unescape_string (path_uri, NULL);
+    g_free (path_uri);
+
+    /* Group all database insertions of the listing */
+    melo_file_db_batch_begin (priv->fdb);
+
+    /* Get path ID for faster database find / insertion */
+    melo_file_db_get_path_id (priv->fdb, path, TRUE, &path_id);
+
+    /* Cached tags are only checked */
+    if (tags_mode == MELO_BROWSER_TAGS_MODE_NONE_WITH_CACHING)
+      tags_fields = MELO_TAGS_FIELDS_NONE;
+
+    /* Get all songs of directory from database in a single request when the
+     * page is big enough.
+     */
+    if (files > MELO_BROWSER_FILE_SONG_LOOKUP_MAX) {
+      songs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                     (GDestroyNotify) melo_tags_unref);
+      melo_file_db_get_song_list (priv->fdb, G_OBJECT (bfile),
+                                  melo_browser_file_list_song, songs, 0, -1,
+                                  NULL, NULL, NULL, MELO_FILE_DB_SORT_NONE,
+                                  tags_fields, MELO_FILE_DB_FIELDS_PATH_ID,
+                                  path_id, MELO_FILE_DB_FIELDS_END);
+    }
+  }
+
+  /* Create items of page */
+  for (i = offset; i < end; i++) {
+    MeloBrowserFileEntry *entry = &d->entries[i];
+    MeloBrowserItem *item;
+
+    /* Create a new browser item */
+    item = melo_browser_item_new (NULL, entry->is_file ? "file" : "directory");
+    item->name = g_strdup (entry->name);
+    item->full_name = g_strdup (entry->full_name);
+    if (entry->is_file) {
+      item->add = g_strdup ("Add to playlist");
+
+      /* Add tags to item */
+      if (path)
+        item->tags = melo_browser_file_list_tags (bfile, dir, path, path_id,
+                                                  songs, entry->name,
+                                                  tags_mode, tags_fields);
+    }
+
+    /* Insert into list */
+    list->items = g_list_prepend (list->items, item);
+  }
+  list->items = g_list_reverse (list->items);
+  melo_browser_file_dir_unref (d);
+
+  /* Free database songs */
+  if (songs)
+    g_hash_table_unref (songs);
+
+  /* Commit database insertions */
+  if (path) {
+    melo_file_db_batch_end (priv->fdb);
+    g_free (path);
+  }
+
+  return TRUE;
 }
 
-static GList *
+static gboolean
 melo_browser_file_get_local_list (MeloBrowserFile *bfile, const gchar *uri,
-                                  MeloBrowserTagsMode tags_mode,
+                                  MeloBrowserList *list, gint offset,
+                                  gint count, MeloBrowserTagsMode tags_mode,
                                   MeloTagsFields tags_fields)
 {
+  gboolean ret;
   GFile *dir;
-  GList *list;
 
   /* Open directory */
   dir = g_file_new_for_uri (uri);
   if (!dir)
-    return NULL;
+    return FALSE;
 
   /* Get list from GFile */
-  list = melo_browser_file_list (bfile, dir, tags_mode, tags_fields);
+  ret = melo_browser_file_list (bfile, dir, list, offset, count, tags_mode,
+                                tags_fields);
   g_object_unref (dir);
 
-  return list;
+  return ret;
 }
 
 static GMount *
@@ -604,25 +1061,26 @@ melo_browser_file_get_mount (MeloBrowserFile *bfile, const gchar *path)
   return mount;
 }
 
-static GList *
+static gboolean
 melo_browser_file_get_volume_list (MeloBrowserFile *bfile, const gchar *path,
-                                   MeloBrowserTagsMode tags_mode,
+                                   MeloBrowserList *list, gint offset,
+                                   gint count, MeloBrowserTagsMode tags_mode,
                                    MeloTagsFields tags_fields)
 {
   GMount *mount;
   GFile *root, *dir;
-  GList *list;
+  gboolean ret;
 
   /* Get mount assocated to path */
   mount = melo_browser_file_get_mount (bfile, path);
   if (!mount)
-    return NULL;
+    return FALSE;
 
   /* Get root */
   root = g_mount_get_root (mount);
   if (!root) {
     g_object_unref (mount);
-    return NULL;
+    return FALSE;
   }
   g_object_unref (mount);
 
@@ -633,15 +1091,16 @@ melo_browser_file_get_volume_list (MeloBrowserFile *bfile, const gchar *path,
   dir = g_file_resolve_relative_path (root, path);
   if (!dir) {
     g_object_unref (root);
-    return NULL;
+    return FALSE;
   }
   g_object_unref (root);
 
   /* List files from our GFile  */
-  list = melo_browser_file_list (bfile, dir, tags_mode, tags_fields);
+  ret = melo_browser_file_list (bfile, dir, list, offset, count, tags_mode,
+                                tags_fields);
   g_object_unref (dir);
 
-  return list;
+  return ret;
 }
 
 static GList *
@@ -716,31 +1175,39 @@ static gchar *
 melo_browser_file_get_network_uri (MeloBrowserFile *bfile, const gchar *path)
 {
   MeloBrowserFilePrivate *priv = bfile->priv;
-  const gchar *shortcut = NULL;
+  const gchar *s = NULL;
+  gchar *shortcut;
   gint len;
 
+  /* Lock shortcuts list */
+  g_mutex_lock (&priv->shortcuts_mutex);
+
   /* Convert all shortcuts to final URI */
   len = strlen (path);
   while (len >= MELO_BROWSER_FILE_ID_LENGTH &&
          path[MELO_BROWSER_FILE_ID_LENGTH] == '/') {
-    const gchar *s;
+    const gchar *target;
     gchar *id;
 
     /* Get ID */
     id = g_strndup (path, MELO_BROWSER_FILE_ID_LENGTH);
 
     /* Find in shortcuts list */
-    s = g_hash_table_lookup (priv->shortcuts, id);
+    target = g_hash_table_lookup (priv->shortcuts, id);
     g_free (id);
-    if (!s)
+    if (!target)
       break;
 
     /* Save shortcut and look for next */
-    shortcut = s;
+    s = target;
     path += MELO_BROWSER_FILE_ID_LENGTH + 1;
     len -= MELO_BROWSER_FILE_ID_LENGTH + 1;
   }
 
+  /* Copy shortcut and unlock shortcuts list */
+  shortcut = g_strdup (s);
+  g_mutex_unlock (&priv->shortcuts_mutex);
+
   /* Path contains a shortcut */
   if (shortcut) {
     GError *error = NULL;
@@ -750,6 +1217,7 @@ melo_browser_file_get_network_uri (MeloBrowserFile *bfile, const gchar *path)
 
     /* Get file from shortcut */
     dir = g_file_new_for_uri (shortcut);
+    g_free (shortcut);
     if (!dir)
       return NULL;
 
@@ -793,31 +1261,33 @@ melo_browser_file_get_network_uri (MeloBrowserFile *bfile, const gchar *path)
   return g_strdup_printf ("network://%s", path);
 }
 
-static GList *
+static gboolean
 melo_browser_file_get_network_list (MeloBrowserFile *bfile, const gchar *path,
-                                    MeloBrowserTagsMode tags_mode,
+                                    MeloBrowserList *list, gint offset,
+                                    gint count, MeloBrowserTagsMode tags_mode,
                                     MeloTagsFields tags_fields)
 {
-  GList *list = NULL;
+  gboolean ret;
   GFile *dir;
   gchar *uri;
 
   /* Generate URI from path */
   uri = melo_browser_file_get_network_uri (bfile, path);
   if (!uri)
-    return NULL;
+    return FALSE;
 
   /* Get list from URI */
   dir = g_file_new_for_uri (uri);
   g_free (uri);
   if (!dir)
-    return NULL;
+    return FALSE;
 
   /* Get list from GFile */
-  list = melo_browser_file_list (bfile, dir, tags_mode, tags_fields);
+  ret = melo_browser_file_list (bfile, dir, list, offset, count, tags_mode,
+                                tags_fields);
   g_object_unref (dir);
 
-  return list;
+  return ret;
 }
 
 static MeloBrowserList *
@@ -857,43 +1327,43 @@ melo_browser_file_get_list (MeloBrowser *browser, const gchar *path,
 
     /* Add local volumes to list */
     list->items = melo_browser_file_list_volumes (bfile, list->items);
+
+    /* Keep only requested part of list */
+    l = list->items;
+    while (l != NULL) {
+      GList *next = l->next;
+
+      /* Remove item when not in requested part */
+      if (!count || list->count < offset) {
+        MeloBrowserItem *item = (MeloBrowserItem *) l->data;
+        list->items = g_list_delete_link (list->items, l);
+        melo_browser_item_free (item);
+      }
+      else
+        count--;
+
+      /* Update items count */
+      list->count++;
+      l = next;
+    }
   } else if (g_str_has_prefix (path, "local")) {
     gchar *uri;
 
     /* Get file path: "/local/" */
     path = melo_brower_file_fix_path (path + 5);
     uri = g_strdup_printf ("file:%s/%s", bfile->priv->local_path, path);
-    list->items = melo_browser_file_get_local_list (bfile, uri, tags_mode,
-                                                    tags_fields);
+    melo_browser_file_get_local_list (bfile, uri, list, offset, count,
+                                      tags_mode, tags_fields);
     g_free (uri);
   } else if (g_str_has_prefix (path, "network")) {
     /* Get file path: "/network/" */
-    list->items = melo_browser_file_get_network_list (bfile, path + 8,
-                                                      tags_mode, tags_fields);
+    melo_browser_file_get_network_list (bfile, path + 8, list, offset, count,
+                                        tags_mode, tags_fields);
   } else if (strlen (path) >= MELO_BROWSER_FILE_ID_LENGTH &&
              path[MELO_BROWSER_FILE_ID_LENGTH] == '/') {
     /* Volume path: "/VOLUME_ID/" */
-    list->items = melo_browser_file_get_volume_list (bfile, path, tags_mode,
-                                                     tags_fields);
-  }
-
-  /* Keep only requested part of list */
-  l = list->items;
-  while (l != NULL) {
-    GList *next = l->next;
-
-    /* Remove item when not in requested part */
-    if (!count || list->count < offset) {
-      MeloBrowserItem *item = (MeloBrowserItem *) l->data;
-      list->items = g_list_delete_link (list->items, l);
-      melo_browser_item_free (item);
-    }
-    else
-      count--;
-
-    /* Update items count */
-    list->count++;
-    l = next;
+    melo_browser_file_get_volume_list (bfile, path, list, offset, count,
+                                       tags_mode, tags_fields);
   }
 
   return list;
@@ -959,9 +1429,9 @@ melo_browser_file_get_tags_from_uri (MeloBrowserFile *bfile, const gchar *uri,
 {
   MeloBrowserFilePrivate *priv = bfile->priv;
   GstDiscovererInfo *info;
-  GstDiscoverer *disco;
   MeloTags *tags = NULL;
   gchar *dir, *file;
+  GFile *gfile;
 
   /* Get dirname and basename */
   dir = g_path_get_dirname (uri);
@@ -977,21 +1447,24 @@ melo_browser_file_get_tags_from_uri (MeloBrowserFile *bfile, const gchar *uri,
       goto end;
   }
 
-  /* Create a new discoverer */
-  disco = gst_discoverer_new (GST_SECOND, NULL);
-  if (!disco)
-    goto end;
+  /* Read tags from local file (URI is already unescaped) */
+  if (g_str_has_prefix (uri, "file://")) {
+    gfile = g_file_new_for_path (uri + 7);
+    tags = melo_browser_file_read_tags (bfile, gfile, dir, 0, file);
+    g_object_unref (gfile);
+    if (tags)
+      goto end;
+  }
 
-  /* Get tags from URI */
-  info = gst_discoverer_discover_uri (disco, uri, NULL);
+  /* Get tags from URI with a discoverer of pool */
+  info = melo_discoverer_file_discover (priv->discoverers, uri,
+                                        MELO_BROWSER_FILE_DISCOVER_TIMEOUT,
+                                        NULL);
   if (info) {
     tags = melo_browser_file_discover_tags (bfile, info, dir, 0, file);
     g_object_unref (info);
   }
 
-  /* Free discoverer */
-  gst_object_unref (disco);
-
 end:
   /* Free URI parts */
   g_free (file);
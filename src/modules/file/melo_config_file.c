@@ -30,6 +30,20 @@ static MeloConfigItem melo_config_global[] = {
     .def._string = "",
     .flags = MELO_CONFIG_FLAGS_READ_ONLY,
   },
+  {
+    .id = "scan_at_boot",
+    .name = "Scan local path at boot",
+    .type = MELO_CONFIG_TYPE_BOOLEAN,
+    .element = MELO_CONFIG_ELEMENT_CHECKBOX,
+    .def._boolean = TRUE,
+  },
+  {
+    .id = "scan_workers",
+    .name = "Scan workers (0 for all cores)",
+    .type = MELO_CONFIG_TYPE_INTEGER,
+    .element = MELO_CONFIG_ELEMENT_NUMBER,
+    .def._integer = 0,
+  },
 };
 
 static MeloConfigGroup melo_config_file[] = {
@@ -0,0 +1,257 @@
+/*
+ * melo_discoverer_file.c: Pool of GstDiscoverer for File module
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "melo_discoverer_file.h"
+
+/* Minimal timeout accepted by a GstDiscoverer */
+#define MELO_DISCOVERER_FILE_MIN_TIMEOUT (GST_SECOND / 10)
+
+/* Request waiting for a discoverer */
+typedef struct {
+  GstDiscoverer *disco;
+} MeloDiscovererFileWaiter;
+
+struct _MeloDiscovererFilePrivate {
+  guint size;
+  guint count;
+  gboolean closed;
+
+  /* Idle discoverers and waiting requests (protected by mutex) */
+  GMutex mutex;
+  GCond cond;
+  GQueue idle;
+  GQueue waiters;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (MeloDiscovererFile, melo_discoverer_file,
+                            G_TYPE_OBJECT)
+
+static void
+melo_discoverer_file_finalize (GObject *gobject)
+{
+  MeloDiscovererFile *disco = MELO_DISCOVERER_FILE (gobject);
+  MeloDiscovererFilePrivate *priv =
+                              melo_discoverer_file_get_instance_private (disco);
+
+  /* Free idle discoverers */
+  g_queue_foreach (&priv->idle, (GFunc) gst_object_unref, NULL);
+  g_queue_clear (&priv->idle);
+
+  /* Clear mutex and condition */
+  g_cond_clear (&priv->cond);
+  g_mutex_clear (&priv->mutex);
+
+  /* Chain up to the parent class */
+  G_OBJECT_CLASS (melo_discoverer_file_parent_class)->finalize (gobject);
+}
+
+static void
+melo_discoverer_file_class_init (MeloDiscovererFileClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  /* Add custom finalize() function */
+  object_class->finalize = melo_discoverer_file_finalize;
+}
+
+static void
+melo_discoverer_file_init (MeloDiscovererFile *self)
+{
+  MeloDiscovererFilePrivate *priv =
+                               melo_discoverer_file_get_instance_private (self);
+
+  self->priv = priv;
+
+  /* Init mutex, condition and queues */
+  g_mutex_init (&priv->mutex);
+  g_cond_init (&priv->cond);
+  g_queue_init (&priv->idle);
+  g_queue_init (&priv->waiters);
+}
+
+MeloDiscovererFile *
+melo_discoverer_file_new (guint size)
+{
+  MeloDiscovererFile *disco;
+
+  /* Create a new object */
+  disco = g_object_new (MELO_TYPE_DISCOVERER_FILE, NULL);
+  if (!disco)
+    return NULL;
+
+  /* Use one discoverer per core by default */
+  disco->priv->size = size ? size : g_get_num_processors ();
+
+  return disco;
+}
+
+static void
+melo_discoverer_file_wake (GCancellable *cancellable, gpointer user_data)
+{
+  MeloDiscovererFilePrivate *priv = (MeloDiscovererFilePrivate *) user_data;
+
+  /* Wake up waiting requests to check cancellation */
+  g_mutex_lock (&priv->mutex);
+  g_cond_broadcast (&priv->cond);
+  g_mutex_unlock (&priv->mutex);
+}
+
+static GstDiscoverer *
+melo_discoverer_file_acquire (MeloDiscovererFilePrivate *priv,
+                              gint64 end_time, GCancellable *cancellable)
+{
+  MeloDiscovererFileWaiter waiter = { NULL };
+  gboolean create = FALSE;
+
+  /* Wait for our turn */
+  g_mutex_lock (&priv->mutex);
+  g_queue_push_tail (&priv->waiters, &waiter);
+  while (!waiter.disco && !priv->closed &&
+         !g_cancellable_is_cancelled (cancellable)) {
+    /* First request gets an idle discoverer or creates a new one */
+    if (g_queue_peek_head (&priv->waiters) == &waiter) {
+      waiter.disco = g_queue_pop_head (&priv->idle);
+      if (waiter.disco)
+        break;
+      if (priv->count < priv->size) {
+        priv->count++;
+        create = TRUE;
+        break;
+      }
+    }
+
+    /* Wait for a released discoverer */
+    if (!g_cond_wait_until (&priv->cond, &priv->mutex, end_time))
+      break;
+  }
+
+  /* Leave queue and let next request check its turn */
+  g_queue_remove (&priv->waiters, &waiter);
+  g_cond_broadcast (&priv->cond);
+  g_mutex_unlock (&priv->mutex);
+
+  /* Create a new discoverer */
+  if (create) {
+    waiter.disco = gst_discoverer_new (MELO_DISCOVERER_FILE_MIN_TIMEOUT, NULL);
+    if (!waiter.disco) {
+      g_mutex_lock (&priv->mutex);
+      priv->count--;
+      g_cond_broadcast (&priv->cond);
+      g_mutex_unlock (&priv->mutex);
+    }
+  }
+
+  return waiter.disco;
+}
+
+static void
+melo_discoverer_file_release (MeloDiscovererFilePrivate *priv,
+                              GstDiscoverer *disco)
+{
+  MeloDiscovererFileWaiter *waiter;
+
+  g_mutex_lock (&priv->mutex);
+
+  /* Pool is closed: free discoverer */
+  if (priv->closed) {
+    priv->count--;
+    g_mutex_unlock (&priv->mutex);
+    gst_object_unref (disco);
+    return;
+  }
+
+  /* Give discoverer to first waiting request or keep it warm */
+  waiter = g_queue_pop_head (&priv->waiters);
+  if (waiter) {
+    waiter->disco = disco;
+    g_cond_broadcast (&priv->cond);
+  } else
+    g_queue_push_head (&priv->idle, disco);
+
+  g_mutex_unlock (&priv->mutex);
+}
+
+GstDiscovererInfo *
+melo_discoverer_file_discover (MeloDiscovererFile *disco, const gchar *uri,
+                               GstClockTime timeout, GCancellable *cancellable)
+{
+  MeloDiscovererFilePrivate *priv = disco->priv;
+  GstDiscovererInfo *info = NULL;
+  GstDiscoverer *d;
+  gulong handler = 0;
+  gint64 end_time, remaining;
+
+  /* Keep pool alive until discoverer is released: owner can cancel and
+   * release the pool while a request is running
+   */
+  g_object_ref (disco);
+
+  /* Get request deadline */
+  end_time = g_get_monotonic_time () + GST_TIME_AS_USECONDS (timeout);
+
+  /* Wake up request on cancellation */
+  if (cancellable)
+    handler = g_cancellable_connect (cancellable,
+                                     G_CALLBACK (melo_discoverer_file_wake),
+                                     priv, NULL);
+
+  /* Get a discoverer */
+  d = melo_discoverer_file_acquire (priv, end_time, cancellable);
+  if (cancellable)
+    g_cancellable_disconnect (cancellable, handler);
+  if (!d)
+    goto end;
+
+  /* Use remaining time for discovery */
+  remaining = end_time - g_get_monotonic_time ();
+  if (remaining <= 0 || g_cancellable_is_cancelled (cancellable)) {
+    melo_discoverer_file_release (priv, d);
+    goto end;
+  }
+  timeout = MAX (remaining * GST_USECOND, MELO_DISCOVERER_FILE_MIN_TIMEOUT);
+  g_object_set (d, "timeout", timeout, NULL);
+
+  /* Discover URI */
+  info = gst_discoverer_discover_uri (d, uri, NULL);
+  melo_discoverer_file_release (priv, d);
+
+  /* Request has been cancelled during discovery */
+  if (info && g_cancellable_is_cancelled (cancellable)) {
+    g_object_unref (info);
+    info = NULL;
+  }
+
+end:
+  g_object_unref (disco);
+  return info;
+}
+
+void
+melo_discoverer_file_cancel (MeloDiscovererFile *disco)
+{
+  MeloDiscovererFilePrivate *priv = disco->priv;
+
+  /* Close pool and wake up all waiting requests */
+  g_mutex_lock (&priv->mutex);
+  priv->closed = TRUE;
+  g_cond_broadcast (&priv->cond);
+  g_mutex_unlock (&priv->mutex);
+}
@@ -0,0 +1,71 @@
+/*
+ * melo_discoverer_file.h: Pool of GstDiscoverer for File module
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __MELO_DISCOVERER_FILE_H__
+#define __MELO_DISCOVERER_FILE_H__
+
+#include <gio/gio.h>
+#include <gst/pbutils/pbutils.h>
+
+G_BEGIN_DECLS
+
+#define MELO_TYPE_DISCOVERER_FILE             (melo_discoverer_file_get_type ())
+#define MELO_DISCOVERER_FILE(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), MELO_TYPE_DISCOVERER_FILE, MeloDiscovererFile))
+#define MELO_IS_DISCOVERER_FILE(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MELO_TYPE_DISCOVERER_FILE))
+#define MELO_DISCOVERER_FILE_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), MELO_TYPE_DISCOVERER_FILE, MeloDiscovererFileClass))
+#define MELO_IS_DISCOVERER_FILE_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), MELO_TYPE_DISCOVERER_FILE))
+#define MELO_DISCOVERER_FILE_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), MELO_TYPE_DISCOVERER_FILE, MeloDiscovererFileClass))
+
+typedef struct _MeloDiscovererFile MeloDiscovererFile;
+typedef struct _MeloDiscovererFileClass MeloDiscovererFileClass;
+typedef struct _MeloDiscovererFilePrivate MeloDiscovererFilePrivate;
+
+struct _MeloDiscovererFile {
+  GObject parent_instance;
+
+  /*< private >*/
+  MeloDiscovererFilePrivate *priv;
+};
+
+struct _MeloDiscovererFileClass {
+  GObjectClass parent_class;
+};
+
+GType melo_discoverer_file_get_type (void);
+
+/* Create a pool of at most size discoverers (one per core when size is 0) */
+MeloDiscovererFile *melo_discoverer_file_new (guint size);
+
+/* Discover an URI with the first available discoverer: requests are served in
+ * order and the timeout covers the wait for a discoverer and the discovery.
+ * A cancelled request returns NULL as soon as possible.
+ */
+GstDiscovererInfo *melo_discoverer_file_discover (MeloDiscovererFile *disco,
+                                                  const gchar *uri,
+                                                  GstClockTime timeout,
+                                                  GCancellable *cancellable);
+
+/* Cancel all pending requests (used before releasing pool) */
+void melo_discoverer_file_cancel (MeloDiscovererFile *disco);
+
+G_END_DECLS
+
+#endif /* __MELO_DISCOVERER_FILE_H__ */
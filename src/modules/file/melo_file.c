@@ -26,6 +26,8 @@
 #include "melo_player_file.h"
 #include "melo_playlist_simple.h"
 #include "melo_config_file.h"
+#include "melo_scanner_file.h"
+#include "melo_file_jsonrpc.h"
 
 /* Module file info */
 static MeloModuleInfo melo_file_info = {
@@ -39,6 +41,7 @@ static const MeloModuleInfo *melo_file_get_info (MeloModule *module);
 
 struct _MeloFilePrivate {
   MeloFileDB *fdb;
+  MeloScannerFile *scanner;
   MeloBrowser *files;
   MeloBrowser *library;
   MeloPlayer *player;
@@ -71,6 +74,11 @@ melo_file_finalize (GObject *gobject)
     g_object_unref (priv->files);
   }
 
+  if (priv->scanner) {
+    melo_file_jsonrpc_unregister_methods ();
+    g_object_unref (priv->scanner);
+  }
+
   if (priv->fdb)
     g_object_unref (priv->fdb);
 
@@ -144,6 +152,8 @@ melo_file_constructed (GObject *gobject)
 {
   MeloFilePrivate *priv = melo_file_get_instance_private (MELO_FILE (gobject));
   gchar *path, *db;
+  gboolean boot;
+  gint64 workers;
 
   /* Open media database */
   db = melo_module_build_path (MELO_MODULE (gobject), "media.db");
@@ -156,6 +166,22 @@ melo_file_constructed (GObject *gobject)
   if (priv->fdb) {
     melo_browser_file_set_db (MELO_BROWSER_FILE (priv->files), priv->fdb);
     melo_library_file_set_db (MELO_LIBRARY_FILE (priv->library), priv->fdb);
+
+    /* Create library scanner */
+    if (!melo_config_get_integer (priv->config, "global", "scan_workers",
+                                  &workers) || workers < 0)
+      workers = 0;
+    priv->scanner = melo_scanner_file_new (priv->fdb, workers);
+  }
+
+  /* Register scanner methods and scan local path at boot */
+  if (priv->scanner &&
+      melo_config_get_string (priv->config, "global", "local_path", &path)) {
+    melo_file_jsonrpc_register_methods (priv->scanner, path);
+    if (melo_config_get_boolean (priv->config, "global", "scan_at_boot",
+                                 &boot) && boot)
+      melo_scanner_file_start (priv->scanner, path);
+    g_free (path);
   }
 
   /* Chain up to the parent class */
@@ -19,14 +19,18 @@
  * Boston, MA  02110-1301, USA.
  */
 
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
 #include <sqlite3.h>
 
 #include "melo_file_db.h"
 
-#define MELO_FILE_DB_VERSION 4
-#define MELO_FILE_DB_VERSION_STR "4"
+#define MELO_FILE_DB_VERSION 11
 
-/* Table creation */
+/* Table creation: initial schema, upgraded to last version after creation */
+#define MELO_FILE_DB_CREATE_VERSION 4
 #define MELO_FILE_DB_CREATE \
   "CREATE TABLE song (" \
   "        'title'         TEXT," \
@@ -56,13 +60,242 @@
   "CREATE TABLE path (" \
   "        'path'          TEXT NOT NULL UNIQUE" \
   ");" \
-  "PRAGMA user_version = " MELO_FILE_DB_VERSION_STR ";"
+  "PRAGMA user_version = 4;"
+
+/* Version 5: add indexes for file lookup and artist / album / genre lists */
+#define MELO_FILE_DB_UPGRADE_V5 \
+  "CREATE INDEX IF NOT EXISTS song_path_file ON song (path_id, file);" \
+  "CREATE INDEX IF NOT EXISTS song_artist ON song (artist_id);" \
+  "CREATE INDEX IF NOT EXISTS song_album ON song (album_id);" \
+  "CREATE INDEX IF NOT EXISTS song_genre ON song (genre_id);"
+
+/* Remove songs from full-text search index */
+#define MELO_FILE_DB_FTS_TRIGGER \
+  "CREATE TRIGGER IF NOT EXISTS song_fts_remove AFTER DELETE ON song BEGIN " \
+  "        DELETE FROM song_fts WHERE rowid = OLD.rowid;" \
+  "END;"
+
+/* Version 6: add full-text search index on songs, filled with current songs.
+ * It is only created when SQLite is built with FTS5: a simple search on
+ * names is used otherwise.
+ */
+#define MELO_FILE_DB_UPGRADE_V6_FTS \
+  "CREATE VIRTUAL TABLE song_fts USING fts5 (" \
+  "        title_text, artist_text, album_text, genre_text," \
+  "        tokenize = 'unicode61 remove_diacritics 1'," \
+  "        prefix = '2 3'" \
+  ");" \
+  "INSERT INTO song_fts (song_fts, rank) " \
+  "        VALUES ('rank', 'bm25(10.0, 5.0, 5.0, 1.0)');" \
+  "INSERT INTO song_fts (rowid,title_text,artist_text,album_text,genre_text) " \
+  "        SELECT song.rowid,IFNULL(title,file),artist,album,genre FROM song" \
+  "        LEFT JOIN artist ON song.artist_id = artist.rowid" \
+  "        LEFT JOIN album ON song.album_id = album.rowid" \
+  "        LEFT JOIN genre ON song.genre_id = genre.rowid;" \
+  MELO_FILE_DB_FTS_TRIGGER
+
+/* Version 7: add indexed sort keys, filled with melo_sort_key() function */
+#define MELO_FILE_DB_UPGRADE_V7 \
+  "ALTER TABLE song ADD COLUMN title_key TEXT NOT NULL DEFAULT '';" \
+  "ALTER TABLE artist ADD COLUMN artist_key TEXT NOT NULL DEFAULT '';" \
+  "ALTER TABLE album ADD COLUMN album_key TEXT NOT NULL DEFAULT '';" \
+  "ALTER TABLE genre ADD COLUMN genre_key TEXT NOT NULL DEFAULT '';" \
+  "UPDATE song SET title_key = melo_sort_key (IFNULL(title,file));" \
+  "UPDATE artist SET artist_key = melo_sort_key (artist);" \
+  "UPDATE album SET album_key = melo_sort_key (album);" \
+  "UPDATE genre SET genre_key = melo_sort_key (genre);" \
+  "DROP INDEX IF EXISTS song_artist;" \
+  "DROP INDEX IF EXISTS song_album;" \
+  "DROP INDEX IF EXISTS song_genre;" \
+  "CREATE INDEX song_title ON song (title_key);" \
+  "CREATE INDEX song_artist ON song (artist_id, title_key);" \
+  "CREATE INDEX song_album ON song (album_id, title_key);" \
+  "CREATE INDEX song_genre ON song (genre_id, title_key);" \
+  "CREATE INDEX artist_sort ON artist (artist_key);" \
+  "CREATE INDEX album_sort ON album (album_key);" \
+  "CREATE INDEX genre_sort ON genre (genre_key);"
+
+/* Version 8: add aggregates (song count and last date) on artist, album and
+ * genre, and global counts, all maintained by triggers on song.
+ */
+#define MELO_FILE_DB_UPGRADE_AGGREGATE(t) \
+  "ALTER TABLE " t " ADD COLUMN song_count INTEGER NOT NULL DEFAULT 0;" \
+  "ALTER TABLE " t " ADD COLUMN song_date INTEGER NOT NULL DEFAULT 0;" \
+  "UPDATE " t " SET " \
+  "        song_count = (SELECT COUNT(*) FROM song " \
+  "                      WHERE " t "_id = " t ".rowid)," \
+  "        song_date = (SELECT IFNULL(MAX(date),0) FROM song " \
+  "                     WHERE " t "_id = " t ".rowid);" \
+  "CREATE TRIGGER " t "_insert AFTER INSERT ON " t " BEGIN " \
+  "        UPDATE stats SET " t "s = " t "s + 1;" \
+  "END;" \
+  "CREATE TRIGGER " t "_delete AFTER DELETE ON " t " BEGIN " \
+  "        UPDATE stats SET " t "s = " t "s - 1;" \
+  "END;"
+#define MELO_FILE_DB_AGGREGATE_ADD(t) \
+  "UPDATE " t " SET song_count = song_count + 1, " \
+  "        song_date = MAX(song_date, NEW.date) WHERE rowid = NEW." t "_id;"
+#define MELO_FILE_DB_AGGREGATE_REMOVE(t) \
+  "UPDATE " t " SET song_count = song_count - 1, " \
+  "        song_date = (SELECT IFNULL(MAX(date),0) FROM song " \
+  "                     WHERE " t "_id = OLD." t "_id) " \
+  "        WHERE rowid = OLD." t "_id;"
+#define MELO_FILE_DB_UPGRADE_V8 \
+  "CREATE TABLE stats (" \
+  "        'songs'         INTEGER," \
+  "        'artists'       INTEGER," \
+  "        'albums'        INTEGER," \
+  "        'genres'        INTEGER" \
+  ");" \
+  "INSERT INTO stats VALUES ((SELECT COUNT(*) FROM song)," \
+  "        (SELECT COUNT(*) FROM artist), (SELECT COUNT(*) FROM album)," \
+  "        (SELECT COUNT(*) FROM genre));" \
+  MELO_FILE_DB_UPGRADE_AGGREGATE ("artist") \
+  MELO_FILE_DB_UPGRADE_AGGREGATE ("album") \
+  MELO_FILE_DB_UPGRADE_AGGREGATE ("genre") \
+  "CREATE TRIGGER song_insert AFTER INSERT ON song BEGIN " \
+  "        UPDATE stats SET songs = songs + 1;" \
+  MELO_FILE_DB_AGGREGATE_ADD ("artist") \
+  MELO_FILE_DB_AGGREGATE_ADD ("album") \
+  MELO_FILE_DB_AGGREGATE_ADD ("genre") \
+  "END;" \
+  "CREATE TRIGGER song_delete AFTER DELETE ON song BEGIN " \
+  "        UPDATE stats SET songs = songs - 1;" \
+  MELO_FILE_DB_AGGREGATE_REMOVE ("artist") \
+  MELO_FILE_DB_AGGREGATE_REMOVE ("album") \
+  MELO_FILE_DB_AGGREGATE_REMOVE ("genre") \
+  "END;" \
+  "CREATE TRIGGER song_update " \
+  "        AFTER UPDATE OF artist_id, album_id, genre_id, date ON song BEGIN " \
+  MELO_FILE_DB_AGGREGATE_REMOVE ("artist") \
+  MELO_FILE_DB_AGGREGATE_REMOVE ("album") \
+  MELO_FILE_DB_AGGREGATE_REMOVE ("genre") \
+  MELO_FILE_DB_AGGREGATE_ADD ("artist") \
+  MELO_FILE_DB_AGGREGATE_ADD ("album") \
+  MELO_FILE_DB_AGGREGATE_ADD ("genre") \
+  "END;"
+
+/* Version 9: garbage-collect empty paths and unused artists, albums and
+ * genres when songs are removed.
+ */
+#define MELO_FILE_DB_GC(t) \
+  "        DELETE FROM " t " WHERE rowid = OLD." t "_id AND NOT EXISTS " \
+  "                (SELECT 1 FROM song WHERE " t "_id = OLD." t "_id);"
+#define MELO_FILE_DB_UPGRADE_V9 \
+  "CREATE TRIGGER song_remove AFTER DELETE ON song BEGIN " \
+  MELO_FILE_DB_GC ("path") \
+  MELO_FILE_DB_GC ("artist") \
+  MELO_FILE_DB_GC ("album") \
+  MELO_FILE_DB_GC ("genre") \
+  "END;"
+
+/* Version 10: add stream details on songs and total duration on artist, album,
+ * genre and globally. Stream details can only be read from the files, so all
+ * songs are marked as outdated: the next scan is a one-time full rescan of the
+ * library, which also fills the aggregates through the update trigger.
+ */
+#define MELO_FILE_DB_DURATION_ADD(t) \
+  "UPDATE " t " SET song_duration = song_duration + NEW.duration " \
+  "        WHERE rowid = NEW." t "_id;"
+#define MELO_FILE_DB_DURATION_REMOVE(t) \
+  "UPDATE " t " SET song_duration = song_duration - OLD.duration " \
+  "        WHERE rowid = OLD." t "_id;"
+#define MELO_FILE_DB_UPGRADE_DURATION(t) \
+  "ALTER TABLE " t " ADD COLUMN song_duration INTEGER NOT NULL DEFAULT 0;"
+#define MELO_FILE_DB_UPGRADE_V10 \
+  "ALTER TABLE song ADD COLUMN duration INTEGER NOT NULL DEFAULT 0;" \
+  "ALTER TABLE song ADD COLUMN bitrate INTEGER NOT NULL DEFAULT 0;" \
+  "ALTER TABLE song ADD COLUMN samplerate INTEGER NOT NULL DEFAULT 0;" \
+  "ALTER TABLE song ADD COLUMN channels INTEGER NOT NULL DEFAULT 0;" \
+  "ALTER TABLE stats ADD COLUMN duration INTEGER NOT NULL DEFAULT 0;" \
+  MELO_FILE_DB_UPGRADE_DURATION ("artist") \
+  MELO_FILE_DB_UPGRADE_DURATION ("album") \
+  MELO_FILE_DB_UPGRADE_DURATION ("genre") \
+  "UPDATE song SET timestamp = 0;" \
+  "CREATE TRIGGER song_duration_insert AFTER INSERT ON song BEGIN " \
+  "        UPDATE stats SET duration = duration + NEW.duration;" \
+  MELO_FILE_DB_DURATION_ADD ("artist") \
+  MELO_FILE_DB_DURATION_ADD ("album") \
+  MELO_FILE_DB_DURATION_ADD ("genre") \
+  "END;" \
+  "CREATE TRIGGER song_duration_delete AFTER DELETE ON song BEGIN " \
+  "        UPDATE stats SET duration = duration - OLD.duration;" \
+  MELO_FILE_DB_DURATION_REMOVE ("artist") \
+  MELO_FILE_DB_DURATION_REMOVE ("album") \
+  MELO_FILE_DB_DURATION_REMOVE ("genre") \
+  "END;" \
+  "CREATE TRIGGER song_duration_update " \
+  "        AFTER UPDATE OF artist_id, album_id, genre_id, duration ON song " \
+  "        BEGIN " \
+  "        UPDATE stats " \
+  "        SET duration = duration - OLD.duration + NEW.duration;" \
+  MELO_FILE_DB_DURATION_REMOVE ("artist") \
+  MELO_FILE_DB_DURATION_REMOVE ("album") \
+  MELO_FILE_DB_DURATION_REMOVE ("genre") \
+  MELO_FILE_DB_DURATION_ADD ("artist") \
+  MELO_FILE_DB_DURATION_ADD ("album") \
+  MELO_FILE_DB_DURATION_ADD ("genre") \
+  "END;"
+
+/* Version 11: path IDs are never reused, since a removed path ID can still be
+ * held by scanner or browser, and artists, albums, genres and paths no more
+ * used after a song update are also garbage-collected.
+ */
+#define MELO_FILE_DB_UPGRADE_V11 \
+  "DROP TRIGGER song_remove;" \
+  "CREATE TABLE path_v11 (" \
+  "        'id'            INTEGER PRIMARY KEY AUTOINCREMENT," \
+  "        'path'          TEXT NOT NULL UNIQUE" \
+  ");" \
+  "INSERT INTO path_v11 (id, path) SELECT rowid, path FROM path;" \
+  "DROP TABLE path;" \
+  "ALTER TABLE path_v11 RENAME TO path;" \
+  "CREATE TRIGGER song_remove AFTER DELETE ON song BEGIN " \
+  MELO_FILE_DB_GC ("path") \
+  MELO_FILE_DB_GC ("artist") \
+  MELO_FILE_DB_GC ("album") \
+  MELO_FILE_DB_GC ("genre") \
+  "END;" \
+  "CREATE TRIGGER song_update_gc " \
+  "        AFTER UPDATE OF artist_id, album_id, genre_id, path_id ON song " \
+  "        BEGIN " \
+  MELO_FILE_DB_GC ("path") \
+  MELO_FILE_DB_GC ("artist") \
+  MELO_FILE_DB_GC ("album") \
+  MELO_FILE_DB_GC ("genre") \
+  "END;"
+
+/* Schema upgrades: entry N upgrades database from version N to N+1 */
+static const gchar *melo_file_db_upgrades[MELO_FILE_DB_VERSION] = {
+  [4] = MELO_FILE_DB_UPGRADE_V5,
+  [6] = MELO_FILE_DB_UPGRADE_V7,
+  [7] = MELO_FILE_DB_UPGRADE_V8,
+  [8] = MELO_FILE_DB_UPGRADE_V9,
+  [9] = MELO_FILE_DB_UPGRADE_V10,
+  [10] = MELO_FILE_DB_UPGRADE_V11,
+};
+
+/* Schema upgrades only applied when full-text search is available */
+static const gchar *melo_file_db_upgrades_fts[MELO_FILE_DB_VERSION] = {
+  [5] = MELO_FILE_DB_UPGRADE_V6_FTS,
+};
+
+/* Check FTS5 support of SQLite library */
+#define MELO_FILE_DB_PROBE_FTS \
+  "CREATE VIRTUAL TABLE temp.melo_fts_probe USING fts5 (text);" \
+  "DROP TABLE temp.melo_fts_probe;"
+
+/* Check full-text search index has been created */
+#define MELO_FILE_DB_HAS_FTS \
+  "SELECT COUNT(*) FROM sqlite_master WHERE name = 'song_fts';"
 
 /* Get database version */
 #define MELO_FILE_DB_GET_VERSION "PRAGMA user_version;"
 
 /* Clean database */
 #define MELO_FILE_DB_CLEAN \
+  "DROP TABLE IF EXISTS stats;" \
+  "DROP TABLE IF EXISTS song_fts;" \
   "DROP TABLE IF EXISTS song;" \
   "DROP TABLE IF EXISTS artist;" \
   "DROP TABLE IF EXISTS album;" \
@@ -78,27 +311,146 @@ typedef enum {
   MELO_FILE_DB_TYPE_DATE,
 } MeloFileDBType;
 
+/* Sort columns: names are sorted with their precomputed (and indexed) keys */
 static const gchar *melo_file_db_order_string[] = {
-  [MELO_FILE_DB_SORT_FILE] = "file",
-  [MELO_FILE_DB_SORT_TITLE] = "title",
-  [MELO_FILE_DB_SORT_ARTIST] = "artist",
-  [MELO_FILE_DB_SORT_ALBUM] = "album",
-  [MELO_FILE_DB_SORT_GENRE] = "genre",
+  [MELO_FILE_DB_SORT_FILE] = "file COLLATE NOCASE",
+  [MELO_FILE_DB_SORT_TITLE] = "title_key",
+  [MELO_FILE_DB_SORT_ARTIST] = "artist_key",
+  [MELO_FILE_DB_SORT_ALBUM] = "album_key",
+  [MELO_FILE_DB_SORT_GENRE] = "genre_key",
   [MELO_FILE_DB_SORT_DATE] = "date",
   [MELO_FILE_DB_SORT_TRACK] = "track",
   [MELO_FILE_DB_SORT_TRACKS] = "tracks",
+  [MELO_FILE_DB_SORT_RANK] = "rank",
 };
 
+/* Statements cache */
+#define MELO_FILE_DB_STMT_CACHE_SIZE 64
+
+/* Read-only connections pool */
+#define MELO_FILE_DB_READER_COUNT 4
+#define MELO_FILE_DB_READER_TIMEOUT (500 * G_TIME_SPAN_MILLISECOND)
+
+/* Time to wait on a locked database (in ms) */
+#define MELO_FILE_DB_BUSY_TIMEOUT 5000
+
+/* Maximum backups of unusable databases: an older one is never overwritten */
+#define MELO_FILE_DB_BACKUP_MAX 100
+
+/* Numbers are padded in sort keys to sort them by value */
+#define MELO_FILE_DB_SORT_KEY_DIGITS 10
+
+/* Maximum names kept in an ID cache before it is flushed */
+#define MELO_FILE_DB_ID_CACHE_SIZE 10000
+
+/* Maximum rows written in a batch transaction before an intermediate commit */
+#define MELO_FILE_DB_BATCH_SIZE 2000
+
+/* Maximum time (in ms) rows of a batch are kept uncommitted */
+#define MELO_FILE_DB_BATCH_DELAY 1000
+
+/* Maximum covers queued for writing: next ones are written by caller */
+#define MELO_FILE_DB_COVER_QUEUE 32
+
+/* Name to ID requests */
+#define MELO_FILE_DB_SELECT_ID(t) "SELECT rowid FROM " t " WHERE " t " = ?"
+#define MELO_FILE_DB_INSERT_ID(t) "INSERT INTO " t " (" t ") VALUES (?)"
+#define MELO_FILE_DB_INSERT_ID_KEY(t) \
+  "INSERT INTO " t " (" t "," t "_key) VALUES (?,?)"
+
+/* Song requests */
+#define MELO_FILE_DB_SELECT_SONG \
+  "SELECT rowid,timestamp,artist_id,album_id,genre_id FROM song " \
+  "WHERE path_id = ? AND file = ?"
+#define MELO_FILE_DB_INSERT_SONG \
+  "INSERT INTO song (title,artist_id,album_id,genre_id,date,track,tracks," \
+  "cover,duration,bitrate,samplerate,channels,file,path_id,timestamp," \
+  "title_key) VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)"
+#define MELO_FILE_DB_UPDATE_SONG \
+  "UPDATE song SET title = ?, artist_id = ?, album_id = ?, genre_id = ?, " \
+  "date = ?, track = ?, tracks = ?, cover = ?, duration = ?, bitrate = ?, " \
+  "samplerate = ?, channels = ?, timestamp = ?, title_key = ? WHERE rowid = ?"
+#define MELO_FILE_DB_INDEX_SONG \
+  "INSERT OR REPLACE INTO song_fts (rowid,title_text,artist_text,album_text," \
+  "genre_text) VALUES (?,?,?,?,?)"
+#define MELO_FILE_DB_SELECT_FILES "SELECT file FROM song WHERE path_id = ?"
+#define MELO_FILE_DB_REMOVE_SONG \
+  "DELETE FROM song WHERE path_id = ? AND file = ?"
+
+/* Path and sub-paths requests: sub-paths are found with the path index */
+#define MELO_FILE_DB_SUB_PATHS \
+  "path = ?1 OR (path >= ?1 || '/' AND path < ?1 || '0')"
+#define MELO_FILE_DB_SELECT_PATHS \
+  "SELECT path FROM path WHERE " MELO_FILE_DB_SUB_PATHS
+#define MELO_FILE_DB_REMOVE_PATH_SONGS \
+  "DELETE FROM song WHERE path_id IN " \
+  "(SELECT rowid FROM path WHERE " MELO_FILE_DB_SUB_PATHS ")"
+#define MELO_FILE_DB_REMOVE_PATH \
+  "DELETE FROM path WHERE " MELO_FILE_DB_SUB_PATHS
+#define MELO_FILE_DB_MOVE_PATHS \
+  "UPDATE OR IGNORE path SET path = ?2 || substr (path, length (?1) + 1) " \
+  "WHERE " MELO_FILE_DB_SUB_PATHS
+
+/* Volume paths are stored with this prefix followed by the volume UUID */
+#define MELO_FILE_DB_VOLUME_PREFIX "volume://"
+
+/* Mounted volume: paths under its root are stored relative to its key */
+typedef struct {
+  gchar *key;
+  gchar *root;
+} MeloFileDBVolume;
+
+/* Cover file to write by the cover writer thread */
+typedef struct {
+  gchar *name;
+  gchar *path;
+  GBytes *data;
+} MeloFileDBCover;
+
+/* Database connection with its compiled statements cache */
+typedef struct {
+  sqlite3 *db;
+  GHashTable *stmts;
+} MeloFileDBConn;
+
 struct _MeloFileDBPrivate {
   GMutex mutex;
-  sqlite3 *db;
+  MeloFileDBConn *writer;
+  GAsyncQueue *readers;
   gchar *cover_path;
+
+  /* Name to ID caches (protected by mutex) */
+  GHashTable *artist_ids;
+  GHashTable *album_ids;
+  GHashTable *genre_ids;
+  GHashTable *path_ids;
+
+  /* Full-text search index is available */
+  gboolean fts;
+
+  /* Batch transaction */
+  gint batch_count;
+  gint batch_rows;
+  gint64 batch_time;
+  gboolean batch_active;
+  gboolean batch_failed;
+
+  /* Cover writer thread and names of covers in flight */
+  GThreadPool *cover_pool;
+  GMutex covers_mutex;
+  GHashTable *covers;
+
+  /* Mounted volumes */
+  GMutex volumes_mutex;
+  GList *volumes;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (MeloFileDB, melo_file_db, G_TYPE_OBJECT)
 
 static gboolean melo_file_db_open (MeloFileDB *db, const gchar *file);
 static void melo_file_db_close (MeloFileDB *db);
+static void melo_file_db_cover_write (gpointer data, gpointer user_data);
+static void melo_file_db_volume_free (MeloFileDBVolume *volume);
 
 static void
 melo_file_db_finalize (GObject *gobject)
@@ -106,12 +458,27 @@ melo_file_db_finalize (GObject *gobject)
   MeloFileDB *fdb = MELO_FILE_DB (gobject);
   MeloFileDBPrivate *priv = melo_file_db_get_instance_private (fdb);
 
+  /* Wait end of pending cover writes */
+  g_thread_pool_free (priv->cover_pool, FALSE, TRUE);
+  g_hash_table_unref (priv->covers);
+  g_mutex_clear (&priv->covers_mutex);
+
+  /* Free volumes list */
+  g_list_free_full (priv->volumes, (GDestroyNotify) melo_file_db_volume_free);
+  g_mutex_clear (&priv->volumes_mutex);
+
   /* Free cover path */
   g_free (priv->cover_path);
 
   /* Close database file */
   melo_file_db_close (fdb);
 
+  /* Free ID caches */
+  g_hash_table_unref (priv->artist_ids);
+  g_hash_table_unref (priv->album_ids);
+  g_hash_table_unref (priv->genre_ids);
+  g_hash_table_unref (priv->path_ids);
+
   /* Clear mutex */
   g_mutex_clear (&priv->mutex);
 
@@ -137,6 +504,25 @@ melo_file_db_init (MeloFileDB *self)
 
   /* Init mutex */
   g_mutex_init (&priv->mutex);
+
+  /* Init ID caches */
+  priv->artist_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                            NULL);
+  priv->album_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           NULL);
+  priv->genre_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           NULL);
+  priv->path_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          NULL);
+
+  /* Create cover writer thread */
+  g_mutex_init (&priv->covers_mutex);
+  priv->covers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  priv->cover_pool = g_thread_pool_new (melo_file_db_cover_write, priv, 1,
+                                        FALSE, NULL);
+
+  /* Init volumes list */
+  g_mutex_init (&priv->volumes_mutex);
 }
 
 MeloFileDB *
@@ -168,15 +554,280 @@ melo_file_db_get_cover_path (MeloFileDB *db)
   return db->priv->cover_path;
 }
 
+static MeloFileDBConn *
+melo_file_db_conn_open (const gchar *file, gboolean read_only)
+{
+  MeloFileDBConn *conn;
+  sqlite3 *db;
+  int flags;
+
+  /* Open sqlite database */
+  flags = read_only ? SQLITE_OPEN_READONLY :
+                      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+  if (sqlite3_open_v2 (file, &db, flags, NULL) != SQLITE_OK) {
+    sqlite3_close (db);
+    return NULL;
+  }
+
+  /* Wait on locks held by other connections instead of failing */
+  sqlite3_busy_timeout (db, MELO_FILE_DB_BUSY_TIMEOUT);
+
+  /* Create connection */
+  conn = g_slice_new (MeloFileDBConn);
+  conn->db = db;
+  conn->stmts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       (GDestroyNotify) sqlite3_finalize);
+
+  return conn;
+}
+
+static void
+melo_file_db_conn_close (MeloFileDBConn *conn)
+{
+  if (!conn)
+    return;
+
+  /* Finalize all cached statements and close database */
+  g_hash_table_unref (conn->stmts);
+  sqlite3_close (conn->db);
+  g_slice_free (MeloFileDBConn, conn);
+}
+
+static sqlite3_stmt *
+melo_file_db_prepare (MeloFileDBConn *conn, const gchar *sql)
+{
+  sqlite3_stmt *req = NULL;
+  gpointer key;
+
+  /* Take compiled statement from cache: a statement is removed from cache
+   * while it is used, so nested requests with the same shape will compile
+   * their own copy. A connection is only used by one thread at a time.
+   */
+  if (g_hash_table_lookup_extended (conn->stmts, sql, &key,
+                                    (gpointer *) &req)) {
+    g_hash_table_steal (conn->stmts, sql);
+    g_free (key);
+  }
+
+  /* Compile a new statement */
+  if (!req && sqlite3_prepare_v2 (conn->db, sql, -1, &req, NULL) != SQLITE_OK) {
+    sqlite3_finalize (req);
+    return NULL;
+  }
+
+  return req;
+}
+
+static void
+melo_file_db_release (MeloFileDBConn *conn, sqlite3_stmt *req)
+{
+  const gchar *sql;
+
+  if (!req)
+    return;
+
+  /* Reset statement for next use */
+  sqlite3_reset (req);
+  sqlite3_clear_bindings (req);
+  sql = sqlite3_sql (req);
+
+  /* Give back statement to cache */
+  if (g_hash_table_size (conn->stmts) < MELO_FILE_DB_STMT_CACHE_SIZE &&
+      !g_hash_table_contains (conn->stmts, sql)) {
+    g_hash_table_insert (conn->stmts, g_strdup (sql), req);
+    return;
+  }
+
+  /* Cache is full or already contains this request */
+  sqlite3_finalize (req);
+}
+
+static MeloFileDBConn *
+melo_file_db_get_reader (MeloFileDBPrivate *priv)
+{
+  MeloFileDBConn *conn = NULL;
+
+  /* Check out a free read-only connection */
+  if (priv->readers)
+    conn = g_async_queue_timeout_pop (priv->readers,
+                                      MELO_FILE_DB_READER_TIMEOUT);
+
+  /* No reader available: use writer connection */
+  if (!conn) {
+    g_mutex_lock (&priv->mutex);
+    conn = priv->writer;
+  }
+
+  return conn;
+}
+
+static void
+melo_file_db_put_reader (MeloFileDBPrivate *priv, MeloFileDBConn *conn)
+{
+  /* Give back connection */
+  if (conn == priv->writer)
+    g_mutex_unlock (&priv->mutex);
+  else
+    g_async_queue_push (priv->readers, conn);
+}
+
+static gchar *
+melo_file_db_gen_sort_key (const gchar *str)
+{
+  gchar *norm, *fold;
+  const gchar *p;
+  GString *key;
+
+  if (!str)
+    return g_strdup ("");
+
+  /* Decompose characters and fold case */
+  norm = g_utf8_normalize (str, -1, G_NORMALIZE_NFKD);
+  if (!norm)
+    return g_strdup ("");
+  fold = g_utf8_casefold (norm, -1);
+  g_free (norm);
+
+  /* Skip leading spaces and article */
+  p = fold;
+  while (g_ascii_isspace (*p))
+    p++;
+  if (g_str_has_prefix (p, "the "))
+    p += 4;
+
+  /* Generate key */
+  key = g_string_sized_new (strlen (p));
+  while (*p != '\0') {
+    /* Pad numbers with zeros */
+    if (g_ascii_isdigit (*p)) {
+      const gchar *start;
+      gsize len;
+
+      /* Skip leading zeros */
+      while (*p == '0' && g_ascii_isdigit (p[1]))
+        p++;
+
+      /* Get number length */
+      for (start = p; g_ascii_isdigit (*p); p++);
+      len = p - start;
+
+      /* Add padded number */
+      for (; len < MELO_FILE_DB_SORT_KEY_DIGITS; len++)
+        g_string_append_c (key, '0');
+      g_string_append_len (key, start, p - start);
+      continue;
+    }
+
+    /* Remove diacritics */
+    if (!g_unichar_ismark (g_utf8_get_char (p)))
+      g_string_append_len (key, p, g_utf8_next_char (p) - p);
+    p = g_utf8_next_char (p);
+  }
+  g_free (fold);
+
+  return g_string_free (key, FALSE);
+}
+
+static void
+melo_file_db_sort_key_func (sqlite3_context *ctx, int argc,
+                            sqlite3_value **argv)
+{
+  const gchar *str = (const gchar *) sqlite3_value_text (argv[0]);
+
+  /* Return sort key of string */
+  sqlite3_result_text (ctx, melo_file_db_gen_sort_key (str), -1, g_free);
+}
+
+static void
+melo_file_db_match_func (sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+  const gchar *input = (const gchar *) sqlite3_value_text (argv[0]);
+  gchar **words, *text;
+  GString *str;
+  gint found = 0;
+  gint i;
+
+  /* Concatenate values to search in */
+  str = g_string_new (NULL);
+  for (i = 1; i < argc; i++) {
+    const gchar *value = (const gchar *) sqlite3_value_text (argv[i]);
+
+    if (value)
+      g_string_append_printf (str, "%s\n", value);
+  }
+  text = g_utf8_casefold (str->str, str->len);
+  g_string_free (str, TRUE);
+
+  /* All words of input must be found (case insensitive) */
+  words = g_strsplit_set (input ? input : "", " \t", -1);
+  for (i = 0; words[i]; i++) {
+    gchar *word;
+
+    /* Skip empty words */
+    if (*words[i] == '\0')
+      continue;
+
+    /* Find word */
+    word = g_utf8_casefold (words[i], -1);
+    found = strstr (text, word) != NULL;
+    g_free (word);
+    if (!found)
+      break;
+  }
+  g_strfreev (words);
+  g_free (text);
+
+  sqlite3_result_int (ctx, found);
+}
+
+static gchar *
+melo_file_db_gen_match (const gchar *input)
+{
+  GString *match;
+  gchar **words;
+  gint i;
+
+  /* Split input in words */
+  words = g_strsplit_set (input ? input : "", " \t", -1);
+  match = g_string_new (NULL);
+
+  /* Generate a full-text query: each word is quoted and used as a prefix */
+  for (i = 0; words[i]; i++) {
+    const gchar *c;
+
+    /* Skip empty words */
+    if (*words[i] == '\0')
+      continue;
+
+    /* Add quoted word (quotes are doubled) */
+    g_string_append (match, match->len ? " \"" : "\"");
+    for (c = words[i]; *c != '\0'; c++) {
+      if (*c == '"')
+        g_string_append_c (match, '"');
+      g_string_append_c (match, *c);
+    }
+    g_string_append (match, "\"*");
+  }
+  g_strfreev (words);
+
+  /* Nothing to search */
+  if (!match->len) {
+    g_string_free (match, TRUE);
+    return NULL;
+  }
+
+  return g_string_free (match, FALSE);
+}
+
 static gboolean
-melo_file_db_get_int (MeloFileDBPrivate *priv, const gchar *sql, gint *value)
+melo_file_db_get_int (MeloFileDBConn *conn, const gchar *sql, gint *value)
 {
   sqlite3_stmt *req;
   gint count = 0;
   int ret;
 
   /* Prepare SQL request */
-  ret = sqlite3_prepare_v2 (priv->db, sql, -1, &req, NULL);
+  ret = sqlite3_prepare_v2 (conn->db, sql, -1, &req, NULL);
   if (ret != SQLITE_OK)
     return FALSE;
 
@@ -192,12 +843,214 @@ melo_file_db_get_int (MeloFileDBPrivate *priv, const gchar *sql, gint *value)
   return ret != SQLITE_DONE || !count ? FALSE : TRUE;
 }
 
+static gboolean
+melo_file_db_get_name_id (MeloFileDBConn *conn, GHashTable *cache,
+                          const gchar *select_sql, const gchar *insert_sql,
+                          const gchar *name, gint *id)
+{
+  sqlite3_stmt *req;
+  gint row_id;
+
+  /* Find ID in cache */
+  row_id = GPOINTER_TO_INT (g_hash_table_lookup (cache, name));
+  if (row_id) {
+    *id = row_id;
+    return TRUE;
+  }
+
+  /* Find ID from name */
+  req = melo_file_db_prepare (conn, select_sql);
+  if (!req)
+    return FALSE;
+  sqlite3_bind_text (req, 1, name, -1, SQLITE_STATIC);
+  if (sqlite3_step (req) == SQLITE_ROW)
+    row_id = sqlite3_column_int (req, 0);
+  melo_file_db_release (conn, req);
+
+  /* Name not found */
+  if (!row_id) {
+    if (!insert_sql)
+      return FALSE;
+
+    /* Add new name (with its sort key if needed) */
+    req = melo_file_db_prepare (conn, insert_sql);
+    if (!req)
+      return FALSE;
+    sqlite3_bind_text (req, 1, name, -1, SQLITE_STATIC);
+    if (sqlite3_bind_parameter_count (req) > 1)
+      sqlite3_bind_text (req, 2, melo_file_db_gen_sort_key (name), -1, g_free);
+    if (sqlite3_step (req) == SQLITE_DONE)
+      row_id = sqlite3_last_insert_rowid (conn->db);
+    melo_file_db_release (conn, req);
+  }
+
+  /* Add ID to cache: flush it when too big */
+  if (row_id) {
+    if (g_hash_table_size (cache) >= MELO_FILE_DB_ID_CACHE_SIZE)
+      g_hash_table_remove_all (cache);
+    g_hash_table_insert (cache, g_strdup (name), GINT_TO_POINTER (row_id));
+  }
+
+  *id = row_id;
+  return row_id ? TRUE : FALSE;
+}
+
+static gboolean
+melo_file_db_upgrade (MeloFileDBConn *conn, gint version, gboolean fts)
+{
+  char *err = NULL;
+  gchar *sql;
+  int ret;
+
+  /* Apply each upgrade step in its own transaction */
+  for (; version < MELO_FILE_DB_VERSION; version++) {
+    /* Generate upgrade request and set new version */
+    sql = g_strdup_printf ("BEGIN;%s%sPRAGMA user_version = %d;COMMIT;",
+                           melo_file_db_upgrades[version] ?
+                           melo_file_db_upgrades[version] : "",
+                           fts && melo_file_db_upgrades_fts[version] ?
+                           melo_file_db_upgrades_fts[version] : "",
+                           version + 1);
+    ret = sqlite3_exec (conn->db, sql, NULL, NULL, &err);
+    g_free (sql);
+
+    /* Upgrade failed: keep database in its previous version */
+    if (ret != SQLITE_OK) {
+      g_warning ("File DB: upgrade to version %d failed: %s", version + 1,
+                 err ? err : sqlite3_errstr (ret));
+      sqlite3_free (err);
+      sqlite3_exec (conn->db, "ROLLBACK", NULL, NULL, NULL);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static gboolean
+melo_file_db_set_wal (MeloFileDBConn *conn)
+{
+  sqlite3_stmt *req;
+  gboolean ret = FALSE;
+
+  /* Switch journal mode: new mode is returned */
+  if (sqlite3_prepare_v2 (conn->db, "PRAGMA journal_mode = WAL", -1, &req,
+                          NULL) != SQLITE_OK)
+    return FALSE;
+  if (sqlite3_step (req) == SQLITE_ROW)
+    ret = !g_strcmp0 ((const gchar *) sqlite3_column_text (req, 0), "wal");
+  sqlite3_finalize (req);
+
+  /* WAL is safe against corruption with less sync */
+  if (ret)
+    sqlite3_exec (conn->db, "PRAGMA synchronous = NORMAL", NULL, NULL, NULL);
+
+  return ret;
+}
+
+static gboolean
+melo_file_db_move_aside (const gchar *file)
+{
+  static const gchar *suffixes[] = { "-wal", "-shm" };
+  gchar *path = NULL, *src, *dst;
+  guint i;
+
+  /* Find an unused backup name */
+  for (i = 0; i < MELO_FILE_DB_BACKUP_MAX; i++) {
+    path = i ? g_strdup_printf ("%s.old.%u", file, i) :
+               g_strconcat (file, ".old", NULL);
+    if (!g_file_test (path, G_FILE_TEST_EXISTS))
+      break;
+    g_free (path);
+    path = NULL;
+  }
+  if (!path) {
+    g_warning ("File DB: too many backups of unusable database %s", file);
+    return FALSE;
+  }
+
+  /* Move database */
+  g_warning ("File DB: moving unusable database to %s", path);
+  if (g_rename (file, path)) {
+    g_free (path);
+    return FALSE;
+  }
+
+  /* Move WAL and shared memory files with database: a WAL left behind would
+   * be replayed into new database.
+   */
+  for (i = 0; i < G_N_ELEMENTS (suffixes); i++) {
+    src = g_strconcat (file, suffixes[i], NULL);
+    dst = g_strconcat (path, suffixes[i], NULL);
+    if (g_file_test (src, G_FILE_TEST_EXISTS) && g_rename (src, dst))
+      g_unlink (src);
+    g_free (src);
+    g_free (dst);
+  }
+  g_free (path);
+
+  return TRUE;
+}
+
+static MeloFileDBConn *
+melo_file_db_open_writer (const gchar *file, gboolean *wal, gboolean *fts,
+                          gboolean *broken)
+{
+  MeloFileDBConn *conn;
+  gint version = 0;
+
+  /* Open writer connection */
+  *broken = FALSE;
+  conn = melo_file_db_conn_open (file, FALSE);
+  if (!conn)
+    return NULL;
+
+  /* Use write-ahead log so readers are not blocked by writer */
+  *wal = melo_file_db_set_wal (conn);
+
+  /* Add sort key function used to upgrade database */
+  sqlite3_create_function (conn->db, "melo_sort_key", 1,
+                           SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL,
+                           melo_file_db_sort_key_func, NULL, NULL);
+  sqlite3_create_function (conn->db, "melo_match", -1,
+                           SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL,
+                           melo_file_db_match_func, NULL, NULL);
+
+  /* Check full-text search support */
+  *fts = sqlite3_exec (conn->db, MELO_FILE_DB_PROBE_FTS, NULL, NULL,
+                       NULL) == SQLITE_OK;
+
+  /* Get database version */
+  melo_file_db_get_int (conn, MELO_FILE_DB_GET_VERSION, &version);
+
+  /* Not initialized or too old version to be upgraded */
+  if (version < MELO_FILE_DB_CREATE_VERSION) {
+    /* Remove old database */
+    sqlite3_exec (conn->db, MELO_FILE_DB_CLEAN, NULL, NULL, NULL);
+
+    /* Initialize database */
+    sqlite3_exec (conn->db, MELO_FILE_DB_CREATE, NULL, NULL, NULL);
+    version = MELO_FILE_DB_CREATE_VERSION;
+  }
+
+  /* Upgrade database to last version and keep existing entries */
+  if (!melo_file_db_upgrade (conn, version, *fts)) {
+    melo_file_db_conn_close (conn);
+    *broken = TRUE;
+    return NULL;
+  }
+
+  return conn;
+}
+
 static gboolean
 melo_file_db_open (MeloFileDB *db, const gchar *file)
 {
   MeloFileDBPrivate *priv = db->priv;
-  gint version;
+  gboolean wal, fts, broken;
+  gint count = 0;
   gchar *path;
+  gint i;
 
   /* Create directory if necessary */
   path = g_path_get_dirname (file);
@@ -211,23 +1064,47 @@ melo_file_db_open (MeloFileDB *db, const gchar *file)
   g_mutex_lock (&priv->mutex);
 
   /* Open database file */
-  if (!priv->db) {
-    /* Open sqlite database */
-    if (sqlite3_open (file, &priv->db)) {
+  if (!priv->writer) {
+    /* Open and upgrade database */
+    priv->writer = melo_file_db_open_writer (file, &wal, &fts, &broken);
+
+    /* Database cannot be upgraded: move it aside and create a new one, so
+     * library is rebuilt by next scan.
+     */
+    if (!priv->writer && broken && melo_file_db_move_aside (file))
+      priv->writer = melo_file_db_open_writer (file, &wal, &fts, &broken);
+    if (!priv->writer) {
       g_mutex_unlock (&priv->mutex);
       return FALSE;
     }
 
-    /* Get database version */
-    melo_file_db_get_int (priv, MELO_FILE_DB_GET_VERSION, &version);
-
-    /* Not initialized or old version */
-    if (version < MELO_FILE_DB_VERSION) {
-      /* Remove old database */
-      sqlite3_exec (priv->db, MELO_FILE_DB_CLEAN, NULL, NULL, NULL);
-
-      /* Initialize database */
-      sqlite3_exec (priv->db, MELO_FILE_DB_CREATE, NULL, NULL, NULL);
+    /* Use full-text search index when it has been created */
+    priv->fts = fts &&
+                melo_file_db_get_int (priv->writer, MELO_FILE_DB_HAS_FTS,
+                                      &count) && count;
+
+    /* Removal from index was done by song_remove trigger before version 11 */
+    if (priv->fts)
+      sqlite3_exec (priv->writer->db, MELO_FILE_DB_FTS_TRIGGER, NULL, NULL,
+                    NULL);
+
+    /* Open read-only connections: without WAL, readers would be blocked by
+     * writer, so all requests use writer connection.
+     */
+    if (wal) {
+      priv->readers = g_async_queue_new_full (
+                                      (GDestroyNotify) melo_file_db_conn_close);
+      for (i = 0; i < MELO_FILE_DB_READER_COUNT; i++) {
+        MeloFileDBConn *conn;
+
+        conn = melo_file_db_conn_open (file, TRUE);
+        if (!conn)
+          break;
+        sqlite3_create_function (conn->db, "melo_match", -1,
+                                 SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL,
+                                 melo_file_db_match_func, NULL, NULL);
+        g_async_queue_push (priv->readers, conn);
+      }
     }
   }
 
@@ -237,6 +1114,36 @@ melo_file_db_open (MeloFileDB *db, const gchar *file)
   return TRUE;
 }
 
+static void
+melo_file_db_batch_start (MeloFileDBPrivate *priv)
+{
+  /* Start transaction: rows are written immediately if it fails */
+  priv->batch_active = sqlite3_exec (priv->writer->db, "BEGIN", NULL, NULL,
+                                     NULL) == SQLITE_OK;
+  priv->batch_time = g_get_monotonic_time () / G_TIME_SPAN_MILLISECOND;
+  priv->batch_rows = 0;
+}
+
+static gboolean
+melo_file_db_batch_commit (MeloFileDBPrivate *priv)
+{
+  char *err = NULL;
+  int ret;
+
+  /* Commit transaction */
+  ret = sqlite3_exec (priv->writer->db, "COMMIT", NULL, NULL, &err);
+  if (ret == SQLITE_OK)
+    return TRUE;
+
+  /* Commit failed: rows of transaction are lost */
+  g_warning ("File DB: batch commit failed: %s",
+             err ? err : sqlite3_errstr (ret));
+  sqlite3_free (err);
+  sqlite3_exec (priv->writer->db, "ROLLBACK", NULL, NULL, NULL);
+
+  return FALSE;
+}
+
 static void
 melo_file_db_close (MeloFileDB *db)
 {
@@ -245,14 +1152,236 @@ melo_file_db_close (MeloFileDB *db)
   /* Lock database access */
   g_mutex_lock (&priv->mutex);
 
+  /* Close read-only connections */
+  if (priv->readers) {
+    g_async_queue_unref (priv->readers);
+    priv->readers = NULL;
+  }
+
   /* Close databse */
-  if (priv->db) {
-    sqlite3_close (priv->db);
-    priv->db = NULL;
+  if (priv->writer) {
+    /* Commit pending batch */
+    if (priv->batch_active)
+      melo_file_db_batch_commit (priv);
+    priv->batch_active = FALSE;
+    priv->batch_count = 0;
+
+    /* Finalize all cached statements and close connection */
+    melo_file_db_conn_close (priv->writer);
+    priv->writer = NULL;
+  }
+
+  /* Unlock database access */
+  g_mutex_unlock (&priv->mutex);
+}
+
+gboolean
+melo_file_db_batch_begin (MeloFileDB *db)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  gboolean ret;
+
+  /* Lock database access */
+  g_mutex_lock (&priv->mutex);
+
+  /* Start a new transaction: nested batches share the first one */
+  if (!priv->batch_count++) {
+    priv->batch_failed = FALSE;
+    melo_file_db_batch_start (priv);
   }
+  ret = priv->batch_active;
 
   /* Unlock database access */
   g_mutex_unlock (&priv->mutex);
+
+  return ret;
+}
+
+gboolean
+melo_file_db_batch_end (MeloFileDB *db)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  gboolean ret;
+
+  /* Lock database access */
+  g_mutex_lock (&priv->mutex);
+
+  /* Commit transaction when last batch ends */
+  if (priv->batch_count && !--priv->batch_count) {
+    if (priv->batch_active && !melo_file_db_batch_commit (priv))
+      priv->batch_failed = TRUE;
+    priv->batch_active = FALSE;
+  }
+  ret = !priv->batch_failed;
+
+  /* Unlock database access */
+  g_mutex_unlock (&priv->mutex);
+
+  return ret;
+}
+
+static void
+melo_file_db_batch_add_row (MeloFileDBPrivate *priv)
+{
+  gint64 now;
+
+  /* Not in a batch */
+  if (!priv->batch_count)
+    return;
+
+  /* Limit transaction size and age: commit and start a new one */
+  now = g_get_monotonic_time () / G_TIME_SPAN_MILLISECOND;
+  if (++priv->batch_rows < MELO_FILE_DB_BATCH_SIZE &&
+      now - priv->batch_time < MELO_FILE_DB_BATCH_DELAY)
+    return;
+  if (priv->batch_active && !melo_file_db_batch_commit (priv))
+    priv->batch_failed = TRUE;
+  melo_file_db_batch_start (priv);
+}
+
+static void
+melo_file_db_flush_ids (MeloFileDBPrivate *priv)
+{
+  /* Removed rows can have been garbage-collected by triggers */
+  g_hash_table_remove_all (priv->artist_ids);
+  g_hash_table_remove_all (priv->album_ids);
+  g_hash_table_remove_all (priv->genre_ids);
+  g_hash_table_remove_all (priv->path_ids);
+}
+
+static void
+melo_file_db_volume_free (MeloFileDBVolume *volume)
+{
+  g_free (volume->key);
+  g_free (volume->root);
+  g_slice_free (MeloFileDBVolume, volume);
+}
+
+static gchar *
+melo_file_db_volume_replace (MeloFileDBPrivate *priv, const gchar *path,
+                             gboolean to_key)
+{
+  gchar *ret = NULL;
+  GList *l;
+
+  /* Find volume containing path and replace its prefix */
+  g_mutex_lock (&priv->volumes_mutex);
+  for (l = priv->volumes; l != NULL; l = l->next) {
+    MeloFileDBVolume *volume = l->data;
+    const gchar *from = to_key ? volume->root : volume->key;
+    const gchar *to = to_key ? volume->key : volume->root;
+    gsize len = strlen (from);
+
+    if (!strncmp (path, from, len) && (path[len] == '/' || path[len] == '\0')) {
+      ret = g_strconcat (to, path + len, NULL);
+      break;
+    }
+  }
+  g_mutex_unlock (&priv->volumes_mutex);
+
+  return ret;
+}
+
+/* Convert a path to its stored form: NULL is returned when path is not on a
+ * mounted volume and can be stored as is.
+ */
+static gchar *
+melo_file_db_volume_to_key (MeloFileDBPrivate *priv, const gchar *path)
+{
+  if (!path || !priv->volumes)
+    return NULL;
+  return melo_file_db_volume_replace (priv, path, TRUE);
+}
+
+/* Convert a stored path to its current location: NULL is returned when path
+ * is not relative to a volume or when the volume is not mounted.
+ */
+static gchar *
+melo_file_db_volume_from_key (MeloFileDBPrivate *priv, const gchar *path)
+{
+  if (!path || !g_str_has_prefix (path, MELO_FILE_DB_VOLUME_PREFIX))
+    return NULL;
+  return melo_file_db_volume_replace (priv, path, FALSE);
+}
+
+void
+melo_file_db_add_volume (MeloFileDB *db, const gchar *uuid, const gchar *root)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  MeloFileDBVolume *volume;
+  sqlite3_stmt *req;
+  gsize len;
+
+  /* Create volume */
+  volume = g_slice_new (MeloFileDBVolume);
+  volume->key = g_strconcat (MELO_FILE_DB_VOLUME_PREFIX, uuid, NULL);
+  volume->root = g_strdup (root);
+  len = strlen (volume->root);
+  if (len && volume->root[len - 1] == '/')
+    volume->root[len - 1] = '\0';
+
+  /* Lock database access */
+  g_mutex_lock (&priv->mutex);
+
+  /* Move paths registered with mount point to the volume */
+  req = melo_file_db_prepare (priv->writer, MELO_FILE_DB_MOVE_PATHS);
+  if (req) {
+    sqlite3_bind_text (req, 1, volume->root, -1, SQLITE_STATIC);
+    sqlite3_bind_text (req, 2, volume->key, -1, SQLITE_STATIC);
+    sqlite3_step (req);
+    melo_file_db_release (priv->writer, req);
+  }
+
+  /* Remove paths already known on volume */
+  req = melo_file_db_prepare (priv->writer, MELO_FILE_DB_REMOVE_PATH_SONGS);
+  if (req) {
+    sqlite3_bind_text (req, 1, volume->root, -1, SQLITE_STATIC);
+    sqlite3_step (req);
+    melo_file_db_release (priv->writer, req);
+  }
+  req = melo_file_db_prepare (priv->writer, MELO_FILE_DB_REMOVE_PATH);
+  if (req) {
+    sqlite3_bind_text (req, 1, volume->root, -1, SQLITE_STATIC);
+    sqlite3_step (req);
+    melo_file_db_release (priv->writer, req);
+  }
+
+  /* Add volume */
+  g_mutex_lock (&priv->volumes_mutex);
+  priv->volumes = g_list_prepend (priv->volumes, volume);
+  g_mutex_unlock (&priv->volumes_mutex);
+
+  /* Flush ID caches */
+  melo_file_db_flush_ids (priv);
+
+  /* Unlock database access */
+  g_mutex_unlock (&priv->mutex);
+}
+
+void
+melo_file_db_remove_volume (MeloFileDB *db, const gchar *root)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  GList *l;
+
+  /* Lock volumes list */
+  g_mutex_lock (&priv->volumes_mutex);
+
+  /* Remove volume: its paths are kept until it is mounted again */
+  for (l = priv->volumes; l != NULL; l = l->next) {
+    MeloFileDBVolume *volume = l->data;
+    gsize len = strlen (volume->root);
+
+    if (!strncmp (root, volume->root, len) &&
+        (root[len] == '\0' || (root[len] == '/' && root[len + 1] == '\0'))) {
+      priv->volumes = g_list_delete_link (priv->volumes, l);
+      melo_file_db_volume_free (volume);
+      break;
+    }
+  }
+
+  /* Unlock volumes list */
+  g_mutex_unlock (&priv->volumes_mutex);
 }
 
 gboolean
@@ -260,35 +1389,269 @@ melo_file_db_get_path_id (MeloFileDB *db, const gchar *path, gboolean add,
                           gint *path_id)
 {
   MeloFileDBPrivate *priv = db->priv;
+  gchar *key;
   gboolean ret;
-  char *sql;
+
+  /* Get stored path */
+  key = melo_file_db_volume_to_key (priv, path);
 
   /* Lock database access */
   g_mutex_lock (&priv->mutex);
 
-  /* Get ID for path */
-  sql = sqlite3_mprintf ("SELECT rowid FROM path WHERE path = '%q'", path);
-  ret = melo_file_db_get_int (priv, sql, path_id);
-  sqlite3_free (sql);
+  /* Get ID for path (and add if not found) */
+  ret = melo_file_db_get_name_id (priv->writer, priv->path_ids,
+                                  MELO_FILE_DB_SELECT_ID ("path"),
+                                  add ? MELO_FILE_DB_INSERT_ID ("path") : NULL,
+                                  key ? key : path, path_id);
 
-  /* Path not found */
-  if (!ret || !*path_id) {
-    if (!add) {
-      g_mutex_unlock (&priv->mutex);
-      return FALSE;
+  /* Unlock database access */
+  g_mutex_unlock (&priv->mutex);
+  g_free (key);
+
+  return ret;
+}
+
+gboolean
+melo_file_db_get_song_timestamp (MeloFileDB *db, gint path_id,
+                                 const gchar *filename, gint *timestamp)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  MeloFileDBConn *conn;
+  sqlite3_stmt *req;
+  gboolean ret = FALSE;
+
+  /* Check out a database connection */
+  conn = melo_file_db_get_reader (priv);
+
+  /* Find file */
+  req = melo_file_db_prepare (conn, MELO_FILE_DB_SELECT_SONG);
+  if (req) {
+    sqlite3_bind_int (req, 1, path_id);
+    sqlite3_bind_text (req, 2, filename, -1, SQLITE_STATIC);
+    if (sqlite3_step (req) == SQLITE_ROW) {
+      *timestamp = sqlite3_column_int (req, 1);
+      ret = TRUE;
     }
+    melo_file_db_release (conn, req);
+  }
 
-    /* Add new path */
-    sql = sqlite3_mprintf ("INSERT INTO path (path) VALUES ('%q')", path);
-    sqlite3_exec (priv->db, sql, NULL, NULL, NULL);
-    *path_id = sqlite3_last_insert_rowid (priv->db);
-    sqlite3_free (sql);
+  /* Release connection */
+  melo_file_db_put_reader (priv, conn);
+
+  return ret;
+}
+
+GList *
+melo_file_db_get_path_files (MeloFileDB *db, gint path_id)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  MeloFileDBConn *conn;
+  sqlite3_stmt *req;
+  const gchar *name;
+  GList *list = NULL;
+
+  /* Check out a database connection */
+  conn = melo_file_db_get_reader (priv);
+
+  /* List files of path */
+  req = melo_file_db_prepare (conn, MELO_FILE_DB_SELECT_FILES);
+  if (req) {
+    sqlite3_bind_int (req, 1, path_id);
+    while (sqlite3_step (req) == SQLITE_ROW) {
+      name = (const gchar *) sqlite3_column_text (req, 0);
+      list = g_list_prepend (list, g_strdup (name));
+    }
+    melo_file_db_release (conn, req);
   }
 
+  /* Release connection */
+  melo_file_db_put_reader (priv, conn);
+
+  return list;
+}
+
+GList *
+melo_file_db_get_sub_paths (MeloFileDB *db, const gchar *path)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  MeloFileDBConn *conn;
+  sqlite3_stmt *req;
+  const gchar *name;
+  GList *list = NULL;
+  gchar *key, *upath;
+
+  /* Get stored path */
+  key = melo_file_db_volume_to_key (priv, path);
+
+  /* Check out a database connection */
+  conn = melo_file_db_get_reader (priv);
+
+  /* List path and its sub-paths */
+  req = melo_file_db_prepare (conn, MELO_FILE_DB_SELECT_PATHS);
+  if (req) {
+    sqlite3_bind_text (req, 1, key ? key : path, -1, SQLITE_STATIC);
+    while (sqlite3_step (req) == SQLITE_ROW) {
+      name = (const gchar *) sqlite3_column_text (req, 0);
+      upath = melo_file_db_volume_from_key (priv, name);
+      list = g_list_prepend (list, upath ? upath : g_strdup (name));
+    }
+    melo_file_db_release (conn, req);
+  }
+
+  /* Release connection */
+  melo_file_db_put_reader (priv, conn);
+  g_free (key);
+
+  return list;
+}
+
+gboolean
+melo_file_db_remove_song (MeloFileDB *db, gint path_id, const gchar *filename)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  sqlite3_stmt *req;
+  gboolean ret = FALSE;
+
+  /* Lock database access */
+  g_mutex_lock (&priv->mutex);
+
+  /* Remove song: index, empty path, artist, album and genre are removed by
+   * triggers.
+   */
+  req = melo_file_db_prepare (priv->writer, MELO_FILE_DB_REMOVE_SONG);
+  if (req) {
+    sqlite3_bind_int (req, 1, path_id);
+    sqlite3_bind_text (req, 2, filename, -1, SQLITE_STATIC);
+    ret = sqlite3_step (req) == SQLITE_DONE;
+    melo_file_db_release (priv->writer, req);
+  }
+
+  /* Flush ID caches */
+  if (sqlite3_changes (priv->writer->db))
+    melo_file_db_flush_ids (priv);
+  melo_file_db_batch_add_row (priv);
+
   /* Unlock database access */
   g_mutex_unlock (&priv->mutex);
 
-  return TRUE;
+  return ret;
+}
+
+gboolean
+melo_file_db_remove_path (MeloFileDB *db, const gchar *path)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  sqlite3_stmt *req;
+  gboolean ret = FALSE;
+  gchar *key;
+
+  /* Get stored path */
+  key = melo_file_db_volume_to_key (priv, path);
+  if (key)
+    path = key;
+
+  /* Lock database access */
+  g_mutex_lock (&priv->mutex);
+
+  /* Remove songs of path and sub-paths */
+  req = melo_file_db_prepare (priv->writer, MELO_FILE_DB_REMOVE_PATH_SONGS);
+  if (req) {
+    sqlite3_bind_text (req, 1, path, -1, SQLITE_STATIC);
+    ret = sqlite3_step (req) == SQLITE_DONE;
+    melo_file_db_release (priv->writer, req);
+  }
+
+  /* Remove remaining paths */
+  req = melo_file_db_prepare (priv->writer, MELO_FILE_DB_REMOVE_PATH);
+  if (req && ret) {
+    sqlite3_bind_text (req, 1, path, -1, SQLITE_STATIC);
+    ret = sqlite3_step (req) == SQLITE_DONE;
+  }
+  melo_file_db_release (priv->writer, req);
+
+  /* Flush ID caches */
+  melo_file_db_flush_ids (priv);
+  melo_file_db_batch_add_row (priv);
+
+  /* Unlock database access */
+  g_mutex_unlock (&priv->mutex);
+  g_free (key);
+
+  return ret;
+}
+
+static void
+melo_file_db_cover_write (gpointer data, gpointer user_data)
+{
+  MeloFileDBPrivate *priv = (MeloFileDBPrivate *) user_data;
+  MeloFileDBCover *cover = (MeloFileDBCover *) data;
+
+  /* Create file if not exist */
+  if (!g_file_test (cover->path, G_FILE_TEST_EXISTS))
+    g_file_set_contents (cover->path, g_bytes_get_data (cover->data, NULL),
+                         g_bytes_get_size (cover->data), NULL);
+
+  /* Cover is not in flight anymore */
+  g_mutex_lock (&priv->covers_mutex);
+  g_hash_table_remove (priv->covers, cover->name);
+  g_mutex_unlock (&priv->covers_mutex);
+
+  /* Free cover */
+  g_bytes_unref (cover->data);
+  g_free (cover->path);
+  g_free (cover->name);
+  g_slice_free (MeloFileDBCover, cover);
+}
+
+static gchar *
+melo_file_db_cover_save (MeloFileDBPrivate *priv, MeloTags *tags)
+{
+  MeloFileDBCover *cover;
+  GBytes *data;
+  gchar *name;
+  gchar *type;
+  gchar *md5;
+
+  /* Get cover art */
+  data = melo_tags_get_cover (tags, NULL);
+  if (!data)
+    return NULL;
+
+  /* Calculate md5 of cover art */
+  md5 = g_compute_checksum_for_bytes (G_CHECKSUM_MD5, data);
+
+  /* Get cover type */
+  type = melo_tags_get_cover_type (tags);
+
+  /* Generate file name */
+  name = g_strdup_printf ("%s.%s", md5,
+                          g_strcmp0 (type, "image/png") ? "png" : "jpg");
+  g_free (type);
+  g_free (md5);
+
+  /* Same cover is already in flight */
+  g_mutex_lock (&priv->covers_mutex);
+  if (g_hash_table_contains (priv->covers, name)) {
+    g_mutex_unlock (&priv->covers_mutex);
+    g_bytes_unref (data);
+    return name;
+  }
+  g_hash_table_add (priv->covers, g_strdup (name));
+  g_mutex_unlock (&priv->covers_mutex);
+
+  /* Queue cover file write: when writer is late, write it now to bound
+   * memory used by queued covers
+   */
+  cover = g_slice_new (MeloFileDBCover);
+  cover->name = g_strdup (name);
+  cover->path = g_strdup_printf ("%s/%s", priv->cover_path, name);
+  cover->data = data;
+  if (g_thread_pool_unprocessed (priv->cover_pool) < MELO_FILE_DB_COVER_QUEUE)
+    g_thread_pool_push (priv->cover_pool, cover, NULL);
+  else
+    melo_file_db_cover_write (cover, priv);
+
+  return name;
 }
 
 gboolean
@@ -299,137 +1662,148 @@ melo_file_db_add_tags2 (MeloFileDB *db, gint path_id, const gchar *filename,
   MeloFileDBPrivate *priv = db->priv;
   sqlite3_stmt *req;
   guint track = 0, tracks = 0;
+  guint bitrate = 0, samplerate = 0, channels = 0;
   gint row_id = 0, ts = 0;
-  gint artist_id;
-  gint album_id;
-  gint genre_id;
+  gint old_ids[3] = { 0 };
+  gint duration = 0;
+  gint artist_id = 0;
+  gint album_id = 0;
+  gint genre_id = 0;
   gint date = 0;
-  gboolean ret;
+  gboolean cover_saved = FALSE;
   gchar *cover_file = NULL;
-  char *sql;
+  gchar *title_key;
 
+select:
   /* Lock database access */
   g_mutex_lock (&priv->mutex);
 
   /* Find if file is already registered */
-  sql = sqlite3_mprintf ("SELECT rowid,timestamp FROM song "
-                         "WHERE path_id = %d AND file = '%q'",
-                         path_id, filename);
-  sqlite3_prepare_v2 (priv->db, sql, -1, &req, NULL);
-  sqlite3_free (sql);
+  req = melo_file_db_prepare (priv->writer, MELO_FILE_DB_SELECT_SONG);
+  if (!req) {
+    g_mutex_unlock (&priv->mutex);
+    g_free (cover_file);
+    return FALSE;
+  }
+  sqlite3_bind_int (req, 1, path_id);
+  sqlite3_bind_text (req, 2, filename, -1, SQLITE_STATIC);
   while (sqlite3_step (req) == SQLITE_ROW) {
     row_id = sqlite3_column_int (req, 0);
     ts = sqlite3_column_int (req, 1);
+    old_ids[0] = sqlite3_column_int (req, 2);
+    old_ids[1] = sqlite3_column_int (req, 3);
+    old_ids[2] = sqlite3_column_int (req, 4);
   }
-  sqlite3_finalize (req);
+  melo_file_db_release (priv->writer, req);
 
   /* File already registered and up to date */
   if (row_id && timestamp == ts) {
     g_mutex_unlock (&priv->mutex);
+    g_free (cover_file);
     return TRUE;
   }
 
+  /* Save cover art of a new or modified file outside of database lock and
+   * check file again, since database can have changed in the meantime
+   */
+  if (tags && !cover_saved) {
+    g_mutex_unlock (&priv->mutex);
+    cover_file = melo_file_db_cover_save (priv, tags);
+    cover_saved = TRUE;
+    row_id = ts = 0;
+    memset (old_ids, 0, sizeof (old_ids));
+    goto select;
+  }
+
   /* Get strings from tags */
   title = tags && tags->title ? tags->title : NULL;
   artist = tags && tags->artist ? tags->artist : "Unknown";
   album = tags && tags->album ? tags->album : "Unknown";
   genre = tags && tags->genre ? tags->genre : "Unknown";
 
+  /* Generate sort key: file name is displayed when title is not available */
+  title_key = melo_file_db_gen_sort_key (title ? title : filename);
+
   /* Get values from tags */
   if (tags) {
-    GBytes *cover;
-
     /* Get numbers from tags */
     date = tags->date;
     track = tags->track;
     tracks = tags->tracks;
+    duration = tags->duration;
+    bitrate = tags->bitrate;
+    samplerate = tags->samplerate;
+    channels = tags->channels;
+  }
 
-    /* Get cover art */
-    cover = melo_tags_get_cover (tags, NULL);
-    if (cover) {
-      gchar *cover_path;
-      gchar *type;
-      gchar *md5;
-
-      /* Calculate md5 of cover art */
-      md5 = g_compute_checksum_for_bytes (G_CHECKSUM_MD5, cover);
-
-      /* Get cover type */
-      type = melo_tags_get_cover_type (tags);
-
-      /* Generate file name */
-      cover_file = g_strdup_printf ("%s.%s", md5,
-                                 g_strcmp0 (type, "image/png") ? "png" : "jpg");
-      g_free (type);
-      g_free (md5);
-
-      /* Create file if not exist */
-      cover_path = g_strdup_printf ("%s/%s", priv->cover_path, cover_file);
-      if (!g_file_test (cover_path, G_FILE_TEST_EXISTS))
-        g_file_set_contents (cover_path, g_bytes_get_data (cover, NULL),
-                             g_bytes_get_size (cover), NULL);
-      g_free (cover_path);
-      g_bytes_unref (cover);
+  /* Find artist, album and genre IDs (and add if not found) */
+  melo_file_db_get_name_id (priv->writer, priv->artist_ids,
+                            MELO_FILE_DB_SELECT_ID ("artist"),
+                            MELO_FILE_DB_INSERT_ID_KEY ("artist"), artist,
+                            &artist_id);
+  melo_file_db_get_name_id (priv->writer, priv->album_ids,
+                            MELO_FILE_DB_SELECT_ID ("album"),
+                            MELO_FILE_DB_INSERT_ID_KEY ("album"), album,
+                            &album_id);
+  melo_file_db_get_name_id (priv->writer, priv->genre_ids,
+                            MELO_FILE_DB_SELECT_ID ("genre"),
+                            MELO_FILE_DB_INSERT_ID_KEY ("genre"), genre,
+                            &genre_id);
+
+  /* Add or update song */
+  req = melo_file_db_prepare (priv->writer,
+                              row_id ? MELO_FILE_DB_UPDATE_SONG :
+                                       MELO_FILE_DB_INSERT_SONG);
+  if (req) {
+    sqlite3_bind_text (req, 1, title, -1, SQLITE_STATIC);
+    sqlite3_bind_int (req, 2, artist_id);
+    sqlite3_bind_int (req, 3, album_id);
+    sqlite3_bind_int (req, 4, genre_id);
+    sqlite3_bind_int (req, 5, date);
+    sqlite3_bind_int (req, 6, track);
+    sqlite3_bind_int (req, 7, tracks);
+    sqlite3_bind_text (req, 8, cover_file, -1, SQLITE_STATIC);
+    sqlite3_bind_int (req, 9, duration);
+    sqlite3_bind_int (req, 10, bitrate);
+    sqlite3_bind_int (req, 11, samplerate);
+    sqlite3_bind_int (req, 12, channels);
+    if (!row_id) {
+      sqlite3_bind_text (req, 13, filename, -1, SQLITE_STATIC);
+      sqlite3_bind_int (req, 14, path_id);
+      sqlite3_bind_int (req, 15, timestamp);
+      sqlite3_bind_text (req, 16, title_key, -1, SQLITE_STATIC);
+    } else {
+      sqlite3_bind_int (req, 13, timestamp);
+      sqlite3_bind_text (req, 14, title_key, -1, SQLITE_STATIC);
+      sqlite3_bind_int (req, 15, row_id);
     }
+    if (sqlite3_step (req) == SQLITE_DONE && !row_id)
+      row_id = sqlite3_last_insert_rowid (priv->writer->db);
+    melo_file_db_release (priv->writer, req);
   }
 
-  /* Find artist ID */
-  sql = sqlite3_mprintf ("SELECT rowid FROM artist WHERE artist = '%q'",
-                         artist);
-  ret = melo_file_db_get_int (priv, sql, &artist_id);
-  sqlite3_free (sql);
-  if (!ret || !artist_id) {
-    /* Add new artist */
-    sql = sqlite3_mprintf ("INSERT INTO artist (artist) VALUES ('%q')",
-                           artist);
-    sqlite3_exec (priv->db, sql, NULL, NULL, NULL);
-    artist_id = sqlite3_last_insert_rowid (priv->db);
-    sqlite3_free (sql);
-  }
-
-  /* Find album ID */
-  sql = sqlite3_mprintf ("SELECT rowid FROM album WHERE album = '%q'", album);
-  ret = melo_file_db_get_int (priv, sql, &album_id);
-  sqlite3_free (sql);
-  if (!ret || !album_id) {
-    /* Add new album */
-    sql = sqlite3_mprintf ("INSERT INTO album (album) VALUES ('%q')", album);
-    sqlite3_exec (priv->db, sql, NULL, NULL, NULL);
-    album_id = sqlite3_last_insert_rowid (priv->db);
-    sqlite3_free (sql);
-  }
-
-  /* Find genre ID */
-  sql = sqlite3_mprintf ("SELECT rowid FROM genre WHERE genre = '%q'", genre);
-  ret = melo_file_db_get_int (priv, sql, &genre_id);
-  sqlite3_free (sql);
-  if (!ret || !genre_id) {
-    /* Add new genre */
-    sql = sqlite3_mprintf ("INSERT INTO genre (genre) VALUES ('%q')", genre);
-    sqlite3_exec (priv->db, sql, NULL, NULL, NULL);
-    genre_id = sqlite3_last_insert_rowid (priv->db);
-    sqlite3_free (sql);
-  }
-
-  /* Add song */
-  if (!row_id) {
-    sql = sqlite3_mprintf ("INSERT INTO song (title,artist_id,album_id,"
-                           "genre_id,date,track,tracks,cover,file,path_id,"
-                           "timestamp) "
-                           "VALUES (%Q,%d,%d,%d,%d,%d,%d,%Q,'%q',%d,%d)",
-                           title, artist_id, album_id, genre_id, date, track,
-                           tracks, cover_file, filename, path_id, timestamp);
-  } else {
-    sql = sqlite3_mprintf ("UPDATE song SET title = %Q, artist_id = %d, "
-                           "album_id = %d, genre_id = %d, date = %d, "
-                           "track = %d, tracks = %d, cover = %Q, "
-                           "timestamp = '%d' "
-                           "WHERE rowid = %d",
-                           title, artist_id, album_id, genre_id, date, track,
-                           tracks, cover_file, timestamp, row_id);
-  }
-  sqlite3_exec (priv->db, sql, NULL, NULL, NULL);
-  sqlite3_free (sql);
+  /* Flush ID caches: previous artist, album or genre can have been
+   * garbage-collected by triggers.
+   */
+  if ((old_ids[0] && old_ids[0] != artist_id) ||
+      (old_ids[1] && old_ids[1] != album_id) ||
+      (old_ids[2] && old_ids[2] != genre_id))
+    melo_file_db_flush_ids (priv);
+
+  /* Update full-text search index */
+  req = priv->fts ? melo_file_db_prepare (priv->writer,
+                                          MELO_FILE_DB_INDEX_SONG) : NULL;
+  if (req && row_id) {
+    sqlite3_bind_int (req, 1, row_id);
+    sqlite3_bind_text (req, 2, title ? title : filename, -1, SQLITE_STATIC);
+    sqlite3_bind_text (req, 3, artist, -1, SQLITE_STATIC);
+    sqlite3_bind_text (req, 4, album, -1, SQLITE_STATIC);
+    sqlite3_bind_text (req, 5, genre, -1, SQLITE_STATIC);
+    sqlite3_step (req);
+  }
+  melo_file_db_release (priv->writer, req);
+  melo_file_db_batch_add_row (priv);
+  g_free (title_key);
   if (cover_out_file)
     *cover_out_file = cover_file;
   else
@@ -456,205 +1830,446 @@ melo_file_db_add_tags (MeloFileDB *db, const gchar *path, const gchar *filename,
                                  cover_out_file);
 }
 
-#define MELO_FILE_DB_COLUMN_SIZE 256
 #define MELO_FILE_DB_COND_COUNT MELO_FILE_DB_FIELDS_COUNT
 
+/* Condition value to bind */
+typedef struct {
+  gboolean is_string;
+  const gchar *string;
+  gint value;
+} MeloFileDBValue;
+
+static const gchar *melo_file_db_cond_string[] = {
+  [MELO_FILE_DB_FIELDS_PATH] = "path",
+  [MELO_FILE_DB_FIELDS_PATH_ID] = "path_id",
+  [MELO_FILE_DB_FIELDS_FILE] = "file",
+  [MELO_FILE_DB_FIELDS_FILE_ID] = "song.rowid",
+  [MELO_FILE_DB_FIELDS_TITLE] = "title",
+  [MELO_FILE_DB_FIELDS_ARTIST] = "artist",
+  [MELO_FILE_DB_FIELDS_ARTIST_ID] = "artist_id",
+  [MELO_FILE_DB_FIELDS_ALBUM] = "album",
+  [MELO_FILE_DB_FIELDS_ALBUM_ID] = "album_id",
+  [MELO_FILE_DB_FIELDS_GENRE] = "genre",
+  [MELO_FILE_DB_FIELDS_GENRE_ID] = "genre_id",
+  [MELO_FILE_DB_FIELDS_DATE] = "date",
+  [MELO_FILE_DB_FIELDS_TRACK] = "track",
+  [MELO_FILE_DB_FIELDS_TRACKS] = "tracks",
+  [MELO_FILE_DB_FIELDS_SEARCH] = "song_fts",
+};
+
+static gboolean
+melo_file_db_parse_token (const gchar *token, MeloFileDBSort sort,
+                          gboolean *backward, gint *id, const gchar **key)
+{
+  gchar *end;
+
+  /* Token format is "[n|p]SORT:ID:KEY" */
+  if (!token || (*token != 'n' && *token != 'p'))
+    return FALSE;
+  *backward = *token == 'p';
+
+  /* Token has been generated for another sort */
+  if (strtol (token + 1, &end, 10) != sort || *end != ':')
+    return FALSE;
+
+  /* Get ID and key of last entry */
+  *id = strtol (end + 1, &end, 10);
+  if (*end != ':')
+    return FALSE;
+  *key = end + 1;
+
+  return TRUE;
+}
+
 static gboolean
 melo_file_db_vfind (MeloFileDB *db, MeloFileDBType type, GObject *obj,
-                    MeloFileDBGetList cb, gpointer user_data, MeloTags **utags,
-                    gint offset, gint count, MeloFileDBSort sort,
+                    MeloFileDBGetList cb, MeloFileDBGetRow row_cb,
+                    gpointer user_data, MeloTags **utags,
+                    gint offset, gint count, const gchar *token,
+                    gchar **prev_token, gchar **next_token, MeloFileDBSort sort,
                     MeloTagsFields tags_fields, MeloFileDBFields field,
                     va_list args)
 {
-  const gchar *order = "", *order_col = "", *order_sort = "";
+  MeloFileDBValue values[MELO_FILE_DB_COND_COUNT];
   MeloFileDBPrivate *priv = db->priv;
+  MeloFileDBConn *conn;
   sqlite3_stmt *req = NULL;
-  MeloTags *tags;
   gboolean join_artist = FALSE;
   gboolean join_album = FALSE;
   gboolean join_genre = FALSE;
   gboolean join_path = FALSE;
-  gchar columns[MELO_FILE_DB_COLUMN_SIZE];
-  gchar *conds[MELO_FILE_DB_COND_COUNT];
-  gchar *conditions;
-  gchar *sql;
-  gint pos = 0, len = 0;
-
-  /* Handle exclusive tags cover */
-  if (tags_fields & MELO_TAGS_FIELDS_COVER_EX &&
-      tags_fields & MELO_TAGS_FIELDS_COVER_URL)
+  gboolean join_search = FALSE;
+  gboolean is_song;
+  GString *columns, *conds, *sql;
+  const gchar *order = NULL, *id_col;
+  const gchar *token_key = NULL;
+  gboolean desc = FALSE, backward = FALSE, use_token = FALSE;
+  gint token_id = 0, rows = 0, key_col = 0;
+  gchar *first_key = NULL;
+  GString *last_key = NULL;
+  gchar *path_key = NULL;
+  gchar *match = NULL;
+  gint first_id = 0, last_id = 0;
+  gint pos = 0, i;
+
+  /* Handle exclusive tags cover: cover data is never loaded for rows */
+  if ((tags_fields & MELO_TAGS_FIELDS_COVER_EX &&
+       tags_fields & MELO_TAGS_FIELDS_COVER_URL) || row_cb)
     tags_fields &= ~MELO_TAGS_FIELDS_COVER;
+  is_song = type <= MELO_FILE_DB_TYPE_SONG;
+
+  /* Artists, albums and genres have no song tags but aggregates */
+  if (!is_song)
+    tags_fields &= ~(MELO_TAGS_FIELDS_DATE | MELO_TAGS_FIELDS_TRACK |
+                     MELO_TAGS_FIELDS_TRACKS | MELO_TAGS_FIELDS_DURATION |
+                     MELO_TAGS_FIELDS_BITRATE | MELO_TAGS_FIELDS_SAMPLERATE |
+                     MELO_TAGS_FIELDS_CHANNELS);
 
   /* Generate columns for request */
-  len = g_snprintf (columns, MELO_FILE_DB_COLUMN_SIZE,
-                    type <= MELO_FILE_DB_TYPE_SONG ? "song.rowid," : "rowid,");
+  columns = g_string_new (is_song ? "song.rowid," : "rowid,");
+  if (!is_song && row_cb)
+    g_string_append (columns, "song_count,song_date,song_duration,");
   if (type == MELO_FILE_DB_TYPE_FILE) {
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "path,");
+    g_string_append (columns, "path,");
     join_path = TRUE;
   }
-  if (type <= MELO_FILE_DB_TYPE_SONG)
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "file,");
+  if (is_song)
+    g_string_append (columns, "file,");
   if (tags_fields & MELO_TAGS_FIELDS_TITLE)
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "title,");
+    g_string_append (columns, "title,");
   if (tags_fields & MELO_TAGS_FIELDS_ARTIST) {
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "artist,");
+    g_string_append (columns, "artist,");
     join_artist = TRUE;
   }
   if (tags_fields & MELO_TAGS_FIELDS_ALBUM) {
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "album,");
+    g_string_append (columns, "album,");
     join_album = TRUE;
   }
   if (tags_fields & MELO_TAGS_FIELDS_GENRE) {
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "genre,");
+    g_string_append (columns, "genre,");
     join_genre = TRUE;
   }
   if (tags_fields & MELO_TAGS_FIELDS_DATE)
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "date,");
+    g_string_append (columns, "date,");
   if (tags_fields & MELO_TAGS_FIELDS_TRACK)
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "track,");
+    g_string_append (columns, "track,");
   if (tags_fields & MELO_TAGS_FIELDS_TRACKS)
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len, "tracks,");
+    g_string_append (columns, "tracks,");
+  if (tags_fields & MELO_TAGS_FIELDS_DURATION)
+    g_string_append (columns, "duration,");
+  if (tags_fields & MELO_TAGS_FIELDS_BITRATE)
+    g_string_append (columns, "bitrate,");
+  if (tags_fields & MELO_TAGS_FIELDS_SAMPLERATE)
+    g_string_append (columns, "samplerate,");
+  if (tags_fields & MELO_TAGS_FIELDS_CHANNELS)
+    g_string_append (columns, "channels,");
   if (tags_fields & MELO_TAGS_FIELDS_COVER_URL)
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len,
-                     type <= MELO_FILE_DB_TYPE_SONG ? "song.cover," : "cover,");
+    g_string_append (columns, is_song ? "song.cover," : "cover,");
   if (tags_fields & MELO_TAGS_FIELDS_COVER)
-    len += g_snprintf (columns+len, MELO_FILE_DB_COLUMN_SIZE-len,
-                     type <= MELO_FILE_DB_TYPE_SONG ? "song.cover," : "cover,");
-  if (len)
-    columns[len-1] = '\0';
+    g_string_append (columns, is_song ? "song.cover," : "cover,");
+  g_string_truncate (columns, columns->len - 1);
 
-  /* Generate SQL request */
+  /* Get sort column: relevance order has no stable key to page with */
+  id_col = is_song ? "song.rowid" : "rowid";
+  if (sort != MELO_FILE_DB_SORT_NONE && sort < MELO_FILE_DB_SORT_COUNT * 2) {
+    desc = sort > MELO_FILE_DB_SORT_COUNT;
+    order = melo_file_db_order_string[desc ? sort - MELO_FILE_DB_SORT_COUNT :
+                                             sort];
+
+    /* Artist, album and genre are sorted with their aggregates */
+    if (!is_song && !g_strcmp0 (order, "date"))
+      order = "song_date";
+    else if (!is_song && !g_strcmp0 (order, "tracks"))
+      order = "song_count";
+
+    /* Simple search has no relevance */
+    if (!priv->fts && !g_strcmp0 (order, "rank"))
+      order = "title_key";
+  }
+  if (order && sort != MELO_FILE_DB_SORT_RANK &&
+      sort != MELO_FILE_DB_SORT_AS_DESC (MELO_FILE_DB_SORT_RANK) &&
+      (prev_token || next_token)) {
+    /* Add sort key as last column in order to generate tokens */
+    for (i = 0, key_col = 1; i < columns->len; i++)
+      if (columns->str[i] == ',')
+        key_col++;
+    g_string_append_printf (columns, ",%s", order);
+
+    /* Start list after / before entry described by token */
+    use_token = melo_file_db_parse_token (token, sort, &backward, &token_id,
+                                          &token_key);
+  }
+
+  /* Generate conditions: only field names are part of the request, values are
+   * bound later, so the same compiled statement can be reused from cache.
+   */
+  conds = g_string_new (NULL);
   while (pos < MELO_FILE_DB_COND_COUNT && field != MELO_FILE_DB_FIELDS_END) {
+    const gchar *col;
+
+    /* Get column and value */
     switch (field) {
       case MELO_FILE_DB_FIELDS_PATH:
-        conds[pos++] = sqlite3_mprintf ("path = '%q'",
-                                        va_arg (args, const gchar *));
         join_path = TRUE;
-        break;
-      case MELO_FILE_DB_FIELDS_PATH_ID:
-        conds[pos++] = sqlite3_mprintf ("path_id = %d",
-                                        va_arg (args, gint));
+        values[pos].is_string = TRUE;
+        values[pos].string = va_arg (args, const gchar *);
+        if (!path_key) {
+          path_key = melo_file_db_volume_to_key (priv, values[pos].string);
+          if (path_key)
+            values[pos].string = path_key;
+        }
         break;
       case MELO_FILE_DB_FIELDS_FILE:
-        conds[pos++] = sqlite3_mprintf ("file = '%q'",
-                                        va_arg (args, const gchar *));
-        break;
-      case MELO_FILE_DB_FIELDS_FILE_ID:
-        conds[pos++] = sqlite3_mprintf ("song.rowid = '%d'",
-                                        va_arg (args, gint));
-        break;
       case MELO_FILE_DB_FIELDS_TITLE:
-        conds[pos++] = sqlite3_mprintf ("title = '%q'",
-                                        va_arg (args, const gchar *));
+        values[pos].is_string = TRUE;
+        values[pos].string = va_arg (args, const gchar *);
         break;
       case MELO_FILE_DB_FIELDS_ARTIST:
-        conds[pos++] = sqlite3_mprintf ("artist = '%q'",
-                                        va_arg (args, const gchar *));
         join_artist = TRUE;
-        break;
-      case MELO_FILE_DB_FIELDS_ARTIST_ID:
-        conds[pos++] = sqlite3_mprintf ("artist_id = '%d'",
-                                        va_arg (args, gint));
+        values[pos].is_string = TRUE;
+        values[pos].string = va_arg (args, const gchar *);
         break;
       case MELO_FILE_DB_FIELDS_ALBUM:
-        conds[pos++] = sqlite3_mprintf ("album = '%q'",
-                                        va_arg (args, const gchar *));
         join_album = TRUE;
-        break;
-      case MELO_FILE_DB_FIELDS_ALBUM_ID:
-        conds[pos++] = sqlite3_mprintf ("album_id = '%d'",
-                                        va_arg (args, gint));
+        values[pos].is_string = TRUE;
+        values[pos].string = va_arg (args, const gchar *);
         break;
       case MELO_FILE_DB_FIELDS_GENRE:
-        conds[pos++] = sqlite3_mprintf ("genre = '%q'",
-                                        va_arg (args, const gchar *));
         join_genre = TRUE;
+        values[pos].is_string = TRUE;
+        values[pos].string = va_arg (args, const gchar *);
         break;
-      case MELO_FILE_DB_FIELDS_GENRE_ID:
-        conds[pos++] = sqlite3_mprintf ("genre_id = '%d'",
-                                        va_arg (args, gint));
+      case MELO_FILE_DB_FIELDS_SEARCH:
+        values[pos].is_string = TRUE;
+        values[pos].string = va_arg (args, const gchar *);
+
+        /* Search words in names when full-text search is not available */
+        if (!priv->fts) {
+          join_artist = join_album = join_genre = TRUE;
+          g_string_append_printf (conds, "%smelo_match (?,IFNULL(title,file),"
+                                  "artist,album,genre)", pos ? " AND " : "");
+          pos++;
+          field = va_arg (args, MeloFileDBFields);
+          continue;
+        }
+
+        /* Generate full-text query */
+        join_search = TRUE;
+        if (!match) {
+          match = melo_file_db_gen_match (values[pos].string);
+          values[pos].string = match;
+        }
         break;
+      case MELO_FILE_DB_FIELDS_PATH_ID:
+      case MELO_FILE_DB_FIELDS_FILE_ID:
+      case MELO_FILE_DB_FIELDS_ARTIST_ID:
+      case MELO_FILE_DB_FIELDS_ALBUM_ID:
+      case MELO_FILE_DB_FIELDS_GENRE_ID:
       case MELO_FILE_DB_FIELDS_DATE:
-        conds[pos++] = sqlite3_mprintf ("date = %d", va_arg (args, gint));
-        break;
       case MELO_FILE_DB_FIELDS_TRACK:
-        conds[pos++] = sqlite3_mprintf ("track = %d", va_arg (args, gint));
-        break;
       case MELO_FILE_DB_FIELDS_TRACKS:
-        conds[pos++] = sqlite3_mprintf ("tracks = %d", va_arg (args, gint));
+        values[pos].is_string = FALSE;
+        values[pos].value = va_arg (args, gint);
         break;
       default:
-        for (; pos; pos--)
-          sqlite3_free (conds[pos-1]);
-        goto error;
+        g_string_free (columns, TRUE);
+        g_string_free (conds, TRUE);
+        g_free (path_key);
+        g_free (match);
+        return FALSE;
     }
 
+    /* ID of the listed table is its row ID */
+    col = melo_file_db_cond_string[field];
+    if ((type == MELO_FILE_DB_TYPE_ARTIST &&
+         field == MELO_FILE_DB_FIELDS_ARTIST_ID) ||
+        (type == MELO_FILE_DB_TYPE_ALBUM &&
+         field == MELO_FILE_DB_FIELDS_ALBUM_ID) ||
+        (type == MELO_FILE_DB_TYPE_GENRE &&
+         field == MELO_FILE_DB_FIELDS_GENRE_ID))
+      col = "rowid";
+
+    /* Add condition */
+    g_string_append_printf (conds, "%s%s = ?", pos ? " AND " : "", col);
+    pos++;
+
     /* Get next field */
     field = va_arg (args, MeloFileDBFields);
   }
-  conds[pos] = NULL;
+  if (!pos)
+    g_string_append (conds, "1");
 
-  /* Finalize condition */
-  if (pos) {
-    conditions = g_strjoinv (" AND ", conds);
-    for (; pos; pos--)
-      sqlite3_free (conds[pos-1]);
-  } else
-    conditions = g_strdup ("1");
+  /* Add keyset condition: (key, id) after / before token entry */
+  if (use_token) {
+    const gchar *op = desc != backward ? "<" : ">";
 
-  if (sort != MELO_FILE_DB_SORT_NONE && sort < MELO_FILE_DB_SORT_COUNT * 2) {
-    /* Setup order clause */
-    order = "ORDER BY ";
-    if (sort > MELO_FILE_DB_SORT_COUNT) {
-      order_col = melo_file_db_order_string[sort-MELO_FILE_DB_SORT_COUNT];
-      order_sort = " COLLATE NOCASE DESC";
-    } else {
-      order_col = melo_file_db_order_string[sort];
-      order_sort = " COLLATE NOCASE ASC";
-    }
+    g_string_append_printf (conds, " AND (%s %s ? OR (%s = ? AND %s %s ?))",
+                            order, op, order, id_col, op);
+    offset = 0;
   }
 
   /* Generate SQL request */
+  sql = g_string_new (NULL);
   switch (type) {
     case MELO_FILE_DB_TYPE_SONG:
     case MELO_FILE_DB_TYPE_FILE:
-      sql = sqlite3_mprintf ("SELECT %s FROM song %s %s %s %s WHERE %s %s%s%s "
-         "LIMIT %d,%d", columns,
-         join_artist ? "LEFT JOIN artist ON song.artist_id = artist.rowid" : "",
-         join_album ? "LEFT JOIN album ON song.album_id = album.rowid" : "",
-         join_genre ? "LEFT JOIN genre ON song.genre_id = genre.rowid" : "",
-         join_path ? "LEFT JOIN path ON song.path_id = path.rowid" : "",
-         conditions, order, order_col, order_sort, offset, count);
+      g_string_append_printf (sql, "SELECT %s FROM song", columns->str);
+      if (join_artist)
+        g_string_append (sql,
+                         " LEFT JOIN artist ON song.artist_id = artist.rowid");
+      if (join_album)
+        g_string_append (sql, " LEFT JOIN album ON song.album_id = album.rowid");
+      if (join_genre)
+        g_string_append (sql, " LEFT JOIN genre ON song.genre_id = genre.rowid");
+      if (join_path)
+        g_string_append (sql, " LEFT JOIN path ON song.path_id = path.rowid");
+      if (join_search)
+        g_string_append (sql, " JOIN song_fts ON song.rowid = song_fts.rowid");
       break;
     case MELO_FILE_DB_TYPE_ARTIST:
-      sql = sqlite3_mprintf ("SELECT %s FROM artist WHERE %s %s%s%s "
-                             "LIMIT %d,%d",
-                             columns, conditions, order, order_col, order_sort,
-                             offset, count);
+      g_string_append_printf (sql, "SELECT %s FROM artist", columns->str);
       break;
     case MELO_FILE_DB_TYPE_ALBUM:
-      sql = sqlite3_mprintf ("SELECT %s FROM album WHERE %s %s%s%s LIMIT %d,%d",
-                             columns, conditions, order, order_col, order_sort,
-                             offset, count);
+      g_string_append_printf (sql, "SELECT %s FROM album", columns->str);
       break;
     case MELO_FILE_DB_TYPE_GENRE:
-      sql = sqlite3_mprintf ("SELECT %s FROM genre WHERE %s %s%s%s LIMIT %d,%d",
-                             columns, conditions, order, order_col, order_sort,
-                             offset, count);
+      g_string_append_printf (sql, "SELECT %s FROM genre", columns->str);
       break;
     default:
-      sql = NULL;
+      g_string_free (columns, TRUE);
+      g_string_free (conds, TRUE);
+      g_string_free (sql, TRUE);
+      g_free (path_key);
+      g_free (match);
+      return FALSE;
+  }
+  g_string_append_printf (sql, " WHERE %s", conds->str);
+  g_string_free (columns, TRUE);
+  g_string_free (conds, TRUE);
+
+  /* Add order clause: row ID breaks ties so order is stable across pages */
+  if (order) {
+    const gchar *dir = desc != backward ? "DESC" : "ASC";
+
+    g_string_append_printf (sql, " ORDER BY %s %s, %s %s",
+                            order, dir, id_col, dir);
+  }
+
+  /* Add limit clause */
+  g_string_append (sql, " LIMIT ?,?");
+
+  /* Previous page is read backward: restore list order, with the same
+   * collation than the sort column
+   */
+  if (use_token && backward) {
+    const gchar *dir = desc ? "DESC" : "ASC";
+    const gchar *collate = strstr (order, " COLLATE ");
+
+    g_string_prepend (sql, "SELECT * FROM (");
+    g_string_append_printf (sql, ") ORDER BY %d%s %s, 1 %s",
+                            key_col + 1, collate ? collate : "", dir, dir);
+  }
+
+  /* Check out a database connection */
+  conn = melo_file_db_get_reader (priv);
+
+  /* Get compiled SQL request */
+  req = melo_file_db_prepare (conn, sql->str);
+  g_string_free (sql, TRUE);
+  if (!req) {
+    melo_file_db_put_reader (priv, conn);
+    g_free (path_key);
+    g_free (match);
+    return FALSE;
+  }
+
+  /* Bind values */
+  for (i = 0; i < pos; i++) {
+    if (values[i].is_string)
+      sqlite3_bind_text (req, i + 1, values[i].string, -1, SQLITE_STATIC);
+    else
+      sqlite3_bind_int (req, i + 1, values[i].value);
+  }
+  if (use_token) {
+    sqlite3_bind_text (req, ++pos, token_key, -1, SQLITE_STATIC);
+    sqlite3_bind_text (req, ++pos, token_key, -1, SQLITE_STATIC);
+    sqlite3_bind_int (req, ++pos, token_id);
   }
-  g_free (conditions);
+  sqlite3_bind_int (req, pos + 1, offset);
+  sqlite3_bind_int (req, pos + 2, count);
 
-  /* Do SQL request */
-  sqlite3_prepare_v2 (priv->db, sql, -1, &req, NULL);
-  sqlite3_free (sql);
+  /* Last key buffer is reused for each row */
+  if (key_col)
+    last_key = g_string_sized_new (64);
 
   while (sqlite3_step (req) == SQLITE_ROW) {
-    const gchar *path, *file;
+    const gchar *path = NULL, *file = NULL, *key;
     MeloTags *tags;
-    gint id, i = 0;
+    gchar *upath;
+    gboolean next;
+    gint id;
+
+    /* Save position of first and last entries */
+    if (key_col) {
+      id = sqlite3_column_int (req, 0);
+      if (!rows++) {
+        first_key = g_strdup (sqlite3_column_text (req, key_col));
+        first_id = id;
+      }
+      key = sqlite3_column_text (req, key_col);
+      g_string_assign (last_key, key ? key : "");
+      last_id = id;
+    }
+
+    /* Pass row view without any copy */
+    if (row_cb) {
+      MeloFileDBRow row = { 0 };
+
+      /* Get columns */
+      i = 0;
+      id = sqlite3_column_int (req, i++);
+      if (type == MELO_FILE_DB_TYPE_FILE)
+        path = sqlite3_column_text (req, i++);
+      if (is_song)
+        file = sqlite3_column_text (req, i++);
+      else {
+        row.song_count = sqlite3_column_int (req, i++);
+        row.song_date = sqlite3_column_int (req, i++);
+        row.song_duration = sqlite3_column_int (req, i++);
+      }
+      if (tags_fields & MELO_TAGS_FIELDS_TITLE)
+        row.title = sqlite3_column_text (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_ARTIST)
+        row.artist = sqlite3_column_text (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_ALBUM)
+        row.album = sqlite3_column_text (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_GENRE)
+        row.genre = sqlite3_column_text (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_DATE)
+        row.date = sqlite3_column_int (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_TRACK)
+        row.track = sqlite3_column_int (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_TRACKS)
+        row.tracks = sqlite3_column_int (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_DURATION)
+        row.duration = sqlite3_column_int (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_BITRATE)
+        row.bitrate = sqlite3_column_int (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_SAMPLERATE)
+        row.samplerate = sqlite3_column_int (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_CHANNELS)
+        row.channels = sqlite3_column_int (req, i++);
+      if (tags_fields & MELO_TAGS_FIELDS_COVER_URL)
+        row.cover = sqlite3_column_text (req, i++);
+
+      /* Call callback with current location of volume paths */
+      upath = melo_file_db_volume_from_key (priv, path);
+      next = row_cb (upath ? upath : path, file, id, &row, user_data);
+      g_free (upath);
+      if (!next)
+        goto error;
+      continue;
+    }
 
     /* Do not generate tags */
     if (!cb && (!utags || *utags))
@@ -663,13 +2278,14 @@ melo_file_db_vfind (MeloFileDB *db, MeloFileDBType type, GObject *obj,
     /* Create a new MeloTags */
     tags = melo_tags_new ();
     if (!tags)
-      goto error;;
+      goto error;
 
     /* Fill MeloTags */
+    i = 0;
     id = sqlite3_column_int (req, i++);
     if (type == MELO_FILE_DB_TYPE_FILE)
       path = sqlite3_column_text (req, i++);
-    if (type <= MELO_FILE_DB_TYPE_SONG)
+    if (is_song)
       file = sqlite3_column_text (req, i++);
     if (tags_fields & MELO_TAGS_FIELDS_TITLE)
       tags->title = g_strdup (sqlite3_column_text (req, i++));
@@ -685,6 +2301,14 @@ melo_file_db_vfind (MeloFileDB *db, MeloFileDBType type, GObject *obj,
       tags->track = sqlite3_column_int (req, i++);
     if (tags_fields & MELO_TAGS_FIELDS_TRACKS)
       tags->tracks = sqlite3_column_int (req, i++);
+    if (tags_fields & MELO_TAGS_FIELDS_DURATION)
+      tags->duration = sqlite3_column_int (req, i++);
+    if (tags_fields & MELO_TAGS_FIELDS_BITRATE)
+      tags->bitrate = sqlite3_column_int (req, i++);
+    if (tags_fields & MELO_TAGS_FIELDS_SAMPLERATE)
+      tags->samplerate = sqlite3_column_int (req, i++);
+    if (tags_fields & MELO_TAGS_FIELDS_CHANNELS)
+      tags->channels = sqlite3_column_int (req, i++);
     if (tags_fields & MELO_TAGS_FIELDS_COVER_URL)
       melo_tags_set_cover_url (tags, obj, sqlite3_column_text (req, i++), NULL);
     if (tags_fields & MELO_TAGS_FIELDS_COVER) {
@@ -694,7 +2318,7 @@ melo_file_db_vfind (MeloFileDB *db, MeloFileDBType type, GObject *obj,
       filename = sqlite3_column_text (req, i++);
       if (filename) {
         GMappedFile *file;
-        GBytes *cover;
+        GBytes *cover = NULL;
         const gchar *type;
         gchar *path;
 
@@ -719,19 +2343,48 @@ melo_file_db_vfind (MeloFileDB *db, MeloFileDBType type, GObject *obj,
     if (utags && !*utags)
       *utags = tags;
 
-    /* Call callback */
-    if (cb && !cb (path, file, id, tags, user_data))
-      goto error;
+    /* Call callback with current location of volume paths */
+    if (cb) {
+      upath = melo_file_db_volume_from_key (priv, path);
+      next = cb (upath ? upath : path, file, id, tags, user_data);
+      g_free (upath);
+      if (!next)
+        goto error;
+    }
   }
 
-  /* Finalize SQL request */
-  sqlite3_finalize (req);
+  /* Release SQL request and connection */
+  melo_file_db_release (conn, req);
+  melo_file_db_put_reader (priv, conn);
+
+  /* Generate tokens: a full page may be followed by another page */
+  if (rows) {
+    gboolean more = count >= 0 && rows >= count;
+
+    if (prev_token && ((backward && more) || (!backward && (use_token ||
+                                                            offset))))
+      *prev_token = g_strdup_printf ("p%d:%d:%s", sort, first_id,
+                                     first_key ? first_key : "");
+    if (next_token && ((!backward && more) || backward))
+      *next_token = g_strdup_printf ("n%d:%d:%s", sort, last_id,
+                                     last_key ? last_key->str : "");
+  }
+  g_free (first_key);
+  if (last_key)
+    g_string_free (last_key, TRUE);
+  g_free (path_key);
+  g_free (match);
 
   return TRUE;
 
 error:
-  if (req)
-    sqlite3_finalize (req);
+  melo_file_db_release (conn, req);
+  melo_file_db_put_reader (priv, conn);
+  g_free (first_key);
+  if (last_key)
+    g_string_free (last_key, TRUE);
+  g_free (path_key);
+  g_free (match);
   return FALSE;
 }
 
@@ -750,7 +2403,8 @@ error:
     /* Get tags */ \
     va_start (args, field_0); \
     melo_file_db_vfind (db, MELO_FILE_DB_TYPE_##utype, obj, NULL, NULL, \
-                        &tags, 0, 1, MELO_FILE_DB_SORT_NONE, tags_fields, \
+                        NULL, &tags, 0, 1, NULL, NULL, NULL, \
+                        MELO_FILE_DB_SORT_NONE, tags_fields, \
                         field_0, args); \
     va_end (args); \
    \
@@ -761,7 +2415,8 @@ error:
   melo_file_db_get_##type##_list (MeloFileDB *db, GObject *obj, \
                                   MeloFileDBGetList cb, gpointer user_data, \
                                   gint offset, gint count, \
-                                  MeloFileDBSort sort, \
+                                  const gchar *token, gchar **prev_token, \
+                                  gchar **next_token, MeloFileDBSort sort, \
                                   MeloTagsFields tags_fields, \
                                   MeloFileDBFields field_0, ...) \
   { \
@@ -774,7 +2429,34 @@ error:
     /* Get list */ \
     va_start (args, field_0); \
     ret = melo_file_db_vfind (db, MELO_FILE_DB_TYPE_##utype, obj, cb, \
-                              user_data, NULL, offset, count, sort, \
+                              NULL, user_data, NULL, offset, count, token, \
+                              prev_token, next_token, sort, \
+                              tags_fields, field_0, args); \
+    va_end (args); \
+   \
+    return ret; \
+  } \
+  \
+  gboolean \
+  melo_file_db_get_##type##_rows (MeloFileDB *db, GObject *obj, \
+                                  MeloFileDBGetRow cb, gpointer user_data, \
+                                  gint offset, gint count, \
+                                  const gchar *token, gchar **prev_token, \
+                                  gchar **next_token, MeloFileDBSort sort, \
+                                  MeloTagsFields tags_fields, \
+                                  MeloFileDBFields field_0, ...) \
+  { \
+    gboolean ret; \
+    va_list args; \
+   \
+    /* Apply filter on tags */ \
+    tags_fields &= filter; \
+   \
+    /* Get rows */ \
+    va_start (args, field_0); \
+    ret = melo_file_db_vfind (db, MELO_FILE_DB_TYPE_##utype, obj, NULL, cb, \
+                              user_data, NULL, offset, count, token, \
+                              prev_token, next_token, sort, \
                               tags_fields, field_0, args); \
     va_end (args); \
    \
@@ -792,3 +2474,58 @@ DEFINE_MELO_FILE_DB_GET (album, ALBUM, MELO_TAGS_FIELDS_ALBUM |
                                        MELO_FILE_DB_TAGS_FIELDS_COVER)
 DEFINE_MELO_FILE_DB_GET (genre, GENRE, MELO_TAGS_FIELDS_GENRE |
                                        MELO_FILE_DB_TAGS_FIELDS_COVER)
+
+gint
+melo_file_db_get_count (MeloFileDB *db, MeloFileDBFields field, gint id)
+{
+  MeloFileDBPrivate *priv = db->priv;
+  MeloFileDBConn *conn;
+  sqlite3_stmt *req;
+  const gchar *sql;
+  gint count = -1;
+
+  /* Select count to read */
+  switch (field) {
+    case MELO_FILE_DB_FIELDS_END:
+      sql = "SELECT songs FROM stats";
+      break;
+    case MELO_FILE_DB_FIELDS_ARTIST:
+      sql = "SELECT artists FROM stats";
+      break;
+    case MELO_FILE_DB_FIELDS_ALBUM:
+      sql = "SELECT albums FROM stats";
+      break;
+    case MELO_FILE_DB_FIELDS_GENRE:
+      sql = "SELECT genres FROM stats";
+      break;
+    case MELO_FILE_DB_FIELDS_ARTIST_ID:
+      sql = "SELECT song_count FROM artist WHERE rowid = ?";
+      break;
+    case MELO_FILE_DB_FIELDS_ALBUM_ID:
+      sql = "SELECT song_count FROM album WHERE rowid = ?";
+      break;
+    case MELO_FILE_DB_FIELDS_GENRE_ID:
+      sql = "SELECT song_count FROM genre WHERE rowid = ?";
+      break;
+    default:
+      return -1;
+  }
+
+  /* Check out a database connection */
+  conn = melo_file_db_get_reader (priv);
+
+  /* Get count */
+  req = melo_file_db_prepare (conn, sql);
+  if (req) {
+    if (sqlite3_bind_parameter_count (req))
+      sqlite3_bind_int (req, 1, id);
+    if (sqlite3_step (req) == SQLITE_ROW)
+      count = sqlite3_column_int (req, 0);
+    melo_file_db_release (conn, req);
+  }
+
+  /* Release connection */
+  melo_file_db_put_reader (priv, conn);
+
+  return count;
+}
@@ -66,6 +66,8 @@ typedef enum {
   MELO_FILE_DB_FIELDS_DATE,
   MELO_FILE_DB_FIELDS_TRACK,
   MELO_FILE_DB_FIELDS_TRACKS,
+  /* Words to search in title, artist, album and genre (songs only) */
+  MELO_FILE_DB_FIELDS_SEARCH,
 
   /* Fields count */
   MELO_FILE_DB_FIELDS_COUNT
@@ -81,6 +83,8 @@ typedef enum {
   MELO_FILE_DB_SORT_DATE,
   MELO_FILE_DB_SORT_TRACK,
   MELO_FILE_DB_SORT_TRACKS,
+  /* Relevance of a search (best first), or title without full-text index */
+  MELO_FILE_DB_SORT_RANK,
 
   /* Sort count */
   MELO_FILE_DB_SORT_COUNT
@@ -93,9 +97,41 @@ GType melo_file_db_get_type (void);
 MeloFileDB *melo_file_db_new (const gchar *file, const gchar *cover_path);
 const gchar *melo_file_db_get_cover_path (MeloFileDB *db);
 
+/* Group insertions in a single transaction: rows are committed at least
+ * every second. melo_file_db_batch_begin() returns FALSE when transaction
+ * cannot be started (rows are then written immediately) and
+ * melo_file_db_batch_end() returns FALSE if a commit of the batch failed.
+ * Each call to melo_file_db_batch_begin() must be followed by a call to
+ * melo_file_db_batch_end().
+ */
+gboolean melo_file_db_batch_begin (MeloFileDB *db);
+gboolean melo_file_db_batch_end (MeloFileDB *db);
+
+/* Removable volumes: paths on a mounted volume are stored relative to its
+ * UUID, so songs of a volume are found again at any mount point.
+ */
+void melo_file_db_add_volume (MeloFileDB *db, const gchar *uuid,
+                              const gchar *root);
+void melo_file_db_remove_volume (MeloFileDB *db, const gchar *root);
+
 gboolean melo_file_db_get_path_id (MeloFileDB *db, const gchar *path,
                                    gboolean add, gint *path_id);
 
+gboolean melo_file_db_get_song_timestamp (MeloFileDB *db, gint path_id,
+                                          const gchar *filename,
+                                          gint *timestamp);
+
+/* List file names of songs in a path, and a path with all its sub-paths */
+GList *melo_file_db_get_path_files (MeloFileDB *db, gint path_id);
+GList *melo_file_db_get_sub_paths (MeloFileDB *db, const gchar *path);
+
+/* Remove a song, or a path with all its sub-paths and songs: empty paths and
+ * unused artists, albums and genres are removed with last song.
+ */
+gboolean melo_file_db_remove_song (MeloFileDB *db, gint path_id,
+                                   const gchar *filename);
+gboolean melo_file_db_remove_path (MeloFileDB *db, const gchar *path);
+
 gboolean melo_file_db_add_tags (MeloFileDB *db, const gchar *path,
                                 const gchar *filename, gint timestamp,
                                 MeloTags *tags, gchar **cover_out_file);
@@ -121,37 +157,119 @@ typedef gboolean (*MeloFileDBGetList) (const gchar *path, const gchar *file,
                                        gint id, MeloTags *tags,
                                        gpointer user_data);
 
-/* Get browser item list */
+/* Borrowed view of a result row: strings are only valid during the callback
+ * call and cover is the cover file name in database (cover data is never
+ * loaded). For artists, albums and genres, song_count, song_date and
+ * song_duration are the song count, the date of the last song and the total
+ * duration: song tags (date, track, tracks, ...) are never set.
+ */
+typedef struct _MeloFileDBRow MeloFileDBRow;
+
+struct _MeloFileDBRow {
+  const gchar *title;
+  const gchar *artist;
+  const gchar *album;
+  const gchar *genre;
+  gint date;
+  guint track;
+  guint tracks;
+  gint duration;
+  guint bitrate;
+  guint samplerate;
+  guint channels;
+  const gchar *cover;
+  guint song_count;
+  gint song_date;
+  gint song_duration;
+};
+
+typedef gboolean (*MeloFileDBGetRow) (const gchar *path, const gchar *file,
+                                      gint id, const MeloFileDBRow *row,
+                                      gpointer user_data);
+
+/* Get entries count: songs (MELO_FILE_DB_FIELDS_END), artists, albums or
+ * genres (MELO_FILE_DB_FIELDS_ARTIST, ...) or songs of an artist, an album or
+ * a genre (MELO_FILE_DB_FIELDS_ARTIST_ID, ..., with its ID).
+ */
+gint melo_file_db_get_count (MeloFileDB *db, MeloFileDBFields field, gint id);
+
+/* Get browser item list: when prev_token and / or next_token are set, tokens
+ * to get the previous and next pages are generated. A token replaces offset.
+ */
 gboolean melo_file_db_get_file_list (MeloFileDB *db, GObject *obj,
                                      MeloFileDBGetList cb, gpointer user_data,
                                      gint offset, gint count,
-                                     MeloFileDBSort sort,
+                                     const gchar *token, gchar **prev_token,
+                                     gchar **next_token, MeloFileDBSort sort,
                                      MeloTagsFields tags_fields,
                                      MeloFileDBFields field_0, ...);
 gboolean melo_file_db_get_song_list (MeloFileDB *db, GObject *obj,
                                      MeloFileDBGetList cb, gpointer user_data,
                                      gint offset, gint count,
-                                     MeloFileDBSort sort,
+                                     const gchar *token, gchar **prev_token,
+                                     gchar **next_token, MeloFileDBSort sort,
                                      MeloTagsFields tags_fields,
                                      MeloFileDBFields field_0, ...);
 gboolean melo_file_db_get_artist_list (MeloFileDB *db, GObject *obj,
                                      MeloFileDBGetList cb, gpointer user_data,
                                      gint offset, gint count,
-                                     MeloFileDBSort sort,
+                                     const gchar *token, gchar **prev_token,
+                                     gchar **next_token, MeloFileDBSort sort,
                                      MeloTagsFields tags_fields,
                                      MeloFileDBFields field_0, ...);
 gboolean melo_file_db_get_album_list (MeloFileDB *db, GObject *obj,
                                      MeloFileDBGetList cb, gpointer user_data,
                                      gint offset, gint count,
-                                     MeloFileDBSort sort,
+                                     const gchar *token, gchar **prev_token,
+                                     gchar **next_token, MeloFileDBSort sort,
                                      MeloTagsFields tags_fields,
                                      MeloFileDBFields field_0, ...);
 gboolean melo_file_db_get_genre_list (MeloFileDB *db, GObject *obj,
                                      MeloFileDBGetList cb, gpointer user_data,
                                      gint offset, gint count,
-                                     MeloFileDBSort sort,
+                                     const gchar *token, gchar **prev_token,
+                                     gchar **next_token, MeloFileDBSort sort,
+                                     MeloTagsFields tags_fields,
+                                     MeloFileDBFields field_0, ...);
+
+/* Same as melo_file_db_get_*_list() but rows are passed to callback without
+ * any MeloTags creation.
+ */
+gboolean melo_file_db_get_file_rows (MeloFileDB *db, GObject *obj,
+                                     MeloFileDBGetRow cb, gpointer user_data,
+                                     gint offset, gint count,
+                                     const gchar *token, gchar **prev_token,
+                                     gchar **next_token, MeloFileDBSort sort,
+                                     MeloTagsFields tags_fields,
+                                     MeloFileDBFields field_0, ...);
+gboolean melo_file_db_get_song_rows (MeloFileDB *db, GObject *obj,
+                                     MeloFileDBGetRow cb, gpointer user_data,
+                                     gint offset, gint count,
+                                     const gchar *token, gchar **prev_token,
+                                     gchar **next_token, MeloFileDBSort sort,
                                      MeloTagsFields tags_fields,
                                      MeloFileDBFields field_0, ...);
+gboolean melo_file_db_get_artist_rows (MeloFileDB *db, GObject *obj,
+                                       MeloFileDBGetRow cb, gpointer user_data,
+                                       gint offset, gint count,
+                                       const gchar *token, gchar **prev_token,
+                                       gchar **next_token, MeloFileDBSort sort,
+                                       MeloTagsFields tags_fields,
+                                       MeloFileDBFields field_0, ...);
+gboolean melo_file_db_get_album_rows (MeloFileDB *db, GObject *obj,
+                                      MeloFileDBGetRow cb, gpointer user_data,
+                                      gint offset, gint count,
+                                      const gchar *token, gchar **prev_token,
+                                      gchar **next_token, MeloFileDBSort sort,
+                                      MeloTagsFields tags_fields,
+                                      MeloFileDBFields field_0, ...);
+gboolean melo_file_db_get_genre_rows (MeloFileDB *db, GObject *obj,
+                                      MeloFileDBGetRow cb, gpointer user_data,
+                                      gint offset, gint count,
+                                      const gchar *token, gchar **prev_token,
+                                      gchar **next_token, MeloFileDBSort sort,
+                                      MeloTagsFields tags_fields,
+                                      MeloFileDBFields field_0, ...);
 
 G_END_DECLS
 
@@ -0,0 +1,239 @@
+/*
+ * melo_file_jsonrpc.c: File module JSON-RPC interface
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "melo_jsonrpc.h"
+
+#include "melo_file_jsonrpc.h"
+
+/* Default path to scan */
+static gchar *melo_file_jsonrpc_local_path;
+
+static JsonNode *
+melo_file_jsonrpc_status_to_node (MeloScannerFile *scanner)
+{
+  MeloScannerFileStatus *status;
+  JsonNode *node;
+  JsonObject *o;
+
+  /* Get scan status */
+  status = melo_scanner_file_get_status (scanner);
+
+  /* Fill object */
+  o = json_object_new ();
+  json_object_set_string_member (o, "state",
+                          melo_scanner_file_state_to_string (status->state));
+  json_object_set_string_member (o, "path", status->path);
+  json_object_set_int_member (o, "dirs", status->dirs);
+  json_object_set_int_member (o, "files", status->files);
+  json_object_set_int_member (o, "scanned", status->scanned);
+  json_object_set_int_member (o, "skipped", status->skipped);
+  json_object_set_int_member (o, "failed", status->failed);
+  melo_scanner_file_status_free (status);
+
+  /* Create node */
+  node = json_node_new (JSON_NODE_OBJECT);
+  json_node_take_object (node, o);
+
+  return node;
+}
+
+static gchar *
+melo_file_jsonrpc_get_scan_path (const gchar *path)
+{
+  gchar *root, *real, *ret = NULL;
+  gsize len;
+
+  /* Resolve links and relative components of both paths */
+  root = realpath (melo_file_jsonrpc_local_path, NULL);
+  real = realpath (path, NULL);
+  if (!root || !real)
+    goto end;
+
+  /* Only local path and its sub-directories can be scanned */
+  len = strlen (root);
+  if (len && root[len - 1] == '/')
+    len--;
+  if (strncmp (real, root, len) || (real[len] != '\0' && real[len] != '/'))
+    goto end;
+
+  /* Rebase on local path so paths match the ones of file browser */
+  ret = g_strconcat (melo_file_jsonrpc_local_path, real + len, NULL);
+
+end:
+  free (root);
+  free (real);
+  return ret;
+}
+
+/* Method callbacks */
+static void
+melo_file_jsonrpc_scan (const gchar *method,
+                        MeloJSONRPCSchema *s_params, JsonNode *params,
+                        JsonNode **result, JsonNode **error,
+                        gpointer user_data)
+{
+  MeloScannerFile *scanner = MELO_SCANNER_FILE (user_data);
+  const gchar *path = melo_file_jsonrpc_local_path;
+  JsonObject *obj;
+  gchar *scan_path;
+
+  /* Get parameters */
+  obj = melo_jsonrpc_get_object (s_params, params, error);
+  if (!obj)
+    return;
+
+  /* Get path to scan */
+  if (json_object_has_member (obj, "path"))
+    path = json_object_get_string_member (obj, "path");
+
+  /* Check path is in local path */
+  scan_path = path ? melo_file_jsonrpc_get_scan_path (path) : NULL;
+  json_object_unref (obj);
+  if (!scan_path) {
+    *error = melo_jsonrpc_build_error_node (MELO_JSONRPC_ERROR_INVALID_PARAMS,
+                                            "Path is not in local path");
+    return;
+  }
+
+  /* Start scan */
+  if (!melo_scanner_file_start (scanner, scan_path)) {
+    *error = melo_jsonrpc_build_error_node (MELO_JSONRPC_ERROR_INVALID_PARAMS,
+                                            "Scan already running or no path");
+    g_free (scan_path);
+    return;
+  }
+  g_free (scan_path);
+
+  /* Return status */
+  *result = melo_file_jsonrpc_status_to_node (scanner);
+}
+
+static void
+melo_file_jsonrpc_scan_control (const gchar *method,
+                                MeloJSONRPCSchema *s_params, JsonNode *params,
+                                JsonNode **result, JsonNode **error,
+                                gpointer user_data)
+{
+  MeloScannerFile *scanner = MELO_SCANNER_FILE (user_data);
+
+  /* Pause, resume or stop scan */
+  if (!g_strcmp0 (method, "file.scan_pause"))
+    melo_scanner_file_pause (scanner);
+  else if (!g_strcmp0 (method, "file.scan_resume"))
+    melo_scanner_file_resume (scanner);
+  else if (!g_strcmp0 (method, "file.scan_stop"))
+    melo_scanner_file_stop (scanner);
+
+  /* Return status */
+  *result = melo_file_jsonrpc_status_to_node (scanner);
+}
+
+/* List of methods */
+static MeloJSONRPCMethod melo_file_jsonrpc_methods[] = {
+  {
+    .method = "scan",
+    .params = "["
+              "  {"
+              "    \"name\": \"path\", \"type\": \"string\","
+              "    \"required\": false"
+              "  }"
+              "]",
+    .result = "{\"type\":\"object\"}",
+    .callback = melo_file_jsonrpc_scan,
+    .user_data = NULL,
+  },
+  {
+    .method = "scan_pause",
+    .params = "[]",
+    .result = "{\"type\":\"object\"}",
+    .callback = melo_file_jsonrpc_scan_control,
+    .user_data = NULL,
+  },
+  {
+    .method = "scan_resume",
+    .params = "[]",
+    .result = "{\"type\":\"object\"}",
+    .callback = melo_file_jsonrpc_scan_control,
+    .user_data = NULL,
+  },
+  {
+    .method = "scan_stop",
+    .params = "[]",
+    .result = "{\"type\":\"object\"}",
+    .callback = melo_file_jsonrpc_scan_control,
+    .user_data = NULL,
+  },
+  {
+    .method = "get_scan_status",
+    .params = "[]",
+    .result = "{\"type\":\"object\"}",
+    .callback = melo_file_jsonrpc_scan_control,
+    .user_data = NULL,
+  },
+};
+
+/* Register / Unregister methods */
+void
+melo_file_jsonrpc_register_methods (MeloScannerFile *scanner,
+                                    const gchar *local_path)
+{
+  guint i;
+
+  /* Save default path to scan */
+  g_free (melo_file_jsonrpc_local_path);
+  melo_file_jsonrpc_local_path = g_strdup (local_path);
+
+  /* Add scanner to methods array */
+  g_object_ref (scanner);
+  for (i = 0; i < G_N_ELEMENTS (melo_file_jsonrpc_methods); i++) {
+    melo_file_jsonrpc_methods[i].user_data = scanner;
+  }
+
+  /* Register new methods */
+  melo_jsonrpc_register_methods ("file", melo_file_jsonrpc_methods,
+                                 G_N_ELEMENTS (melo_file_jsonrpc_methods));
+}
+
+void
+melo_file_jsonrpc_unregister_methods (void)
+{
+  guint i;
+
+  /* Methods have not been registered */
+  if (!melo_file_jsonrpc_methods[0].user_data)
+    return;
+
+  /* Unregister new methods */
+  melo_jsonrpc_unregister_methods ("file", melo_file_jsonrpc_methods,
+                                   G_N_ELEMENTS (melo_file_jsonrpc_methods));
+
+  /* Unref scanner object and remove it from methods array */
+  g_object_unref (MELO_SCANNER_FILE (melo_file_jsonrpc_methods[0].user_data));
+  for (i = 0; i < G_N_ELEMENTS (melo_file_jsonrpc_methods); i++)
+    melo_file_jsonrpc_methods[i].user_data = NULL;
+
+  /* Free default path */
+  g_free (melo_file_jsonrpc_local_path);
+  melo_file_jsonrpc_local_path = NULL;
+}
@@ -21,6 +21,8 @@
 
 #include <string.h>
 
+#include "melo_browser_jsonrpc.h"
+
 #include "melo_library_file.h"
 
 /* File library info */
@@ -28,8 +30,8 @@ static MeloBrowserInfo melo_library_file_info = {
   .name = "Browse media library",
   .description = "Navigate though whole media library",
   /* Search support */
-  .search_support = FALSE,
-  .search_hint_support = FALSE,
+  .search_support = TRUE,
+  .search_hint_support = TRUE,
   .search_input_text = "Search a media by title, artist or album...",
   .search_button_text = "Search",
   /* Tags support */
@@ -44,6 +46,22 @@ static MeloBrowserList *melo_library_file_get_list (MeloBrowser *browser,
                                                   const gchar *token,
                                                   MeloBrowserTagsMode tags_mode,
                                                   MeloTagsFields tags_fields);
+static gboolean melo_library_file_write_list (MeloBrowser *browser,
+                                              const gchar *path,
+                                              gint offset, gint count,
+                                              const gchar *token,
+                                              MeloBrowserTagsMode tags_mode,
+                                              MeloTagsFields tags_fields,
+                                              MeloBrowserList *list,
+                                              MeloBrowserListWriter *writer);
+static MeloBrowserList *melo_library_file_search (MeloBrowser *browser,
+                                                  const gchar *input,
+                                                  gint offset, gint count,
+                                                  const gchar *token,
+                                                  MeloBrowserTagsMode tags_mode,
+                                                  MeloTagsFields tags_fields);
+static gchar *melo_library_file_search_hint (MeloBrowser *browser,
+                                             const gchar *input);
 static MeloTags *melo_library_file_get_tags (MeloBrowser *browser,
                                              const gchar *path,
                                              MeloTagsFields fields);
@@ -63,6 +81,16 @@ typedef enum {
   MELO_LIBRARY_FILE_TYPE_GENRE,
 } MeloLibraryFileType;
 
+typedef struct {
+  GObject *obj;
+  MeloFileDB *fdb;
+  MeloBrowserListWriter *writer;
+  MeloLibraryFileType type;
+  MeloTagsFields tags_fields;
+  gint64 timestamp;
+  GString *url;
+} MeloLibraryFileWriter;
+
 struct _MeloLibraryFilePrivate {
   GMutex mutex;
   MeloFileDB *fdb;
@@ -92,6 +120,9 @@ melo_library_file_class_init (MeloLibraryFileClass *klass)
 
   bclass->get_info = melo_library_file_get_info;
   bclass->get_list = melo_library_file_get_list;
+  bclass->write_list = melo_library_file_write_list;
+  bclass->search = melo_library_file_search;
+  bclass->search_hint = melo_library_file_search_hint;
   bclass->get_tags = melo_library_file_get_tags;
   bclass->add = melo_library_file_add;
   bclass->play = melo_library_file_play;
@@ -256,90 +287,122 @@ melo_library_file_gen_genre (const gchar *path, const gchar *file, gint id,
 }
 
 static gboolean
-melo_library_file_get_title_list (MeloLibraryFile *lfile, GList **list,
-                                  gint offset, gint count,
+melo_library_file_get_title_list (MeloLibraryFile *lfile,
+                                  MeloBrowserList *list, gint offset,
+                                  gint count, const gchar *token,
                                   MeloTagsFields tags_fields)
 {
   MeloLibraryFilePrivate *priv = lfile->priv;
   GObject *obj = G_OBJECT (lfile);
 
+  /* Get song count */
+  list->count = melo_file_db_get_count (priv->fdb, MELO_FILE_DB_FIELDS_END, 0);
+
   return melo_file_db_get_song_list (priv->fdb, obj,
-                                     melo_library_file_gen_title, list, offset,
-                                     count, MELO_FILE_DB_SORT_TITLE,
+                                     melo_library_file_gen_title, &list->items,
+                                     offset, count, token, &list->prev_token,
+                                     &list->next_token, MELO_FILE_DB_SORT_TITLE,
                                      tags_fields, MELO_FILE_DB_FIELDS_END);
 }
 
 static gboolean
-melo_library_file_get_artist_list (MeloLibraryFile *lfile, GList **list,
-                                   gint id, gint offset, gint count,
+melo_library_file_get_artist_list (MeloLibraryFile *lfile,
+                                   MeloBrowserList *list, gint id, gint offset,
+                                   gint count, const gchar *token,
                                    MeloTagsFields tags_fields)
 {
   MeloLibraryFilePrivate *priv = lfile->priv;
   GObject *obj = G_OBJECT (lfile);
 
   /* Get song list with artist ID */
-  if (id >= 0)
+  if (id >= 0) {
+    list->count = melo_file_db_get_count (priv->fdb,
+                                        MELO_FILE_DB_FIELDS_ARTIST_ID, id);
     return melo_file_db_get_song_list (priv->fdb, obj,
-                                       melo_library_file_gen_title, list,
-                                       offset, count, MELO_FILE_DB_SORT_TITLE,
-                                       tags_fields,
+                                       melo_library_file_gen_title,
+                                       &list->items, offset, count, token,
+                                       &list->prev_token, &list->next_token,
+                                       MELO_FILE_DB_SORT_TITLE, tags_fields,
                                        MELO_FILE_DB_FIELDS_ARTIST_ID, id,
                                        MELO_FILE_DB_FIELDS_END);
+  }
 
   /* Get artist list */
+  list->count = melo_file_db_get_count (priv->fdb,
+                                        MELO_FILE_DB_FIELDS_ARTIST, 0);
   return melo_file_db_get_artist_list (priv->fdb, obj,
-                                       melo_library_file_gen_artist, list,
-                                       offset, count, MELO_FILE_DB_SORT_ARTIST,
+                                       melo_library_file_gen_artist,
+                                       &list->items, offset, count, token,
+                                       &list->prev_token, &list->next_token,
+                                       MELO_FILE_DB_SORT_ARTIST,
                                        tags_fields | MELO_TAGS_FIELDS_ARTIST,
                                        MELO_FILE_DB_FIELDS_END);
 }
 
 static gboolean
-melo_library_file_get_album_list (MeloLibraryFile *lfile, GList **list,
-                                  gint id, gint offset, gint count,
+melo_library_file_get_album_list (MeloLibraryFile *lfile,
+                                  MeloBrowserList *list, gint id, gint offset,
+                                  gint count, const gchar *token,
                                   MeloTagsFields tags_fields)
 {
   MeloLibraryFilePrivate *priv = lfile->priv;
   GObject *obj = G_OBJECT (lfile);
 
   /* Get song list with album ID */
-  if (id >= 0)
+  if (id >= 0) {
+    list->count = melo_file_db_get_count (priv->fdb,
+                                        MELO_FILE_DB_FIELDS_ALBUM_ID, id);
     return melo_file_db_get_song_list (priv->fdb, obj,
-                                       melo_library_file_gen_title, list,
-                                       offset, count, MELO_FILE_DB_SORT_TITLE,
-                                       tags_fields,
+                                       melo_library_file_gen_title,
+                                       &list->items, offset, count, token,
+                                       &list->prev_token, &list->next_token,
+                                       MELO_FILE_DB_SORT_TITLE, tags_fields,
                                        MELO_FILE_DB_FIELDS_ALBUM_ID, id,
                                        MELO_FILE_DB_FIELDS_END);
+  }
 
   /* Get album list */
+  list->count = melo_file_db_get_count (priv->fdb,
+                                        MELO_FILE_DB_FIELDS_ALBUM, 0);
   return melo_file_db_get_album_list (priv->fdb, obj,
-                                      melo_library_file_gen_album, list,
-                                      offset, count, MELO_FILE_DB_SORT_ALBUM,
+                                      melo_library_file_gen_album,
+                                      &list->items, offset, count, token,
+                                      &list->prev_token, &list->next_token,
+                                      MELO_FILE_DB_SORT_ALBUM,
                                       tags_fields | MELO_TAGS_FIELDS_ALBUM,
                                       MELO_FILE_DB_FIELDS_END);
 }
 
 static gboolean
-melo_library_file_get_genre_list (MeloLibraryFile *lfile, GList **list,
-                                  gint id, gint offset, gint count,
+melo_library_file_get_genre_list (MeloLibraryFile *lfile,
+                                  MeloBrowserList *list, gint id, gint offset,
+                                  gint count, const gchar *token,
                                   MeloTagsFields tags_fields)
 {
   MeloLibraryFilePrivate *priv = lfile->priv;
   GObject *obj = G_OBJECT (lfile);
 
   /* Get song list with genre ID */
-  if (id >= 0)
+  if (id >= 0) {
+    list->count = melo_file_db_get_count (priv->fdb,
+                                        MELO_FILE_DB_FIELDS_GENRE_ID, id);
     return melo_file_db_get_song_list (priv->fdb, obj,
-                                       melo_library_file_gen_title, list,
-                                       offset, count, MELO_FILE_DB_SORT_TITLE,
-                                       tags_fields,
+                                       melo_library_file_gen_title,
+                                       &list->items, offset, count, token,
+                                       &list->prev_token, &list->next_token,
+                                       MELO_FILE_DB_SORT_TITLE, tags_fields,
                                        MELO_FILE_DB_FIELDS_GENRE_ID, id,
                                        MELO_FILE_DB_FIELDS_END);
+  }
 
   /* Get genre list */
+  list->count = melo_file_db_get_count (priv->fdb,
+                                        MELO_FILE_DB_FIELDS_GENRE, 0);
   return melo_file_db_get_genre_list (priv->fdb, obj,
-                                      melo_library_file_gen_genre, list,
-                                      offset, count, MELO_FILE_DB_SORT_GENRE,
+                                      melo_library_file_gen_genre,
+                                      &list->items, offset, count, token,
+                                      &list->prev_token, &list->next_token,
+                                      MELO_FILE_DB_SORT_GENRE,
                                       tags_fields | MELO_TAGS_FIELDS_GENRE,
                                       MELO_FILE_DB_FIELDS_END);
 }
@@ -400,19 +463,19 @@ melo_library_file_get_list (MeloBrowser *browser, const gchar *path,
   /* Get list */
   switch (type) {
     case MELO_LIBRARY_FILE_TYPE_TITLE:
-      melo_library_file_get_title_list (lfile, &list->items, offset, count,
+      melo_library_file_get_title_list (lfile, list, offset, count, token,
                                         tags_fields);
       break;
     case MELO_LIBRARY_FILE_TYPE_ARTIST:
-      melo_library_file_get_artist_list (lfile, &list->items, id, offset, count,
+      melo_library_file_get_artist_list (lfile, list, id, offset, count, token,
                                          tags_fields);
       break;
     case MELO_LIBRARY_FILE_TYPE_ALBUM:
-      melo_library_file_get_album_list (lfile, &list->items, id, offset, count,
+      melo_library_file_get_album_list (lfile, list, id, offset, count, token,
                                         tags_fields);
       break;
     case MELO_LIBRARY_FILE_TYPE_GENRE:
-      melo_library_file_get_genre_list (lfile, &list->items, id, offset, count,
+      melo_library_file_get_genre_list (lfile, list, id, offset, count, token,
                                         tags_fields);
       break;
   }
@@ -423,6 +486,368 @@ melo_library_file_get_list (MeloBrowser *browser, const gchar *path,
   return list;
 }
 
+static void
+melo_library_file_write_tags (MeloLibraryFileWriter *lwriter,
+                              MeloJSONWriter *w, const MeloFileDBRow *row)
+{
+  MeloTagsFields fields = lwriter->tags_fields;
+  gboolean cover_type = FALSE;
+
+  /* Artists, albums and genres have no song tags */
+  if (lwriter->type != MELO_LIBRARY_FILE_TYPE_TITLE)
+    fields &= ~(MELO_TAGS_FIELDS_DATE | MELO_TAGS_FIELDS_TRACK |
+                MELO_TAGS_FIELDS_TRACKS | MELO_TAGS_FIELDS_DURATION |
+                MELO_TAGS_FIELDS_BITRATE | MELO_TAGS_FIELDS_SAMPLERATE |
+                MELO_TAGS_FIELDS_CHANNELS);
+
+  /* Write tags in same order than melo_tags_to_json_object() */
+  melo_json_writer_begin_object (w);
+  if (fields == MELO_TAGS_FIELDS_NONE) {
+    melo_json_writer_end_object (w);
+    return;
+  }
+  melo_json_writer_member (w, "timestamp");
+  melo_json_writer_int (w, lwriter->timestamp);
+  if (fields & MELO_TAGS_FIELDS_TITLE) {
+    melo_json_writer_member (w, "title");
+    melo_json_writer_string (w, row->title);
+  }
+  if (fields & MELO_TAGS_FIELDS_ARTIST) {
+    melo_json_writer_member (w, "artist");
+    melo_json_writer_string (w, row->artist);
+  }
+  if (fields & MELO_TAGS_FIELDS_ALBUM) {
+    melo_json_writer_member (w, "album");
+    melo_json_writer_string (w, row->album);
+  }
+  if (fields & MELO_TAGS_FIELDS_GENRE) {
+    melo_json_writer_member (w, "genre");
+    melo_json_writer_string (w, row->genre);
+  }
+  if (fields & MELO_TAGS_FIELDS_DATE) {
+    melo_json_writer_member (w, "date");
+    melo_json_writer_int (w, row->date);
+  }
+  if (fields & MELO_TAGS_FIELDS_TRACK) {
+    melo_json_writer_member (w, "track");
+    melo_json_writer_int (w, row->track);
+  }
+  if (fields & MELO_TAGS_FIELDS_TRACKS) {
+    melo_json_writer_member (w, "tracks");
+    melo_json_writer_int (w, row->tracks);
+  }
+  if (fields & MELO_TAGS_FIELDS_DURATION) {
+    melo_json_writer_member (w, "duration");
+    melo_json_writer_int (w, row->duration);
+  }
+  if (fields & MELO_TAGS_FIELDS_BITRATE) {
+    melo_json_writer_member (w, "bitrate");
+    melo_json_writer_int (w, row->bitrate);
+  }
+  if (fields & MELO_TAGS_FIELDS_SAMPLERATE) {
+    melo_json_writer_member (w, "samplerate");
+    melo_json_writer_int (w, row->samplerate);
+  }
+  if (fields & MELO_TAGS_FIELDS_CHANNELS) {
+    melo_json_writer_member (w, "channels");
+    melo_json_writer_int (w, row->channels);
+  }
+
+  /* No cover available */
+  if (!row->cover) {
+    melo_json_writer_end_object (w);
+    return;
+  }
+
+  /* Generate cover URL */
+  g_string_truncate (lwriter->url, 0);
+  if (fields & MELO_TAGS_FIELDS_COVER_URL &&
+      !melo_tags_append_cover_url (lwriter->url, lwriter->obj, row->cover))
+    fields &= ~MELO_TAGS_FIELDS_COVER_URL;
+
+  /* Add cover data when exclusive cover is not set */
+  if (fields & MELO_TAGS_FIELDS_COVER &&
+      (!(fields & MELO_TAGS_FIELDS_COVER_EX) ||
+       !(fields & MELO_TAGS_FIELDS_COVER_URL))) {
+    GMappedFile *file;
+    gchar *path;
+
+    /* Map cover file */
+    path = g_strdup_printf ("%s/%s", melo_file_db_get_cover_path (lwriter->fdb),
+                            row->cover);
+    file = g_mapped_file_new (path, FALSE, NULL);
+    g_free (path);
+
+    /* Write cover: raw data is encoded by writer, when needed */
+    if (file) {
+      melo_json_writer_member (w, "cover");
+      melo_json_writer_binary (w, (const guchar *)
+                                  g_mapped_file_get_contents (file),
+                               g_mapped_file_get_length (file));
+      g_mapped_file_unref (file);
+      melo_json_writer_member (w, "cover_type");
+      melo_json_writer_null (w);
+      cover_type = TRUE;
+    }
+  }
+
+  /* Add cover URL: cover type is never known from database */
+  if (fields & MELO_TAGS_FIELDS_COVER_URL) {
+    melo_json_writer_member (w, "cover_url");
+    melo_json_writer_string (w, lwriter->url->str);
+    if (!cover_type) {
+      melo_json_writer_member (w, "cover_type");
+      melo_json_writer_null (w);
+    }
+  }
+  melo_json_writer_end_object (w);
+}
+
+static gboolean
+melo_library_file_write_row (const gchar *path, const gchar *file, gint id,
+                             const MeloFileDBRow *row, gpointer user_data)
+{
+  MeloLibraryFileWriter *lwriter = (MeloLibraryFileWriter *) user_data;
+  const gchar *type = "category", *add = NULL;
+  const gchar *full_name;
+  MeloJSONWriter *w;
+  gchar name[16];
+
+  /* Select full name */
+  switch (lwriter->type) {
+    case MELO_LIBRARY_FILE_TYPE_TITLE:
+      full_name = row->title ? row->title : file;
+      type = "media";
+      add = "Add to playlist";
+      break;
+    case MELO_LIBRARY_FILE_TYPE_ARTIST:
+      full_name = row->artist;
+      break;
+    case MELO_LIBRARY_FILE_TYPE_ALBUM:
+      full_name = row->album;
+      break;
+    case MELO_LIBRARY_FILE_TYPE_GENRE:
+      full_name = row->genre;
+      break;
+    default:
+      return FALSE;
+  }
+
+  /* Write item */
+  g_snprintf (name, sizeof (name), "%u", id);
+  w = melo_browser_list_writer_add_item (lwriter->writer, name, full_name,
+                                         type, add, NULL);
+  if (w)
+    melo_library_file_write_tags (lwriter, w, row);
+
+  /* Add aggregates of artist, album or genre */
+  if (lwriter->type != MELO_LIBRARY_FILE_TYPE_TITLE) {
+    w = melo_browser_list_writer_add_member (lwriter->writer, "count");
+    melo_json_writer_int (w, row->song_count);
+    w = melo_browser_list_writer_add_member (lwriter->writer, "date");
+    melo_json_writer_int (w, row->song_date);
+    w = melo_browser_list_writer_add_member (lwriter->writer, "duration");
+    melo_json_writer_int (w, row->song_duration);
+  }
+  melo_browser_list_writer_end_item (lwriter->writer);
+
+  return TRUE;
+}
+
+static gboolean
+melo_library_file_write_list (MeloBrowser *browser, const gchar *path,
+                              gint offset, gint count, const gchar *token,
+                              MeloBrowserTagsMode tags_mode,
+                              MeloTagsFields tags_fields,
+                              MeloBrowserList *list,
+                              MeloBrowserListWriter *writer)
+{
+  MeloLibraryFile *lfile = MELO_LIBRARY_FILE (browser);
+  MeloLibraryFilePrivate *priv = lfile->priv;
+  MeloLibraryFileWriter lwriter;
+  MeloTagsFields db_fields;
+  MeloFileDBFields filter;
+  MeloLibraryFileType type;
+  gint id;
+
+  /* Root path is a static list */
+  if (!path || *path != '/' || path[1] == '\0')
+    return FALSE;
+
+  /* Parse path */
+  if (!melo_library_file_parse (path + 1, &type, &filter, &id, NULL))
+    return FALSE;
+
+  /* Prepare writer context: a single timestamp is used for whole list */
+  lwriter.obj = G_OBJECT (lfile);
+  lwriter.fdb = priv->fdb;
+  lwriter.writer = writer;
+  lwriter.type = id >= 0 ? MELO_LIBRARY_FILE_TYPE_TITLE : type;
+  lwriter.tags_fields = tags_fields;
+  lwriter.timestamp = g_get_monotonic_time ();
+  lwriter.url = g_string_new (NULL);
+
+  /* Cover data is read from its file name in row */
+  db_fields = tags_fields;
+  if (tags_fields & MELO_TAGS_FIELDS_COVER)
+    db_fields |= MELO_TAGS_FIELDS_COVER_URL;
+
+  /* Write list */
+  switch (lwriter.type) {
+    case MELO_LIBRARY_FILE_TYPE_TITLE:
+      /* Songs of an artist, an album or a genre */
+      if (type == MELO_LIBRARY_FILE_TYPE_TITLE)
+        id = 0;
+      list->count = melo_file_db_get_count (priv->fdb, filter, id);
+      if (type == MELO_LIBRARY_FILE_TYPE_TITLE)
+        melo_file_db_get_song_rows (priv->fdb, lwriter.obj,
+                                    melo_library_file_write_row, &lwriter,
+                                    offset, count, token, &list->prev_token,
+                                    &list->next_token, MELO_FILE_DB_SORT_TITLE,
+                                    db_fields, MELO_FILE_DB_FIELDS_END);
+      else
+        melo_file_db_get_song_rows (priv->fdb, lwriter.obj,
+                                    melo_library_file_write_row, &lwriter,
+                                    offset, count, token, &list->prev_token,
+                                    &list->next_token, MELO_FILE_DB_SORT_TITLE,
+                                    db_fields, filter, id,
+                                    MELO_FILE_DB_FIELDS_END);
+      break;
+    case MELO_LIBRARY_FILE_TYPE_ARTIST:
+      list->count = melo_file_db_get_count (priv->fdb,
+                                            MELO_FILE_DB_FIELDS_ARTIST, 0);
+      melo_file_db_get_artist_rows (priv->fdb, lwriter.obj,
+                                    melo_library_file_write_row, &lwriter,
+                                    offset, count, token, &list->prev_token,
+                                    &list->next_token,
+                                    MELO_FILE_DB_SORT_ARTIST,
+                                    db_fields | MELO_TAGS_FIELDS_ARTIST,
+                                    MELO_FILE_DB_FIELDS_END);
+      break;
+    case MELO_LIBRARY_FILE_TYPE_ALBUM:
+      list->count = melo_file_db_get_count (priv->fdb,
+                                            MELO_FILE_DB_FIELDS_ALBUM, 0);
+      melo_file_db_get_album_rows (priv->fdb, lwriter.obj,
+                                   melo_library_file_write_row, &lwriter,
+                                   offset, count, token, &list->prev_token,
+                                   &list->next_token, MELO_FILE_DB_SORT_ALBUM,
+                                   db_fields | MELO_TAGS_FIELDS_ALBUM,
+                                   MELO_FILE_DB_FIELDS_END);
+      break;
+    case MELO_LIBRARY_FILE_TYPE_GENRE:
+      list->count = melo_file_db_get_count (priv->fdb,
+                                            MELO_FILE_DB_FIELDS_GENRE, 0);
+      melo_file_db_get_genre_rows (priv->fdb, lwriter.obj,
+                                   melo_library_file_write_row, &lwriter,
+                                   offset, count, token, &list->prev_token,
+                                   &list->next_token, MELO_FILE_DB_SORT_GENRE,
+                                   db_fields | MELO_TAGS_FIELDS_GENRE,
+                                   MELO_FILE_DB_FIELDS_END);
+      break;
+    default:
+      break;
+  }
+  g_string_free (lwriter.url, TRUE);
+
+  return TRUE;
+}
+
+static MeloBrowserList *
+melo_library_file_search (MeloBrowser *browser, const gchar *input,
+                          gint offset, gint count, const gchar *token,
+                          MeloBrowserTagsMode tags_mode,
+                          MeloTagsFields tags_fields)
+{
+  MeloLibraryFile *lfile = MELO_LIBRARY_FILE (browser);
+  MeloBrowserList *list;
+
+  /* Create browser list: items are songs */
+  list = melo_browser_list_new ("/title/");
+  if (!list)
+    return NULL;
+
+  /* Nothing to search */
+  if (!input || *input == '\0')
+    return list;
+
+  /* Get best matching songs */
+  melo_file_db_get_song_list (lfile->priv->fdb, G_OBJECT (browser),
+                              melo_library_file_gen_title, &list->items,
+                              offset, count, NULL, NULL, NULL,
+                              MELO_FILE_DB_SORT_RANK, tags_fields,
+                              MELO_FILE_DB_FIELDS_SEARCH, input,
+                              MELO_FILE_DB_FIELDS_END);
+  list->items = g_list_reverse (list->items);
+
+  return list;
+}
+
+static gboolean
+melo_library_file_hint_cb (const gchar *path, const gchar *file, gint id,
+                           MeloTags *tags, gpointer user_data)
+{
+  MeloTags **hint_tags = (MeloTags **) user_data;
+
+  /* Keep tags of best match */
+  *hint_tags = tags;
+
+  return TRUE;
+}
+
+static gboolean
+melo_library_file_hint_match (const gchar *value, const gchar *prefix)
+{
+  gchar *fvalue;
+  gboolean ret;
+
+  if (!value)
+    return FALSE;
+
+  /* Compare case insensitive */
+  fvalue = g_utf8_casefold (value, -1);
+  ret = g_str_has_prefix (fvalue, prefix);
+  g_free (fvalue);
+
+  return ret;
+}
+
+static gchar *
+melo_library_file_search_hint (MeloBrowser *browser, const gchar *input)
+{
+  MeloLibraryFile *lfile = MELO_LIBRARY_FILE (browser);
+  MeloTags *tags = NULL;
+  gchar *hint = NULL;
+  gchar *prefix;
+
+  /* Nothing to search */
+  if (!input || *input == '\0')
+    return NULL;
+
+  /* Get best matching song */
+  melo_file_db_get_song_list (lfile->priv->fdb, G_OBJECT (browser),
+                              melo_library_file_hint_cb, &tags, 0, 1, NULL,
+                              NULL, NULL, MELO_FILE_DB_SORT_RANK,
+                              MELO_TAGS_FIELDS_TITLE | MELO_TAGS_FIELDS_ARTIST |
+                              MELO_TAGS_FIELDS_ALBUM,
+                              MELO_FILE_DB_FIELDS_SEARCH, input,
+                              MELO_FILE_DB_FIELDS_END);
+  if (!tags)
+    return NULL;
+
+  /* Complete input with artist, album or title of best match */
+  prefix = g_utf8_casefold (input, -1);
+  if (melo_library_file_hint_match (tags->artist, prefix))
+    hint = g_strdup (tags->artist);
+  else if (melo_library_file_hint_match (tags->album, prefix))
+    hint = g_strdup (tags->album);
+  else if (tags->title)
+    hint = g_strdup (tags->title);
+  melo_tags_unref (tags);
+  g_free (prefix);
+
+  return hint;
+}
+
 static MeloTags *
 melo_library_file_get_tags (MeloBrowser *browser, const gchar *path,
                             MeloTagsFields fields)
@@ -504,15 +929,16 @@ melo_library_file_add (MeloBrowser *browser, const gchar *path)
   if (id2 == -1)
     return melo_file_db_get_file_list (lfile->priv->fdb, G_OBJECT (browser),
                                        melo_library_file_add_cb,
-                                       browser->player, 0, -1,
-                                       MELO_FILE_DB_SORT_TITLE,
+                                       browser->player, 0, -1, NULL, NULL,
+                                       NULL, MELO_FILE_DB_SORT_TITLE,
                                        MELO_TAGS_FIELDS_FULL, filter, id,
                                        MELO_FILE_DB_FIELDS_END);
 
   /* Add media to playlist */
   return melo_file_db_get_file_list (lfile->priv->fdb, G_OBJECT (browser),
                                      melo_library_file_add_cb, browser->player,
-                                     0, 1, MELO_FILE_DB_SORT_NONE,
+                                     0, 1, NULL, NULL, NULL,
+                                     MELO_FILE_DB_SORT_NONE,
                                      MELO_TAGS_FIELDS_FULL,
                                      MELO_FILE_DB_FIELDS_FILE_ID, id2,
                                      MELO_FILE_DB_FIELDS_END);
@@ -557,15 +983,16 @@ melo_library_file_play (MeloBrowser *browser, const gchar *path)
     /* Play first media */
     melo_file_db_get_file_list (lfile->priv->fdb, G_OBJECT (browser),
                                 melo_library_file_play_cb, browser->player,
-                                0, 1, MELO_FILE_DB_SORT_TITLE,
+                                0, 1, NULL, NULL, NULL,
+                                MELO_FILE_DB_SORT_TITLE,
                                 MELO_TAGS_FIELDS_FULL, filter, id,
                                 MELO_FILE_DB_FIELDS_END);
 
     /* Add other to playlist */
     return melo_file_db_get_file_list (lfile->priv->fdb, G_OBJECT (browser),
                                        melo_library_file_add_cb,
-                                       browser->player, 1, -1,
-                                       MELO_FILE_DB_SORT_TITLE,
+                                       browser->player, 1, -1, NULL, NULL,
+                                       NULL, MELO_FILE_DB_SORT_TITLE,
                                        MELO_TAGS_FIELDS_FULL, filter, id,
                                        MELO_FILE_DB_FIELDS_END);
   }
@@ -574,7 +1001,8 @@ melo_library_file_play (MeloBrowser *browser, const gchar *path)
   /* Play media */
   return melo_file_db_get_file_list (lfile->priv->fdb, G_OBJECT (browser),
                                      melo_library_file_play_cb, browser->player,
-                                     0, 1, MELO_FILE_DB_SORT_NONE,
+                                     0, 1, NULL, NULL, NULL,
+                                     MELO_FILE_DB_SORT_NONE,
                                      MELO_TAGS_FIELDS_FULL,
                                      MELO_FILE_DB_FIELDS_FILE_ID, id2,
                                      MELO_FILE_DB_FIELDS_END);
@@ -0,0 +1,954 @@
+/*
+ * melo_scanner_file.c: Background media library scanner for File module
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <gio/gio.h>
+
+#include "melo_tags_file.h"
+#include "melo_discoverer_file.h"
+#include "melo_scanner_file.h"
+
+/* Maximum files waiting for a discoverer */
+#define MELO_SCANNER_FILE_QUEUE_SIZE 256
+
+/* Discoverer timeout per file */
+#define MELO_SCANNER_FILE_TIMEOUT (5 * GST_SECOND)
+
+/* Changes are applied when no event is received during CHANGES_DELAY (in ms),
+ * or at least every CHANGES_MAX_DELAY (in ms) during a long burst.
+ */
+#define MELO_SCANNER_FILE_CHANGES_DELAY 2000
+#define MELO_SCANNER_FILE_CHANGES_MAX_DELAY 30000
+
+/* Attributes needed to walk directories */
+#define MELO_SCANNER_FILE_ATTRIBUTES \
+  G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+  G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+  G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+  G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+static const gchar *melo_scanner_file_state_str[] = {
+  [MELO_SCANNER_FILE_STATE_IDLE] = "idle",
+  [MELO_SCANNER_FILE_STATE_RUNNING] = "running",
+  [MELO_SCANNER_FILE_STATE_PAUSED] = "paused",
+};
+
+/* Change reported by a directory monitor */
+typedef enum {
+  MELO_SCANNER_FILE_CHANGE_UPDATED = 1,
+  MELO_SCANNER_FILE_CHANGE_DELETED,
+} MeloScannerFileChange;
+
+/* File to discover */
+typedef struct {
+  gchar *uri;
+  gchar *filename;
+  gchar *file;
+  gint path_id;
+  gint timestamp;
+} MeloScannerFileTask;
+
+struct _MeloScannerFilePrivate {
+  MeloFileDB *fdb;
+  guint workers;
+
+  /* Scan thread and discoverer workers */
+  GThread *thread;
+  GThreadPool *pool;
+  MeloDiscovererFile *discoverers;
+
+  /* Scan job: a full scan from root and / or a list of changes */
+  GFile *root;
+  GHashTable *updates;
+
+  /* Scan state and progress (protected by mutex) */
+  GMutex mutex;
+  GCond cond;
+  gboolean running;
+  gboolean paused;
+  gboolean stop;
+  gchar *path;
+  guint dirs;
+  guint files;
+  guint scanned;
+  guint skipped;
+  guint failed;
+
+  /* Directories to watch, added by scan thread (protected by mutex) */
+  GQueue watch_dirs;
+  guint watch_id;
+
+  /* Directory monitors and pending changes (main thread only) */
+  GHashTable *monitors;
+  GHashTable *changes;
+  guint changes_id;
+  gint64 changes_first;
+  gint64 changes_last;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (MeloScannerFile, melo_scanner_file, G_TYPE_OBJECT)
+
+static void melo_scanner_file_changed (GFileMonitor *monitor, GFile *file,
+                                       GFile *other_file,
+                                       GFileMonitorEvent event_type,
+                                       gpointer user_data);
+
+static void
+melo_scanner_file_finalize (GObject *gobject)
+{
+  MeloScannerFile *scanner = MELO_SCANNER_FILE (gobject);
+  MeloScannerFilePrivate *priv =
+                               melo_scanner_file_get_instance_private (scanner);
+
+  /* Stop scan */
+  melo_scanner_file_stop (scanner);
+
+  /* Remove pending sources */
+  if (priv->watch_id)
+    g_source_remove (priv->watch_id);
+  if (priv->changes_id)
+    g_source_remove (priv->changes_id);
+  g_queue_foreach (&priv->watch_dirs, (GFunc) g_object_unref, NULL);
+  g_queue_clear (&priv->watch_dirs);
+
+  /* Free monitors and pending changes */
+  g_hash_table_unref (priv->monitors);
+  g_hash_table_unref (priv->changes);
+
+  /* Free discoverers */
+  if (priv->discoverers)
+    g_object_unref (priv->discoverers);
+
+  /* Release database */
+  if (priv->fdb)
+    g_object_unref (priv->fdb);
+  g_free (priv->path);
+
+  /* Clear mutex and condition */
+  g_cond_clear (&priv->cond);
+  g_mutex_clear (&priv->mutex);
+
+  /* Chain up to the parent class */
+  G_OBJECT_CLASS (melo_scanner_file_parent_class)->finalize (gobject);
+}
+
+static void
+melo_scanner_file_class_init (MeloScannerFileClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  /* Add custom finalize() function */
+  object_class->finalize = melo_scanner_file_finalize;
+}
+
+static void
+melo_scanner_file_monitor_free (gpointer data)
+{
+  GFileMonitor *monitor = G_FILE_MONITOR (data);
+
+  /* Stop events before release */
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static void
+melo_scanner_file_init (MeloScannerFile *self)
+{
+  MeloScannerFilePrivate *priv = melo_scanner_file_get_instance_private (self);
+
+  self->priv = priv;
+
+  /* Init mutex and condition */
+  g_mutex_init (&priv->mutex);
+  g_cond_init (&priv->cond);
+
+  /* Create monitors and pending changes lists */
+  priv->monitors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          melo_scanner_file_monitor_free);
+  priv->changes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         NULL);
+}
+
+MeloScannerFile *
+melo_scanner_file_new (MeloFileDB *fdb, guint workers)
+{
+  MeloScannerFile *scanner;
+
+  /* Create a new object */
+  scanner = g_object_new (MELO_TYPE_SCANNER_FILE, NULL);
+  if (!scanner)
+    return NULL;
+
+  /* Use one worker per core by default */
+  scanner->priv->fdb = g_object_ref (fdb);
+  scanner->priv->workers = workers ? workers : g_get_num_processors ();
+
+  /* Create discoverers pool: one discoverer per worker */
+  scanner->priv->discoverers =
+                          melo_discoverer_file_new (scanner->priv->workers);
+
+  return scanner;
+}
+
+static gchar *
+melo_scanner_file_get_path (GFile *file)
+{
+  gchar *uri, *path;
+
+  /* Paths are saved in database as unescaped URIs (as in file browser) */
+  uri = g_file_get_uri (file);
+  path = g_uri_unescape_string (uri, NULL);
+  g_free (uri);
+
+  return path;
+}
+
+static gint
+melo_scanner_file_get_timestamp (GFileInfo *info)
+{
+  return g_file_info_get_attribute_uint64 (info,
+                                           G_FILE_ATTRIBUTE_TIME_MODIFIED);
+}
+
+static MeloScannerFileTask *
+melo_scanner_file_task_new (GFile *dir, GFileInfo *info, gint path_id)
+{
+  MeloScannerFileTask *task;
+  const gchar *name;
+  GFile *file;
+
+  /* Create a new task */
+  name = g_file_info_get_name (info);
+  file = g_file_get_child (dir, name);
+  task = g_slice_new (MeloScannerFileTask);
+  task->uri = g_file_get_uri (file);
+  task->filename = g_file_get_path (file);
+  task->file = g_strdup (name);
+  task->path_id = path_id;
+  task->timestamp = melo_scanner_file_get_timestamp (info);
+  g_object_unref (file);
+
+  return task;
+}
+
+static void
+melo_scanner_file_task_free (MeloScannerFileTask *task)
+{
+  g_free (task->uri);
+  g_free (task->filename);
+  g_free (task->file);
+  g_slice_free (MeloScannerFileTask, task);
+}
+
+static gboolean
+melo_scanner_file_wait (MeloScannerFilePrivate *priv)
+{
+  gboolean run;
+
+  /* Wait until scan is resumed or stopped */
+  g_mutex_lock (&priv->mutex);
+  while (priv->paused && !priv->stop)
+    g_cond_wait (&priv->cond, &priv->mutex);
+  run = !priv->stop;
+  g_mutex_unlock (&priv->mutex);
+
+  return run;
+}
+
+static void
+melo_scanner_file_discover (gpointer data, gpointer user_data)
+{
+  MeloScannerFilePrivate *priv = (MeloScannerFilePrivate *) user_data;
+  MeloScannerFileTask *task = (MeloScannerFileTask *) data;
+  GstDiscovererInfo *info;
+  MeloTags *tags = NULL;
+  gboolean run;
+
+  /* Scan has been stopped */
+  run = melo_scanner_file_wait (priv);
+  if (!run)
+    goto end;
+
+  /* Read tags directly from file when format is supported */
+  tags = melo_tags_file_read (task->filename, MELO_TAGS_FIELDS_FULL);
+  if (tags)
+    goto add;
+
+  /* Get tags from URI */
+  info = melo_discoverer_file_discover (priv->discoverers, task->uri,
+                                        MELO_SCANNER_FILE_TIMEOUT, NULL);
+  if (info) {
+    /* Convert tags and stream details to MeloTags */
+    tags = melo_tags_new_from_gst_discoverer_info (info,
+                                                   MELO_TAGS_FIELDS_FULL);
+    g_object_unref (info);
+  }
+
+add:
+  /* Add file to database: a file without tags is added with an empty set of
+   * tags, so it is skipped by next scans until it is modified
+   */
+  melo_file_db_add_tags2 (priv->fdb, task->path_id, task->file,
+                          task->timestamp, tags, NULL);
+
+end:
+  /* Update progress and wake up scan thread */
+  g_mutex_lock (&priv->mutex);
+  if (tags)
+    priv->scanned++;
+  else if (run)
+    priv->failed++;
+  g_cond_broadcast (&priv->cond);
+  g_mutex_unlock (&priv->mutex);
+  if (tags)
+    melo_tags_unref (tags);
+
+  melo_scanner_file_task_free (task);
+}
+
+static void
+melo_scanner_file_push (MeloScannerFilePrivate *priv,
+                        MeloScannerFileTask *task)
+{
+  /* Limit pending files */
+  g_mutex_lock (&priv->mutex);
+  priv->files++;
+  while (!priv->stop &&
+         g_thread_pool_unprocessed (priv->pool) >= MELO_SCANNER_FILE_QUEUE_SIZE)
+    g_cond_wait (&priv->cond, &priv->mutex);
+  g_mutex_unlock (&priv->mutex);
+
+  /* Push file to discoverer workers */
+  g_thread_pool_push (priv->pool, task, NULL);
+}
+
+static gboolean
+melo_scanner_file_skip (MeloScannerFilePrivate *priv, gint path_id,
+                        GFileInfo *info)
+{
+  gint ts;
+
+  /* File is not in database or has been modified */
+  if (!melo_file_db_get_song_timestamp (priv->fdb, path_id,
+                                        g_file_info_get_name (info), &ts) ||
+      ts != melo_scanner_file_get_timestamp (info))
+    return FALSE;
+
+  /* Update progress */
+  g_mutex_lock (&priv->mutex);
+  priv->files++;
+  priv->skipped++;
+  g_mutex_unlock (&priv->mutex);
+
+  return TRUE;
+}
+
+static gboolean
+melo_scanner_file_is_dir (GFileInfo *info)
+{
+  return !g_file_info_get_is_hidden (info) &&
+         g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY;
+}
+
+static gboolean
+melo_scanner_file_is_media (GFileInfo *info)
+{
+  const gchar *type;
+
+  /* Skip hidden and other files than regular */
+  if (g_file_info_get_is_hidden (info) ||
+      g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR)
+    return FALSE;
+
+  /* Accept audio / video files and unknown types */
+  type = g_file_info_get_attribute_string (info,
+                                   G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE);
+  if (!type)
+    return TRUE;
+  return g_str_has_prefix (type, "audio/") ||
+         g_str_has_prefix (type, "video/") ||
+         g_str_has_suffix (type, "/ogg") ||
+         !g_strcmp0 (type, "application/octet-stream");
+}
+
+static gboolean
+melo_scanner_file_watch_dirs (gpointer user_data)
+{
+  MeloScannerFile *scanner = MELO_SCANNER_FILE (user_data);
+  MeloScannerFilePrivate *priv = scanner->priv;
+  GQueue dirs;
+  GFile *dir;
+
+  /* Get directories to watch */
+  g_mutex_lock (&priv->mutex);
+  dirs = priv->watch_dirs;
+  g_queue_init (&priv->watch_dirs);
+  priv->watch_id = 0;
+  g_mutex_unlock (&priv->mutex);
+
+  /* Add a monitor on each new directory */
+  while ((dir = g_queue_pop_head (&dirs))) {
+    GFileMonitor *monitor = NULL;
+    gchar *path;
+
+    /* Create monitor if directory is not yet watched */
+    path = melo_scanner_file_get_path (dir);
+    if (!g_hash_table_contains (priv->monitors, path))
+      monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE, NULL,
+                                          NULL);
+    if (monitor) {
+      g_signal_connect (monitor, "changed",
+                        G_CALLBACK (melo_scanner_file_changed), scanner);
+      g_hash_table_insert (priv->monitors, path, monitor);
+    } else
+      g_free (path);
+    g_object_unref (dir);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+melo_scanner_file_remove (MeloScannerFilePrivate *priv, GFile *file)
+{
+  GFile *parent;
+  gchar *path, *name;
+  gint path_id;
+
+  /* Remove as a directory */
+  path = melo_scanner_file_get_path (file);
+  melo_file_db_remove_path (priv->fdb, path);
+  g_free (path);
+
+  /* Remove as a song */
+  parent = g_file_get_parent (file);
+  if (!parent)
+    return;
+  path = melo_scanner_file_get_path (parent);
+  name = g_file_get_basename (file);
+  if (melo_file_db_get_path_id (priv->fdb, path, FALSE, &path_id))
+    melo_file_db_remove_song (priv->fdb, path_id, name);
+  g_object_unref (parent);
+  g_free (path);
+  g_free (name);
+}
+
+static gboolean
+melo_scanner_file_scan_dir (MeloScannerFile *scanner, GFile *dir,
+                            GQueue *dirs, GHashTable *visited)
+{
+  MeloScannerFilePrivate *priv = scanner->priv;
+  GFileEnumerator *dir_enum;
+  GList *tasks = NULL;
+  GList *files, *l;
+  GHashTable *names;
+  GError *err = NULL;
+  GFileInfo *info;
+  gboolean found;
+  gchar *path;
+  gint path_id = 0;
+
+  /* Get path from directory: same format than file browser */
+  path = melo_scanner_file_get_path (dir);
+  if (visited)
+    g_hash_table_add (visited, g_strdup (path));
+
+  /* Watch directory for changes */
+  g_mutex_lock (&priv->mutex);
+  g_queue_push_tail (&priv->watch_dirs, g_object_ref (dir));
+  if (!priv->watch_id)
+    priv->watch_id = g_idle_add (melo_scanner_file_watch_dirs, scanner);
+  g_mutex_unlock (&priv->mutex);
+
+  /* Get list of directory */
+  dir_enum = g_file_enumerate_children (dir, MELO_SCANNER_FILE_ATTRIBUTES, 0,
+                                        NULL, NULL);
+  if (!dir_enum) {
+    g_free (path);
+    return FALSE;
+  }
+
+  /* Get path ID if directory is already known */
+  found = melo_file_db_get_path_id (priv->fdb, path, FALSE, &path_id);
+  names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* Parse directory */
+  while ((info = g_file_enumerator_next_file (dir_enum, NULL, &err))) {
+    const gchar *name = g_file_info_get_name (info);
+
+    /* Add sub-directory to scan list */
+    if (melo_scanner_file_is_dir (info)) {
+      g_queue_push_tail (dirs, g_file_get_child (dir, name));
+      g_object_unref (info);
+      continue;
+    }
+
+    /* Skip other files than media */
+    if (!melo_scanner_file_is_media (info)) {
+      g_object_unref (info);
+      continue;
+    }
+    g_hash_table_add (names, g_strdup (name));
+
+    /* Skip files already up to date in database */
+    if (found && melo_scanner_file_skip (priv, path_id, info)) {
+      g_object_unref (info);
+      continue;
+    }
+
+    /* Add file to discover */
+    tasks = g_list_prepend (tasks, melo_scanner_file_task_new (dir, info, 0));
+    g_object_unref (info);
+  }
+  g_object_unref (dir_enum);
+
+  /* Remove songs of files which disappeared: only on a complete listing */
+  if (found && !err) {
+    files = melo_file_db_get_path_files (priv->fdb, path_id);
+    for (l = files; l != NULL; l = l->next)
+      if (!g_hash_table_contains (names, l->data))
+        melo_file_db_remove_song (priv->fdb, path_id, l->data);
+    g_list_free_full (files, g_free);
+  }
+  g_hash_table_unref (names);
+
+  /* Get path ID: path can have been removed with its last song */
+  if (tasks)
+    melo_file_db_get_path_id (priv->fdb, path, TRUE, &path_id);
+  g_free (path);
+
+  /* Push files to discoverer workers */
+  tasks = g_list_reverse (tasks);
+  for (l = tasks; l != NULL; l = l->next) {
+    MeloScannerFileTask *task = (MeloScannerFileTask *) l->data;
+
+    task->path_id = path_id;
+    melo_scanner_file_push (priv, task);
+  }
+  g_list_free (tasks);
+
+  /* Listing is not complete */
+  if (err) {
+    g_error_free (err);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+melo_scanner_file_apply_changes (MeloScannerFilePrivate *priv,
+                                 GHashTable *changes, GQueue *dirs)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  /* Remove deleted files and directories first */
+  g_hash_table_iter_init (&iter, changes);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    GFile *file;
+
+    if (GPOINTER_TO_INT (value) != MELO_SCANNER_FILE_CHANGE_DELETED)
+      continue;
+
+    file = g_file_new_for_uri (key);
+    melo_scanner_file_remove (priv, file);
+    g_object_unref (file);
+  }
+
+  /* Discover new and modified files */
+  g_hash_table_iter_init (&iter, changes);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    GFile *file, *parent = NULL;
+    GFileInfo *info;
+    gchar *path;
+    gint path_id;
+
+    if (GPOINTER_TO_INT (value) != MELO_SCANNER_FILE_CHANGE_UPDATED ||
+        !melo_scanner_file_wait (priv))
+      continue;
+
+    /* File has already disappeared */
+    file = g_file_new_for_uri (key);
+    info = g_file_query_info (file, MELO_SCANNER_FILE_ATTRIBUTES, 0, NULL,
+                              NULL);
+    if (!info) {
+      melo_scanner_file_remove (priv, file);
+      g_object_unref (file);
+      continue;
+    }
+
+    /* Walk new directory */
+    if (melo_scanner_file_is_dir (info)) {
+      g_queue_push_tail (dirs, g_object_ref (file));
+      goto next;
+    }
+
+    /* Skip other files than media */
+    parent = g_file_get_parent (file);
+    if (!parent || !melo_scanner_file_is_media (info))
+      goto next;
+
+    /* Get path ID */
+    path = melo_scanner_file_get_path (parent);
+    if (!melo_file_db_get_path_id (priv->fdb, path, TRUE, &path_id)) {
+      g_free (path);
+      goto next;
+    }
+    g_free (path);
+
+    /* Push file to discoverer workers if not up to date */
+    if (!melo_scanner_file_skip (priv, path_id, info))
+      melo_scanner_file_push (priv,
+                              melo_scanner_file_task_new (parent, info,
+                                                          path_id));
+
+next:
+    if (parent)
+      g_object_unref (parent);
+    g_object_unref (info);
+    g_object_unref (file);
+  }
+}
+
+static gpointer
+melo_scanner_file_thread (gpointer user_data)
+{
+  MeloScannerFile *scanner = MELO_SCANNER_FILE (user_data);
+  MeloScannerFilePrivate *priv = scanner->priv;
+  GHashTable *visited = NULL;
+  GQueue dirs = G_QUEUE_INIT;
+  gchar *root = NULL;
+  GFile *dir;
+
+  /* Apply changes reported by monitors */
+  if (priv->updates) {
+    melo_scanner_file_apply_changes (priv, priv->updates, &dirs);
+    g_hash_table_unref (priv->updates);
+    priv->updates = NULL;
+  }
+
+  /* Start a full scan from root */
+  if (priv->root) {
+    visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    root = melo_scanner_file_get_path (priv->root);
+    g_queue_push_tail (&dirs, priv->root);
+    priv->root = NULL;
+  }
+
+  /* Walk through directories */
+  while ((dir = g_queue_pop_head (&dirs))) {
+    /* Scan directory: removed directories are only found on a full walk */
+    if (melo_scanner_file_wait (priv)) {
+      if (!melo_scanner_file_scan_dir (scanner, dir, &dirs, visited) &&
+          visited) {
+        g_hash_table_unref (visited);
+        visited = NULL;
+      }
+
+      /* Update progress */
+      g_mutex_lock (&priv->mutex);
+      priv->dirs++;
+      g_mutex_unlock (&priv->mutex);
+    }
+    g_object_unref (dir);
+  }
+
+  /* Remove directories which disappeared */
+  if (visited && melo_scanner_file_wait (priv)) {
+    GList *paths, *l;
+
+    paths = melo_file_db_get_sub_paths (priv->fdb, root);
+    for (l = paths; l != NULL; l = l->next)
+      if (!g_hash_table_contains (visited, l->data))
+        melo_file_db_remove_path (priv->fdb, l->data);
+    g_list_free_full (paths, g_free);
+  }
+  if (visited)
+    g_hash_table_unref (visited);
+  g_free (root);
+
+  /* Wait end of all pending files */
+  g_thread_pool_free (priv->pool, FALSE, TRUE);
+  priv->pool = NULL;
+
+  /* Scan is finished: commit database insertions, unless batch has already
+   * been ended by a pause
+   */
+  g_mutex_lock (&priv->mutex);
+  if (!priv->paused)
+    melo_file_db_batch_end (priv->fdb);
+  priv->running = FALSE;
+  priv->paused = FALSE;
+  g_mutex_unlock (&priv->mutex);
+
+  return NULL;
+}
+
+static gboolean
+melo_scanner_file_run (MeloScannerFile *scanner, GFile *root,
+                       GHashTable *updates)
+{
+  MeloScannerFilePrivate *priv = scanner->priv;
+  GThread *thread;
+
+  /* Lock scan state */
+  g_mutex_lock (&priv->mutex);
+
+  /* A scan is already running */
+  if (priv->running) {
+    g_mutex_unlock (&priv->mutex);
+    return FALSE;
+  }
+
+  /* Release previous scan thread: it is taken under lock, so it is joined by
+   * a single caller
+   */
+  thread = priv->thread;
+  priv->thread = NULL;
+  if (thread) {
+    g_mutex_unlock (&priv->mutex);
+    g_thread_join (thread);
+    g_mutex_lock (&priv->mutex);
+
+    /* Another scan has been started in the meantime */
+    if (priv->running) {
+      g_mutex_unlock (&priv->mutex);
+      return FALSE;
+    }
+  }
+
+  /* Create discoverer workers */
+  priv->pool = g_thread_pool_new (melo_scanner_file_discover, priv,
+                                  priv->workers, FALSE, NULL);
+  if (!priv->pool) {
+    g_mutex_unlock (&priv->mutex);
+    return FALSE;
+  }
+
+  /* Set scan job */
+  priv->root = root;
+  priv->updates = updates;
+
+  /* Reset progress */
+  priv->dirs = priv->files = 0;
+  priv->scanned = priv->skipped = priv->failed = 0;
+  priv->running = TRUE;
+  priv->paused = FALSE;
+  priv->stop = FALSE;
+
+  /* Group all database insertions of the scan: batch is ended and started
+   * again by pause and resume, under scan state lock
+   */
+  melo_file_db_batch_begin (priv->fdb);
+
+  /* Start scan thread */
+  priv->thread = g_thread_new ("melo_scanner_file", melo_scanner_file_thread,
+                               scanner);
+
+  /* Unlock scan state */
+  g_mutex_unlock (&priv->mutex);
+
+  return TRUE;
+}
+
+static gboolean
+melo_scanner_file_flush_changes (gpointer user_data)
+{
+  MeloScannerFile *scanner = MELO_SCANNER_FILE (user_data);
+  MeloScannerFilePrivate *priv = scanner->priv;
+  gint64 now = g_get_monotonic_time () / G_TIME_SPAN_MILLISECOND;
+
+  /* Wait end of events burst */
+  if (now - priv->changes_last < MELO_SCANNER_FILE_CHANGES_DELAY &&
+      now - priv->changes_first < MELO_SCANNER_FILE_CHANGES_MAX_DELAY)
+    return G_SOURCE_CONTINUE;
+
+  /* A scan is running: retry later */
+  if (!melo_scanner_file_run (scanner, NULL, priv->changes))
+    return G_SOURCE_CONTINUE;
+
+  /* Changes are now owned by scan thread */
+  priv->changes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         NULL);
+  priv->changes_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+melo_scanner_file_changed (GFileMonitor *monitor, GFile *file,
+                           GFile *other_file, GFileMonitorEvent event_type,
+                           gpointer user_data)
+{
+  MeloScannerFile *scanner = MELO_SCANNER_FILE (user_data);
+  MeloScannerFilePrivate *priv = scanner->priv;
+  MeloScannerFileChange change;
+  gchar *path;
+  gint64 now;
+
+  /* Get change: a file is discovered once its writing is done */
+  switch (event_type) {
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+      change = MELO_SCANNER_FILE_CHANGE_UPDATED;
+      break;
+    case G_FILE_MONITOR_EVENT_DELETED:
+      change = MELO_SCANNER_FILE_CHANGE_DELETED;
+
+      /* Stop watching removed directory */
+      path = melo_scanner_file_get_path (file);
+      g_hash_table_remove (priv->monitors, path);
+      g_free (path);
+      break;
+    default:
+      return;
+  }
+
+  /* Add change: last event on a file wins */
+  g_hash_table_insert (priv->changes, g_file_get_uri (file),
+                       GINT_TO_POINTER (change));
+
+  /* Apply changes after a delay to group events */
+  now = g_get_monotonic_time () / G_TIME_SPAN_MILLISECOND;
+  if (!priv->changes_id) {
+    priv->changes_id = g_timeout_add (MELO_SCANNER_FILE_CHANGES_DELAY,
+                                      melo_scanner_file_flush_changes,
+                                      scanner);
+    priv->changes_first = now;
+  }
+  priv->changes_last = now;
+}
+
+gboolean
+melo_scanner_file_start (MeloScannerFile *scanner, const gchar *path)
+{
+  MeloScannerFilePrivate *priv = scanner->priv;
+  GFile *root;
+
+  if (!path || *path == '\0')
+    return FALSE;
+
+  /* Start a full scan */
+  root = g_file_new_for_path (path);
+  if (!melo_scanner_file_run (scanner, root, NULL)) {
+    g_object_unref (root);
+    return FALSE;
+  }
+
+  /* Save scanned path */
+  g_mutex_lock (&priv->mutex);
+  g_free (priv->path);
+  priv->path = g_strdup (path);
+  g_mutex_unlock (&priv->mutex);
+
+  return TRUE;
+}
+
+void
+melo_scanner_file_stop (MeloScannerFile *scanner)
+{
+  MeloScannerFilePrivate *priv = scanner->priv;
+  GThread *thread;
+
+  /* Ask scan thread and workers to stop */
+  g_mutex_lock (&priv->mutex);
+  priv->stop = TRUE;
+  g_cond_broadcast (&priv->cond);
+  thread = priv->thread;
+  priv->thread = NULL;
+  g_mutex_unlock (&priv->mutex);
+
+  /* Wait end of scan */
+  if (thread)
+    g_thread_join (thread);
+}
+
+void
+melo_scanner_file_pause (MeloScannerFile *scanner)
+{
+  MeloScannerFilePrivate *priv = scanner->priv;
+
+  /* Pause scan: current files are finished */
+  g_mutex_lock (&priv->mutex);
+  if (priv->running && !priv->paused) {
+    priv->paused = TRUE;
+
+    /* Commit files scanned so far: no transaction is kept open while paused */
+    melo_file_db_batch_end (priv->fdb);
+  }
+  g_mutex_unlock (&priv->mutex);
+}
+
+void
+melo_scanner_file_resume (MeloScannerFile *scanner)
+{
+  MeloScannerFilePrivate *priv = scanner->priv;
+
+  /* Resume scan */
+  g_mutex_lock (&priv->mutex);
+  if (priv->paused) {
+    priv->paused = FALSE;
+    melo_file_db_batch_begin (priv->fdb);
+  }
+  g_cond_broadcast (&priv->cond);
+  g_mutex_unlock (&priv->mutex);
+}
+
+MeloScannerFileStatus *
+melo_scanner_file_get_status (MeloScannerFile *scanner)
+{
+  MeloScannerFilePrivate *priv = scanner->priv;
+  MeloScannerFileStatus *status;
+
+  /* Create status */
+  status = g_slice_new0 (MeloScannerFileStatus);
+
+  /* Copy scan state and progress */
+  g_mutex_lock (&priv->mutex);
+  if (priv->running)
+    status->state = priv->paused ? MELO_SCANNER_FILE_STATE_PAUSED :
+                                   MELO_SCANNER_FILE_STATE_RUNNING;
+  status->path = g_strdup (priv->path);
+  status->dirs = priv->dirs;
+  status->files = priv->files;
+  status->scanned = priv->scanned;
+  status->skipped = priv->skipped;
+  status->failed = priv->failed;
+  g_mutex_unlock (&priv->mutex);
+
+  return status;
+}
+
+void
+melo_scanner_file_status_free (MeloScannerFileStatus *status)
+{
+  g_free (status->path);
+  g_slice_free (MeloScannerFileStatus, status);
+}
+
+const gchar *
+melo_scanner_file_state_to_string (MeloScannerFileState state)
+{
+  if (state >= MELO_SCANNER_FILE_STATE_COUNT)
+    return NULL;
+  return melo_scanner_file_state_str[state];
+}
@@ -0,0 +1,90 @@
+/*
+ * melo_scanner_file.h: Background media library scanner for File module
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __MELO_SCANNER_FILE_H__
+#define __MELO_SCANNER_FILE_H__
+
+#include <glib-object.h>
+
+#include "melo_file_db.h"
+
+G_BEGIN_DECLS
+
+#define MELO_TYPE_SCANNER_FILE             (melo_scanner_file_get_type ())
+#define MELO_SCANNER_FILE(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), MELO_TYPE_SCANNER_FILE, MeloScannerFile))
+#define MELO_IS_SCANNER_FILE(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MELO_TYPE_SCANNER_FILE))
+#define MELO_SCANNER_FILE_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), MELO_TYPE_SCANNER_FILE, MeloScannerFileClass))
+#define MELO_IS_SCANNER_FILE_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), MELO_TYPE_SCANNER_FILE))
+#define MELO_SCANNER_FILE_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), MELO_TYPE_SCANNER_FILE, MeloScannerFileClass))
+
+typedef struct _MeloScannerFile MeloScannerFile;
+typedef struct _MeloScannerFileClass MeloScannerFileClass;
+typedef struct _MeloScannerFilePrivate MeloScannerFilePrivate;
+
+typedef struct _MeloScannerFileStatus MeloScannerFileStatus;
+
+struct _MeloScannerFile {
+  GObject parent_instance;
+
+  /*< private >*/
+  MeloScannerFilePrivate *priv;
+};
+
+struct _MeloScannerFileClass {
+  GObjectClass parent_class;
+};
+
+typedef enum {
+  MELO_SCANNER_FILE_STATE_IDLE = 0,
+  MELO_SCANNER_FILE_STATE_RUNNING,
+  MELO_SCANNER_FILE_STATE_PAUSED,
+
+  MELO_SCANNER_FILE_STATE_COUNT
+} MeloScannerFileState;
+
+struct _MeloScannerFileStatus {
+  MeloScannerFileState state;
+  gchar *path;
+  /* Progress */
+  guint dirs;
+  guint files;
+  guint scanned;
+  guint skipped;
+  guint failed;
+};
+
+GType melo_scanner_file_get_type (void);
+
+MeloScannerFile *melo_scanner_file_new (MeloFileDB *fdb, guint workers);
+
+gboolean melo_scanner_file_start (MeloScannerFile *scanner, const gchar *path);
+void melo_scanner_file_stop (MeloScannerFile *scanner);
+void melo_scanner_file_pause (MeloScannerFile *scanner);
+void melo_scanner_file_resume (MeloScannerFile *scanner);
+
+MeloScannerFileStatus *melo_scanner_file_get_status (MeloScannerFile *scanner);
+void melo_scanner_file_status_free (MeloScannerFileStatus *status);
+
+const gchar *melo_scanner_file_state_to_string (MeloScannerFileState state);
+
+G_END_DECLS
+
+#endif /* __MELO_SCANNER_FILE_H__ */
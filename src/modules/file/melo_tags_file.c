@@ -0,0 +1,1145 @@
+/*
+ * melo_tags_file.c: Fast tags reader for local media files
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <gst/tag/tag.h>
+
+#include "melo_tags_file.h"
+
+/* Maximum size of a metadata block loaded in memory (with embedded cover) */
+#define MELO_TAGS_FILE_MAX_SIZE (16 * 1024 * 1024)
+
+/* Bytes searched for first MPEG frame and for last Ogg page */
+#define MELO_TAGS_FILE_MPEG_SEARCH 4096
+#define MELO_TAGS_FILE_OGG_SEARCH 65536
+
+/* Picture type of a front cover (ID3v2, FLAC and Vorbis comments) */
+#define MELO_TAGS_FILE_FRONT_COVER 3
+
+/* ID3v2 syncsafe integer */
+#define MELO_TAGS_FILE_SYNCSAFE(p) \
+  ((((guint32) (p)[0] & 0x7f) << 21) | (((guint32) (p)[1] & 0x7f) << 14) | \
+   (((guint32) (p)[2] & 0x7f) << 7) | ((guint32) (p)[3] & 0x7f))
+
+typedef struct {
+  gint fd;
+  guint64 size;
+  MeloTags *tags;
+  MeloTagsFields fields;
+  gint cover_type;
+  guint id3_frames;
+  /* Stream details */
+  GstClockTime duration;
+  guint64 audio_size;
+  guint32 bitrate;
+  guint32 samplerate;
+  guint channels;
+} MeloTagsFileReader;
+
+/* ID3v2.2 frame IDs to ID3v2.3 */
+static const gchar *melo_tags_file_id3v22_ids[][2] = {
+  { "TT2", "TIT2" },
+  { "TP1", "TPE1" },
+  { "TAL", "TALB" },
+  { "TCO", "TCON" },
+  { "TYE", "TYER" },
+  { "TRK", "TRCK" },
+  { "PIC", "APIC" },
+};
+
+/* MPEG audio bitrates (in kbps) for MPEG-1 and MPEG-2 / 2.5, layer I to III */
+static const guint16 melo_tags_file_mpeg_bitrates[2][3][15] = {
+  {
+    { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+    { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+  },
+  {
+    { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+  },
+};
+
+/* MPEG audio sample rates for MPEG-1, MPEG-2 and MPEG-2.5 */
+static const guint32 melo_tags_file_mpeg_rates[3][3] = {
+  { 44100, 48000, 32000 },
+  { 22050, 24000, 16000 },
+  { 11025, 12000, 8000 },
+};
+
+static gboolean
+melo_tags_file_read_at (MeloTagsFileReader *r, guint64 offset, gpointer buf,
+                        gsize len)
+{
+  guint8 *p = buf;
+  gssize ret;
+
+  /* Out of file */
+  if (offset > r->size || len > r->size - offset)
+    return FALSE;
+
+  /* Read all bytes */
+  while (len) {
+    ret = pread (r->fd, p, len, offset);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      return FALSE;
+    p += ret;
+    offset += ret;
+    len -= ret;
+  }
+
+  return TRUE;
+}
+
+static guint8 *
+melo_tags_file_read_block (MeloTagsFileReader *r, guint64 offset, gsize len)
+{
+  guint8 *buf;
+
+  /* Block is too big */
+  if (len > MELO_TAGS_FILE_MAX_SIZE)
+    return NULL;
+
+  /* Read block */
+  buf = g_malloc (len ? len : 1);
+  if (!melo_tags_file_read_at (r, offset, buf, len)) {
+    g_free (buf);
+    return NULL;
+  }
+
+  return buf;
+}
+
+static void
+melo_tags_file_set_string (MeloTagsFileReader *r, MeloTagsFields field,
+                           gchar **str, gchar *value)
+{
+  if (!value)
+    return;
+
+  /* Keep first valid value */
+  g_strstrip (value);
+  if (!(r->fields & field) || *str || *value == '\0' ||
+      !g_utf8_validate (value, -1, NULL)) {
+    g_free (value);
+    return;
+  }
+  *str = value;
+}
+
+static void
+melo_tags_file_set_date (MeloTagsFileReader *r, const gchar *value)
+{
+  /* Only year is used ("2016" or "2016-05-01") */
+  if (value && (r->fields & MELO_TAGS_FIELDS_DATE) && !r->tags->date)
+    r->tags->date = atoi (value);
+}
+
+static void
+melo_tags_file_set_track (MeloTagsFileReader *r, const gchar *value,
+                          gboolean total)
+{
+  const gchar *tracks;
+
+  if (!value)
+    return;
+
+  /* Track number with optional count ("3" or "3/12") */
+  if (total) {
+    tracks = value;
+  } else {
+    if ((r->fields & MELO_TAGS_FIELDS_TRACK) && !r->tags->track)
+      r->tags->track = atoi (value);
+    tracks = strchr (value, '/');
+    if (!tracks)
+      return;
+    tracks++;
+  }
+
+  /* Track count */
+  if ((r->fields & MELO_TAGS_FIELDS_TRACKS) && !r->tags->tracks)
+    r->tags->tracks = atoi (tracks);
+}
+
+static void
+melo_tags_file_set_genre_id (MeloTagsFileReader *r, guint id)
+{
+  const gchar *genre;
+
+  /* Get genre from ID3 genre list */
+  genre = gst_tag_id3_genre_get (id);
+  if (genre)
+    melo_tags_file_set_string (r, MELO_TAGS_FIELDS_GENRE, &r->tags->genre,
+                               g_strdup (genre));
+}
+
+static void
+melo_tags_file_set_genre (MeloTagsFileReader *r, gchar *value)
+{
+  const gchar *p;
+  gchar *end;
+  guint64 id;
+
+  if (!value)
+    return;
+
+  /* ID3 genre reference: "(17)", "17" or refined "(17)Rock" */
+  p = value[0] == '(' ? value + 1 : value;
+  id = g_ascii_strtoull (p, &end, 10);
+  if (end != p && ((value[0] == '(' && *end == ')') || *end == '\0')) {
+    if (*end == ')' && end[1] != '\0') {
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_GENRE, &r->tags->genre,
+                                 g_strdup (end + 1));
+    } else
+      melo_tags_file_set_genre_id (r, id);
+    g_free (value);
+    return;
+  }
+
+  melo_tags_file_set_string (r, MELO_TAGS_FIELDS_GENRE, &r->tags->genre,
+                             value);
+}
+
+static const gchar *
+melo_tags_file_get_image_type (const guint8 *data, gsize len)
+{
+  /* Guess image type from its first bytes */
+  if (len >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff)
+    return "image/jpeg";
+  if (len >= 4 && !memcmp (data, "\x89PNG", 4))
+    return "image/png";
+  return NULL;
+}
+
+static void
+melo_tags_file_set_cover (MeloTagsFileReader *r, const guint8 *data,
+                          gsize len, const gchar *type, gint picture_type)
+{
+  /* Select front cover or first image */
+  if (!(r->fields & MELO_TAGS_FIELDS_COVER) || !len ||
+      r->cover_type == MELO_TAGS_FILE_FRONT_COVER ||
+      (r->cover_type >= 0 && picture_type != MELO_TAGS_FILE_FRONT_COVER))
+    return;
+
+  /* Image is a link ("-->") or an unknown format */
+  if (!g_strcmp0 (type, "-->"))
+    return;
+  if (!type || !g_str_has_prefix (type, "image/") ||
+      !g_strcmp0 (type, "image/jpg"))
+    type = melo_tags_file_get_image_type (data, len);
+  if (!type)
+    return;
+
+  /* Set cover */
+  melo_tags_take_cover (r->tags, g_bytes_new (data, len), type);
+  r->cover_type = picture_type;
+}
+
+static void
+melo_tags_file_parse_picture (MeloTagsFileReader *r, const guint8 *data,
+                              gsize len)
+{
+  guint32 type, l;
+  gchar *mime;
+  gsize off;
+
+  /* Picture type and MIME type */
+  if (len < 8)
+    return;
+  type = GST_READ_UINT32_BE (data);
+  l = GST_READ_UINT32_BE (data + 4);
+  if (l > len - 8)
+    return;
+  mime = g_strndup ((const gchar *) data + 8, l);
+  off = 8 + l;
+
+  /* Skip description, width, height, depth and colors */
+  if (off + 4 > len)
+    goto end;
+  l = GST_READ_UINT32_BE (data + off);
+  off += 4;
+  if (l > len - off || len - off - l < 20)
+    goto end;
+  off += l + 16;
+
+  /* Picture data */
+  l = GST_READ_UINT32_BE (data + off);
+  off += 4;
+  if (l <= len - off)
+    melo_tags_file_set_cover (r, data + off, l, mime, type);
+
+end:
+  g_free (mime);
+}
+
+static gboolean
+melo_tags_file_is_key (const gchar *key, gsize len, const gchar *name)
+{
+  return strlen (name) == len && !g_ascii_strncasecmp (key, name, len);
+}
+
+static void
+melo_tags_file_parse_vorbis_comment (MeloTagsFileReader *r,
+                                     const guint8 *data, gsize len)
+{
+  guint32 count, l;
+  gsize off;
+
+  /* Skip vendor string */
+  if (len < 8)
+    return;
+  l = GST_READ_UINT32_LE (data);
+  if (l > len - 8)
+    return;
+  off = 4 + l;
+
+  /* Parse comments ("KEY=value") */
+  count = GST_READ_UINT32_LE (data + off);
+  off += 4;
+  while (count-- && len - off >= 4) {
+    const gchar *key, *eq;
+    gchar *value;
+    gsize klen;
+
+    /* Get next comment */
+    l = GST_READ_UINT32_LE (data + off);
+    off += 4;
+    if (l > len - off)
+      break;
+    key = (const gchar *) data + off;
+    off += l;
+
+    /* Split key and value */
+    eq = memchr (key, '=', l);
+    if (!eq)
+      continue;
+    klen = eq - key;
+    value = g_strndup (eq + 1, l - klen - 1);
+
+    /* Set tags */
+    if (melo_tags_file_is_key (key, klen, "TITLE"))
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_TITLE, &r->tags->title,
+                                 value);
+    else if (melo_tags_file_is_key (key, klen, "ARTIST"))
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_ARTIST, &r->tags->artist,
+                                 value);
+    else if (melo_tags_file_is_key (key, klen, "ALBUM"))
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_ALBUM, &r->tags->album,
+                                 value);
+    else if (melo_tags_file_is_key (key, klen, "GENRE"))
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_GENRE, &r->tags->genre,
+                                 value);
+    else {
+      if (melo_tags_file_is_key (key, klen, "DATE") ||
+          melo_tags_file_is_key (key, klen, "YEAR"))
+        melo_tags_file_set_date (r, value);
+      else if (melo_tags_file_is_key (key, klen, "TRACKNUMBER"))
+        melo_tags_file_set_track (r, value, FALSE);
+      else if (melo_tags_file_is_key (key, klen, "TRACKTOTAL") ||
+               melo_tags_file_is_key (key, klen, "TOTALTRACKS"))
+        melo_tags_file_set_track (r, value, TRUE);
+      else if ((r->fields & MELO_TAGS_FIELDS_COVER) &&
+               melo_tags_file_is_key (key, klen, "METADATA_BLOCK_PICTURE")) {
+        guchar *pic;
+        gsize pic_len;
+
+        /* Picture is a FLAC picture block encoded in base64 */
+        pic = g_base64_decode (value, &pic_len);
+        melo_tags_file_parse_picture (r, pic, pic_len);
+        g_free (pic);
+      }
+      g_free (value);
+    }
+  }
+}
+
+static gboolean
+melo_tags_file_read_flac (MeloTagsFileReader *r, guint64 offset)
+{
+  gboolean last = FALSE;
+  guint8 hdr[18];
+
+  /* Parse metadata blocks after "fLaC" */
+  offset += 4;
+  while (!last && melo_tags_file_read_at (r, offset, hdr, 4)) {
+    guint32 len = GST_READ_UINT24_BE (hdr + 1);
+    guint8 type = hdr[0] & 0x7f;
+    guint8 *block;
+
+    last = hdr[0] & 0x80;
+    offset += 4;
+
+    /* Stream info: get duration from sample rate and total samples */
+    if (type == 0 && len >= 18 &&
+        melo_tags_file_read_at (r, offset, hdr, 18)) {
+      guint32 rate;
+      guint64 samples;
+
+      rate = ((guint32) hdr[10] << 12) | (hdr[11] << 4) | (hdr[12] >> 4);
+      samples = ((guint64) (hdr[13] & 0x0f) << 32) |
+                GST_READ_UINT32_BE (hdr + 14);
+      if (rate)
+        r->duration = gst_util_uint64_scale (samples, GST_SECOND, rate);
+      r->samplerate = rate;
+      r->channels = ((hdr[12] >> 1) & 0x07) + 1;
+    }
+
+    /* Vorbis comments and pictures */
+    if (type == 4 || (type == 6 && (r->fields & MELO_TAGS_FIELDS_COVER))) {
+      block = melo_tags_file_read_block (r, offset, len);
+      if (block) {
+        if (type == 4)
+          melo_tags_file_parse_vorbis_comment (r, block, len);
+        else
+          melo_tags_file_parse_picture (r, block, len);
+        g_free (block);
+      }
+    }
+    offset += len;
+  }
+
+  /* Audio frames follow metadata blocks */
+  if (offset < r->size)
+    r->audio_size = r->size - offset;
+
+  return TRUE;
+}
+
+static gchar *
+melo_tags_file_latin1 (const guint8 *data, gsize len)
+{
+  gsize l;
+
+  /* Convert a fixed size ISO-8859-1 string */
+  for (l = 0; l < len && data[l]; l++);
+  return g_convert ((const gchar *) data, l, "UTF-8", "ISO-8859-1", NULL,
+                    NULL, NULL);
+}
+
+static gchar *
+melo_tags_file_id3_text (const guint8 *data, gsize len)
+{
+  const gchar *charset;
+
+  if (!len)
+    return NULL;
+
+  /* Get text encoding */
+  switch (data[0]) {
+    case 0:
+      return melo_tags_file_latin1 (data + 1, len - 1);
+    case 1:
+      charset = "UTF-16";
+      break;
+    case 2:
+      charset = "UTF-16BE";
+      break;
+    case 3:
+      return g_strndup ((const gchar *) data + 1, len - 1);
+    default:
+      return NULL;
+  }
+
+  /* Convert UTF-16 text: only first value is kept */
+  return g_convert ((const gchar *) data + 1, (len - 1) & ~1, "UTF-8",
+                    charset, NULL, NULL, NULL);
+}
+
+static gsize
+melo_tags_file_id3_skip_text (const guint8 *data, gsize len, guint8 encoding)
+{
+  gsize i;
+
+  /* Find end of a null terminated string */
+  if (encoding == 1 || encoding == 2) {
+    for (i = 0; i + 1 < len; i += 2)
+      if (!data[i] && !data[i + 1])
+        return i + 2;
+  } else {
+    for (i = 0; i < len; i++)
+      if (!data[i])
+        return i + 1;
+  }
+
+  return len;
+}
+
+static void
+melo_tags_file_parse_id3v2_frame (MeloTagsFileReader *r, const gchar *id,
+                                  const guint8 *data, gsize len, gint version)
+{
+  /* Attached picture */
+  if (!strcmp (id, "APIC")) {
+    const gchar *type = NULL;
+    gchar *mime = NULL;
+    gint picture_type;
+    gsize off;
+
+    if (!(r->fields & MELO_TAGS_FIELDS_COVER) || len < 5)
+      return;
+
+    /* Get image type: "JPG" / "PNG" for ID3v2.2 */
+    if (version == 2) {
+      if (!memcmp (data + 1, "PNG", 3))
+        type = "image/png";
+      else if (!memcmp (data + 1, "JPG", 3))
+        type = "image/jpeg";
+      off = 4;
+    } else {
+      off = 1 + melo_tags_file_id3_skip_text (data + 1, len - 1, 0);
+      type = mime = g_strndup ((const gchar *) data + 1, off - 1);
+      if (off >= len) {
+        g_free (mime);
+        return;
+      }
+    }
+
+    /* Skip description */
+    picture_type = data[off++];
+    off += melo_tags_file_id3_skip_text (data + off, len - off, data[0]);
+    if (off < len)
+      melo_tags_file_set_cover (r, data + off, len - off, type, picture_type);
+    g_free (mime);
+    return;
+  }
+
+  /* Only text frames are used */
+  if (id[0] != 'T')
+    return;
+
+  if (!strcmp (id, "TIT2"))
+    melo_tags_file_set_string (r, MELO_TAGS_FIELDS_TITLE, &r->tags->title,
+                               melo_tags_file_id3_text (data, len));
+  else if (!strcmp (id, "TPE1"))
+    melo_tags_file_set_string (r, MELO_TAGS_FIELDS_ARTIST, &r->tags->artist,
+                               melo_tags_file_id3_text (data, len));
+  else if (!strcmp (id, "TALB"))
+    melo_tags_file_set_string (r, MELO_TAGS_FIELDS_ALBUM, &r->tags->album,
+                               melo_tags_file_id3_text (data, len));
+  else if (!strcmp (id, "TCON"))
+    melo_tags_file_set_genre (r, melo_tags_file_id3_text (data, len));
+  else if (!strcmp (id, "TDRC") || !strcmp (id, "TYER") ||
+           !strcmp (id, "TRCK")) {
+    gchar *text = melo_tags_file_id3_text (data, len);
+
+    if (id[1] == 'R')
+      melo_tags_file_set_track (r, text, FALSE);
+    else
+      melo_tags_file_set_date (r, text);
+    g_free (text);
+  }
+}
+
+static gsize
+melo_tags_file_id3_unsync (guint8 *data, gsize len)
+{
+  gsize i, j;
+
+  /* Remove 0x00 inserted after each 0xFF */
+  for (i = 0, j = 0; i < len; i++) {
+    data[j++] = data[i];
+    if (data[i] == 0xff && i + 1 < len && !data[i + 1])
+      i++;
+  }
+
+  return j;
+}
+
+static gboolean
+melo_tags_file_read_id3v2 (MeloTagsFileReader *r, guint64 *offset)
+{
+  gboolean unsync_frames;
+  guint8 hdr[10], *tag;
+  gsize size, off = 0;
+  gint version;
+  guint8 flags;
+
+  /* Read header */
+  if (!melo_tags_file_read_at (r, 0, hdr, 10) || memcmp (hdr, "ID3", 3))
+    return FALSE;
+  version = hdr[3];
+  flags = hdr[5];
+  size = MELO_TAGS_FILE_SYNCSAFE (hdr + 6);
+  *offset = 10 + size + (flags & 0x10 ? 10 : 0);
+
+  /* Unsupported version */
+  if (version < 2 || version > 4)
+    return TRUE;
+
+  /* Read complete tag */
+  tag = melo_tags_file_read_block (r, 10, size);
+  if (!tag)
+    return TRUE;
+
+  /* Remove unsynchronisation: done per frame since ID3v2.4 */
+  unsync_frames = version == 4 && (flags & 0x80);
+  if (version < 4 && (flags & 0x80))
+    size = melo_tags_file_id3_unsync (tag, size);
+
+  /* Skip extended header */
+  if (version > 2 && (flags & 0x40) && size >= 4)
+    off = version == 3 ? GST_READ_UINT32_BE (tag) + 4 :
+                         MELO_TAGS_FILE_SYNCSAFE (tag);
+
+  /* Parse frames */
+  while (off < size) {
+    gsize hlen = version == 2 ? 6 : 10;
+    guint16 frame_flags = 0;
+    guint8 *data = NULL;
+    gsize len;
+    gchar id[5];
+
+    /* Get frame header: stop on padding */
+    if (size - off < hlen || !tag[off])
+      break;
+    if (version == 2) {
+      guint i;
+
+      /* Convert ID to ID3v2.3 */
+      memcpy (id, tag + off, 3);
+      id[3] = '\0';
+      len = GST_READ_UINT24_BE (tag + off + 3);
+      for (i = 0; i < G_N_ELEMENTS (melo_tags_file_id3v22_ids); i++) {
+        if (!strcmp (id, melo_tags_file_id3v22_ids[i][0])) {
+          strcpy (id, melo_tags_file_id3v22_ids[i][1]);
+          break;
+        }
+      }
+    } else {
+      memcpy (id, tag + off, 4);
+      len = version == 4 ? MELO_TAGS_FILE_SYNCSAFE (tag + off + 4) :
+                           GST_READ_UINT32_BE (tag + off + 4);
+      frame_flags = GST_READ_UINT16_BE (tag + off + 8);
+    }
+    id[4] = '\0';
+    off += hlen;
+    if (len > size - off)
+      break;
+
+    /* Skip compressed, encrypted and grouped frames */
+    if ((version == 3 && (frame_flags & 0x00e0)) ||
+        (version == 4 && (frame_flags & 0x004c))) {
+      off += len;
+      continue;
+    }
+
+    /* Get frame data: length is checked against tag size above */
+    data = g_malloc (len ? len : 1);
+    memcpy (data, tag + off, len);
+    off += len;
+    r->id3_frames++;
+    if (version == 4 && (unsync_frames || (frame_flags & 0x0002)))
+      len = melo_tags_file_id3_unsync (data, len);
+    if (version == 4 && (frame_flags & 0x0001)) {
+      /* Skip data length indicator */
+      if (len >= 4)
+        melo_tags_file_parse_id3v2_frame (r, id, data + 4, len - 4, version);
+    } else
+      melo_tags_file_parse_id3v2_frame (r, id, data, len, version);
+    g_free (data);
+  }
+  g_free (tag);
+
+  return TRUE;
+}
+
+static gboolean
+melo_tags_file_read_id3v1 (MeloTagsFileReader *r)
+{
+  guint8 tag[128];
+  gchar *year;
+
+  /* Read tag at end of file */
+  if (r->size < 128 ||
+      !melo_tags_file_read_at (r, r->size - 128, tag, 128) ||
+      memcmp (tag, "TAG", 3))
+    return FALSE;
+
+  /* Set tags missing in ID3v2 */
+  melo_tags_file_set_string (r, MELO_TAGS_FIELDS_TITLE, &r->tags->title,
+                             melo_tags_file_latin1 (tag + 3, 30));
+  melo_tags_file_set_string (r, MELO_TAGS_FIELDS_ARTIST, &r->tags->artist,
+                             melo_tags_file_latin1 (tag + 33, 30));
+  melo_tags_file_set_string (r, MELO_TAGS_FIELDS_ALBUM, &r->tags->album,
+                             melo_tags_file_latin1 (tag + 63, 30));
+  year = melo_tags_file_latin1 (tag + 93, 4);
+  melo_tags_file_set_date (r, year);
+  g_free (year);
+
+  /* ID3v1.1 track number */
+  if (!tag[125] && tag[126] && (r->fields & MELO_TAGS_FIELDS_TRACK) &&
+      !r->tags->track)
+    r->tags->track = tag[126];
+
+  /* Genre index */
+  if (tag[127] != 0xff)
+    melo_tags_file_set_genre_id (r, tag[127]);
+
+  return TRUE;
+}
+
+static gboolean
+melo_tags_file_read_mpeg (MeloTagsFileReader *r, guint64 offset, guint64 end)
+{
+  guint8 buf[MELO_TAGS_FILE_MPEG_SEARCH];
+  guint32 bitrate, rate, frames = 0;
+  guint version, layer, lsf, spf;
+  gsize len, i, x;
+
+  /* Read start of audio data */
+  if (offset >= end)
+    return FALSE;
+  len = MIN (end - offset, sizeof (buf));
+  if (!melo_tags_file_read_at (r, offset, buf, len))
+    return FALSE;
+
+  /* Find first valid frame header */
+  for (i = 0; i + 4 <= len; i++) {
+    if (buf[i] != 0xff || (buf[i + 1] & 0xe0) != 0xe0)
+      continue;
+    version = (buf[i + 1] >> 3) & 0x03;
+    layer = (buf[i + 1] >> 1) & 0x03;
+    if (version != 1 && layer && (buf[i + 2] >> 4) != 0 &&
+        (buf[i + 2] >> 4) != 0x0f && ((buf[i + 2] >> 2) & 0x03) != 3)
+      break;
+  }
+  if (i + 4 > len)
+    return FALSE;
+
+  /* Get frame details */
+  lsf = version != 3;
+  layer = 3 - layer;
+  bitrate = melo_tags_file_mpeg_bitrates[lsf][layer][buf[i + 2] >> 4] * 1000;
+  rate = melo_tags_file_mpeg_rates[version == 3 ? 0 : version == 2 ? 1 : 2]
+                                  [(buf[i + 2] >> 2) & 0x03];
+  spf = layer == 0 ? 384 : layer == 2 && lsf ? 576 : 1152;
+  r->samplerate = rate;
+  r->channels = (buf[i + 3] >> 6) == 3 ? 1 : 2;
+  r->audio_size = end - offset - i;
+
+  /* Find Xing / Info header (after side info) or VBRI header */
+  x = i + 4 + ((buf[i + 3] >> 6) == 3 ? (lsf ? 9 : 17) : (lsf ? 17 : 32));
+  if (x + 12 <= len && (!memcmp (buf + x, "Xing", 4) ||
+      !memcmp (buf + x, "Info", 4)) && (GST_READ_UINT32_BE (buf + x + 4) & 1))
+    frames = GST_READ_UINT32_BE (buf + x + 8);
+  else if (i + 54 <= len && !memcmp (buf + i + 36, "VBRI", 4))
+    frames = GST_READ_UINT32_BE (buf + i + 50);
+
+  /* Get duration from frame count (VBR) or from bitrate (CBR) */
+  if (frames) {
+    r->duration = gst_util_uint64_scale ((guint64) frames * spf, GST_SECOND,
+                                         rate);
+  } else {
+    r->duration = gst_util_uint64_scale (r->audio_size, 8 * GST_SECOND,
+                                         bitrate);
+    r->bitrate = bitrate;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+melo_tags_file_read_ogg (MeloTagsFileReader *r)
+{
+  guint8 hdr[27 + 255], *data;
+  GByteArray *packet;
+  guint64 offset = 0;
+  guint64 pre_skip = 0;
+  guint32 serial = 0;
+  guint32 rate = 0;
+  guint packets = 0;
+  gboolean opus = FALSE;
+  gboolean ret = FALSE;
+  gsize len;
+  gssize i;
+
+  /* Get identification and comment packets from first pages */
+  packet = g_byte_array_new ();
+  while (packets < 2 && melo_tags_file_read_at (r, offset, hdr, 27) &&
+         !memcmp (hdr, "OggS", 4)) {
+    guint nsegs = hdr[26], s;
+    gsize pos = 0;
+
+    /* Read segment table and page data */
+    if (!melo_tags_file_read_at (r, offset + 27, hdr + 27, nsegs))
+      break;
+    if (!offset)
+      serial = GST_READ_UINT32_LE (hdr + 14);
+    for (s = 0, len = 0; s < nsegs; s++)
+      len += hdr[27 + s];
+    data = melo_tags_file_read_block (r, offset + 27 + nsegs, len);
+    if (!data)
+      break;
+    offset += 27 + nsegs + len;
+
+    /* Split page in packets */
+    for (s = 0; s < nsegs && packets < 2; s++) {
+      guint seg = hdr[27 + s];
+
+      g_byte_array_append (packet, data + pos, seg);
+      pos += seg;
+      if (seg == 255)
+        continue;
+
+      /* Packet is complete */
+      if (!packets++) {
+        /* Identification header: only Vorbis and Opus are supported */
+        if (packet->len >= 16 && !memcmp (packet->data, "\x01vorbis", 7)) {
+          rate = GST_READ_UINT32_LE (packet->data + 12);
+          r->samplerate = rate;
+          r->channels = packet->data[11];
+        } else if (packet->len >= 19 &&
+                   !memcmp (packet->data, "OpusHead", 8)) {
+          pre_skip = GST_READ_UINT16_LE (packet->data + 10);
+          rate = 48000;
+          opus = TRUE;
+
+          /* Opus is always decoded at 48kHz: use input sample rate */
+          r->samplerate = GST_READ_UINT32_LE (packet->data + 12);
+          r->channels = packet->data[9];
+        } else
+          packets = 2;
+      } else {
+        /* Comment header */
+        if (!opus && packet->len >= 7 &&
+            !memcmp (packet->data, "\x03vorbis", 7)) {
+          melo_tags_file_parse_vorbis_comment (r, packet->data + 7,
+                                               packet->len - 7);
+          ret = TRUE;
+        } else if (opus && packet->len >= 8 &&
+                   !memcmp (packet->data, "OpusTags", 8)) {
+          melo_tags_file_parse_vorbis_comment (r, packet->data + 8,
+                                               packet->len - 8);
+          ret = TRUE;
+        }
+      }
+      g_byte_array_set_size (packet, 0);
+    }
+    g_free (data);
+
+    /* Comment packet is too big */
+    if (packet->len > MELO_TAGS_FILE_MAX_SIZE)
+      break;
+  }
+  g_byte_array_unref (packet);
+
+  if (!ret || !rate)
+    return ret;
+  r->audio_size = r->size;
+
+  /* Get duration from granule position of last page */
+  len = MIN (r->size, MELO_TAGS_FILE_OGG_SEARCH);
+  data = melo_tags_file_read_block (r, r->size - len, len);
+  if (!data)
+    return ret;
+  for (i = (gssize) len - 27; i >= 0; i--) {
+    gint64 granule;
+
+    if (memcmp (data + i, "OggS", 4) ||
+        GST_READ_UINT32_LE (data + i + 14) != serial)
+      continue;
+    granule = GST_READ_UINT64_LE (data + i + 6);
+    if (granule < 0)
+      continue;
+    if (opus)
+      granule = granule > pre_skip ? granule - pre_skip : 0;
+    r->duration = gst_util_uint64_scale (granule, GST_SECOND, rate);
+    break;
+  }
+  g_free (data);
+
+  return ret;
+}
+
+static gboolean
+melo_tags_file_mp4_find (MeloTagsFileReader *r, guint64 start, guint64 end,
+                         const gchar *type, guint64 *child_start,
+                         guint64 *child_end)
+{
+  guint8 hdr[16];
+
+  /* Find child atom */
+  while (start + 8 <= end && melo_tags_file_read_at (r, start, hdr, 8)) {
+    guint64 size = GST_READ_UINT32_BE (hdr);
+    guint hlen = 8;
+
+    /* Get atom size: 64-bits size or until end */
+    if (size == 1) {
+      if (!melo_tags_file_read_at (r, start + 8, hdr + 8, 8))
+        break;
+      size = GST_READ_UINT64_BE (hdr + 8);
+      hlen = 16;
+    } else if (!size)
+      size = end - start;
+    if (size < hlen || size > end - start)
+      break;
+
+    /* Atom found */
+    if (!memcmp (hdr + 4, type, 4)) {
+      *child_start = start + hlen;
+      *child_end = start + size;
+      return TRUE;
+    }
+    start += size;
+  }
+
+  return FALSE;
+}
+
+static void
+melo_tags_file_parse_mp4_item (MeloTagsFileReader *r, const guint8 *type,
+                               guint32 data_type, const guint8 *data,
+                               gsize len)
+{
+  gchar *text;
+
+  /* Text items */
+  if (type[0] == 0xa9) {
+    text = g_strndup ((const gchar *) data, len);
+    if (!memcmp (type + 1, "nam", 3))
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_TITLE, &r->tags->title,
+                                 text);
+    else if (!memcmp (type + 1, "ART", 3))
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_ARTIST, &r->tags->artist,
+                                 text);
+    else if (!memcmp (type + 1, "alb", 3))
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_ALBUM, &r->tags->album,
+                                 text);
+    else if (!memcmp (type + 1, "gen", 3))
+      melo_tags_file_set_string (r, MELO_TAGS_FIELDS_GENRE, &r->tags->genre,
+                                 text);
+    else {
+      if (!memcmp (type + 1, "day", 3))
+        melo_tags_file_set_date (r, text);
+      g_free (text);
+    }
+    return;
+  }
+
+  /* Binary items */
+  if (!memcmp (type, "trkn", 4) && len >= 6) {
+    if ((r->fields & MELO_TAGS_FIELDS_TRACK) && !r->tags->track)
+      r->tags->track = GST_READ_UINT16_BE (data + 2);
+    if ((r->fields & MELO_TAGS_FIELDS_TRACKS) && !r->tags->tracks)
+      r->tags->tracks = GST_READ_UINT16_BE (data + 4);
+  } else if (!memcmp (type, "gnre", 4) && len >= 2) {
+    if (GST_READ_UINT16_BE (data))
+      melo_tags_file_set_genre_id (r, GST_READ_UINT16_BE (data) - 1);
+  } else if (!memcmp (type, "covr", 4)) {
+    melo_tags_file_set_cover (r, data, len,
+                              data_type == 14 ? "image/png" :
+                              data_type == 13 ? "image/jpeg" : NULL,
+                              MELO_TAGS_FILE_FRONT_COVER);
+  }
+}
+
+static void
+melo_tags_file_read_mp4_audio (MeloTagsFileReader *r, guint64 start,
+                               guint64 end)
+{
+  guint64 s, e, ts, te;
+  guint8 buf[36];
+
+  /* Find first audio track */
+  while (melo_tags_file_mp4_find (r, start, end, "trak", &ts, &te)) {
+    start = te;
+
+    /* Check handler type: moov.trak.mdia.hdlr */
+    if (!melo_tags_file_mp4_find (r, ts, te, "mdia", &ts, &te) ||
+        !melo_tags_file_mp4_find (r, ts, te, "hdlr", &s, &e) ||
+        !melo_tags_file_read_at (r, s, buf, 12) || memcmp (buf + 8, "soun", 4))
+      continue;
+
+    /* Get first sample entry: mdia.minf.stbl.stsd */
+    if (!melo_tags_file_mp4_find (r, ts, te, "minf", &ts, &te) ||
+        !melo_tags_file_mp4_find (r, ts, te, "stbl", &ts, &te) ||
+        !melo_tags_file_mp4_find (r, ts, te, "stsd", &s, &e) ||
+        !melo_tags_file_read_at (r, s + 8, buf, 36))
+      return;
+
+    /* Audio sample entry: channels and sample rate (16.16 fixed point) */
+    r->channels = GST_READ_UINT16_BE (buf + 24);
+    r->samplerate = GST_READ_UINT32_BE (buf + 32) >> 16;
+    return;
+  }
+}
+
+static gboolean
+melo_tags_file_read_mp4 (MeloTagsFileReader *r)
+{
+  guint64 start, end, s, e;
+  guint8 buf[32], *ilst;
+  gsize off, len;
+
+  /* Find movie atom */
+  if (!melo_tags_file_mp4_find (r, 0, r->size, "moov", &start, &end))
+    return FALSE;
+
+  /* Get duration from movie header */
+  if (melo_tags_file_mp4_find (r, start, end, "mvhd", &s, &e) &&
+      melo_tags_file_read_at (r, s, buf, 32)) {
+    guint64 duration;
+    guint32 scale;
+
+    if (buf[0] == 1) {
+      scale = GST_READ_UINT32_BE (buf + 20);
+      duration = GST_READ_UINT64_BE (buf + 24);
+    } else {
+      scale = GST_READ_UINT32_BE (buf + 12);
+      duration = GST_READ_UINT32_BE (buf + 16);
+    }
+    if (scale)
+      r->duration = gst_util_uint64_scale (duration, GST_SECOND, scale);
+    r->audio_size = r->size;
+  }
+
+  /* Get audio details from tracks */
+  melo_tags_file_read_mp4_audio (r, start, end);
+
+  /* Find item list: moov.udta.meta.ilst (meta has version and flags) */
+  if (!melo_tags_file_mp4_find (r, start, end, "udta", &s, &e) ||
+      !melo_tags_file_mp4_find (r, s, e, "meta", &s, &e) ||
+      !melo_tags_file_mp4_find (r, s + 4, e, "ilst", &s, &e))
+    return TRUE;
+
+  /* Read item list */
+  len = e - s;
+  ilst = melo_tags_file_read_block (r, s, len);
+  if (!ilst)
+    return TRUE;
+
+  /* Parse items: each item contains a data atom */
+  for (off = 0; len - off >= 8;) {
+    guint32 size = GST_READ_UINT32_BE (ilst + off);
+    const guint8 *item = ilst + off;
+
+    if (size < 8 || size > len - off)
+      break;
+    off += size;
+
+    /* Get data atom */
+    if (size >= 24 && !memcmp (item + 12, "data", 4)) {
+      guint32 data_size = GST_READ_UINT32_BE (item + 8);
+      guint32 data_type = GST_READ_UINT32_BE (item + 16) & 0xffffff;
+
+      if (data_size >= 16 && data_size <= size - 8)
+        melo_tags_file_parse_mp4_item (r, item + 4, data_type, item + 24,
+                                       data_size - 16);
+    }
+  }
+  g_free (ilst);
+
+  return TRUE;
+}
+
+MeloTags *
+melo_tags_file_read (const gchar *filename, MeloTagsFields fields)
+{
+  MeloTagsFileReader r = { .fd = -1, .cover_type = -1, .fields = fields };
+  guint64 offset = 0;
+  gboolean ret = FALSE;
+  guint8 magic[12];
+  struct stat st;
+
+  /* Open file */
+  if (!filename)
+    return NULL;
+  r.fd = open (filename, O_RDONLY | O_CLOEXEC);
+  if (r.fd < 0)
+    return NULL;
+
+  /* Get file size */
+  if (fstat (r.fd, &st) || !S_ISREG (st.st_mode)) {
+    close (r.fd);
+    return NULL;
+  }
+  r.size = st.st_size;
+
+  /* Create tags */
+  r.tags = melo_tags_new ();
+  if (!r.tags) {
+    close (r.fd);
+    return NULL;
+  }
+
+  /* Read ID3v2 tag and find format after it */
+  if (!melo_tags_file_read_at (&r, 0, magic, sizeof (magic)))
+    goto end;
+  if (melo_tags_file_read_id3v2 (&r, &offset) &&
+      !melo_tags_file_read_at (&r, offset, magic, 4))
+    memset (magic, 0, sizeof (magic));
+
+  /* Parse file */
+  if (!memcmp (magic, "fLaC", 4)) {
+    ret = melo_tags_file_read_flac (&r, offset);
+  } else if (!offset && !memcmp (magic, "OggS", 4)) {
+    ret = melo_tags_file_read_ogg (&r);
+  } else if (!offset && !memcmp (magic + 4, "ftyp", 4)) {
+    ret = melo_tags_file_read_mp4 (&r);
+  } else if (offset || (magic[0] == 0xff && (magic[1] & 0xe0) == 0xe0 &&
+                         ((magic[1] >> 1) & 0x03) != 0)) {
+    gboolean id3v1 = FALSE;
+    guint64 end = r.size;
+
+    /* MPEG audio with ID3v2 and / or ID3v1 tags: ADTS AAC (layer 0) is left
+     * to GstDiscoverer, as other formats found after an empty ID3v2 tag.
+     */
+    if (melo_tags_file_read_id3v1 (&r)) {
+      id3v1 = TRUE;
+      end -= 128;
+    }
+    ret = melo_tags_file_read_mpeg (&r, offset, end) || r.id3_frames || id3v1;
+  }
+
+end:
+  /* Close file */
+  close (r.fd);
+
+  /* Format not supported */
+  if (!ret) {
+    melo_tags_unref (r.tags);
+    return NULL;
+  }
+
+  /* Set stream details: bitrate is an average when not in stream */
+  if (r.duration && !r.bitrate)
+    r.bitrate = gst_util_uint64_scale (r.audio_size, 8 * GST_SECOND,
+                                       r.duration);
+  if (fields & MELO_TAGS_FIELDS_DURATION)
+    r.tags->duration = r.duration / GST_MSECOND;
+  if (fields & MELO_TAGS_FIELDS_BITRATE)
+    r.tags->bitrate = r.bitrate;
+  if (fields & MELO_TAGS_FIELDS_SAMPLERATE)
+    r.tags->samplerate = r.samplerate;
+  if (fields & MELO_TAGS_FIELDS_CHANNELS)
+    r.tags->channels = r.channels;
+
+  return r.tags;
+}
@@ -0,0 +1,38 @@
+/*
+ * melo_tags_file.h: Fast tags reader for local media files
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __MELO_TAGS_FILE_H__
+#define __MELO_TAGS_FILE_H__
+
+#include "melo_tags.h"
+
+G_BEGIN_DECLS
+
+/* Read tags and stream details from a local file (FLAC, MP3 with ID3v2 /
+ * ID3v1, Ogg Vorbis, Ogg Opus and MP4) without a GStreamer pipeline: only
+ * metadata blocks are read. NULL is returned when the format is not supported,
+ * then a GstDiscoverer should be used.
+ */
+MeloTags *melo_tags_file_read (const gchar *filename, MeloTagsFields fields);
+
+G_END_DECLS
+
+#endif /* __MELO_TAGS_FILE_H__ */
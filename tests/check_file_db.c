@@ -0,0 +1,184 @@
+/*
+ * check_file_db.c: Tests of File module database
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "melo_file_db.h"
+
+/* Page size of lists */
+#define CHECK_FILE_DB_PAGE 2
+
+/* Mixed-case names: same names with another case are sorted together */
+static const gchar *check_file_db_names[] = {
+  "b.mp3", "A.mp3", "c.mp3", "B.mp3", "a.mp3", "C.mp3", "d.mp3"
+};
+
+typedef struct {
+  MeloFileDB *db;
+  gchar *dir;
+  gchar *file;
+} CheckFileDB;
+
+static void
+check_file_db_setup (CheckFileDB *fixture, gconstpointer user_data)
+{
+  gchar *covers;
+  guint i;
+
+  /* Create database in a temporary directory */
+  fixture->dir = g_dir_make_tmp ("check_file_db_XXXXXX", NULL);
+  g_assert_nonnull (fixture->dir);
+  fixture->file = g_build_filename (fixture->dir, "melo.db", NULL);
+  covers = g_build_filename (fixture->dir, "covers", NULL);
+  fixture->db = melo_file_db_new (fixture->file, covers);
+  g_assert_nonnull (fixture->db);
+  g_free (covers);
+
+  /* Add songs without tags */
+  for (i = 0; i < G_N_ELEMENTS (check_file_db_names); i++)
+    g_assert_true (melo_file_db_add_tags (fixture->db, "/music",
+                                          check_file_db_names[i], 1, NULL,
+                                          NULL));
+}
+
+static void
+check_file_db_teardown (CheckFileDB *fixture, gconstpointer user_data)
+{
+  GDir *dir;
+  const gchar *name;
+
+  /* Close database */
+  g_object_unref (fixture->db);
+
+  /* Remove database files */
+  dir = g_dir_open (fixture->dir, 0, NULL);
+  while (dir && (name = g_dir_read_name (dir))) {
+    gchar *path = g_build_filename (fixture->dir, name, NULL);
+
+    g_rmdir (path);
+    g_unlink (path);
+    g_free (path);
+  }
+  if (dir)
+    g_dir_close (dir);
+  g_rmdir (fixture->dir);
+  g_free (fixture->file);
+  g_free (fixture->dir);
+}
+
+static gboolean
+check_file_db_add_row (const gchar *path, const gchar *file, gint id,
+                       const MeloFileDBRow *row, gpointer user_data)
+{
+  g_ptr_array_add ((GPtrArray *) user_data, g_strdup (file));
+  return TRUE;
+}
+
+static GPtrArray *
+check_file_db_get_page (MeloFileDB *db, const gchar *token, gchar **prev,
+                        gchar **next)
+{
+  GPtrArray *page;
+
+  /* Get a page of songs sorted by file name */
+  page = g_ptr_array_new_with_free_func (g_free);
+  *prev = *next = NULL;
+  g_assert_true (melo_file_db_get_song_rows (db, NULL, check_file_db_add_row,
+                                             page, 0, CHECK_FILE_DB_PAGE,
+                                             token, prev, next,
+                                             MELO_FILE_DB_SORT_FILE,
+                                             MELO_TAGS_FIELDS_NONE,
+                                             MELO_FILE_DB_FIELDS_END));
+
+  return page;
+}
+
+static void
+check_file_db_assert_page (GPtrArray *page, GPtrArray *expected)
+{
+  guint i;
+
+  g_assert_cmpuint (page->len, ==, expected->len);
+  for (i = 0; i < page->len; i++)
+    g_assert_cmpstr (g_ptr_array_index (page, i), ==,
+                     g_ptr_array_index (expected, i));
+}
+
+static void
+check_file_db_paging (CheckFileDB *fixture, gconstpointer user_data)
+{
+  GPtrArray *pages, *page;
+  gchar *token = NULL, *back = NULL;
+  gchar *prev, *next;
+  const gchar *last = NULL;
+  guint count = 0, i, j;
+
+  /* Page forward until end of list */
+  pages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+  do {
+    page = check_file_db_get_page (fixture->db, token, &prev, &next);
+    g_ptr_array_add (pages, page);
+    g_free (token);
+    g_free (back);
+    token = next;
+    back = prev;
+
+    /* Names are sorted without case and listed once */
+    for (j = 0; j < page->len; j++) {
+      const gchar *name = g_ptr_array_index (page, j);
+
+      if (last)
+        g_assert_cmpint (g_ascii_strcasecmp (last, name), <=, 0);
+      last = name;
+      count++;
+    }
+  } while (token && page->len == CHECK_FILE_DB_PAGE);
+  g_free (token);
+  g_assert_cmpuint (count, ==, G_N_ELEMENTS (check_file_db_names));
+  g_assert_cmpuint (pages->len, >, 2);
+
+  /* Page backward from last page: same pages are listed */
+  token = back;
+  for (i = pages->len - 1; i > 0; i--) {
+    g_assert_nonnull (token);
+    page = check_file_db_get_page (fixture->db, token, &prev, &next);
+    check_file_db_assert_page (page, g_ptr_array_index (pages, i - 1));
+    g_ptr_array_unref (page);
+    g_free (next);
+    g_free (token);
+    token = prev;
+  }
+  g_free (token);
+  g_ptr_array_unref (pages);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/file_db/paging", CheckFileDB, NULL, check_file_db_setup,
+              check_file_db_paging, check_file_db_teardown);
+
+  return g_test_run ();
+}
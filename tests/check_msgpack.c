@@ -0,0 +1,449 @@
+/*
+ * check_msgpack.c: Tests of MessagePack transport for JSON-RPC
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "melo_jsonrpc.h"
+#include "melo_browser_jsonrpc.h"
+#include "melo_tags.h"
+
+#include "melo_httpd_msgpack.h"
+
+/* Cover image with bytes which are not valid UTF-8 */
+static const guint8 check_cover[] = {
+  0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0xff, 0xfe, 0x80
+};
+
+/* {"jsonrpc":"2.0","method":"library.get_list","params":{"path":"/"},
+ *  "id":1}
+ */
+static const guint8 check_get_list[] = {
+  0x84,
+  0xa7, 'j', 's', 'o', 'n', 'r', 'p', 'c', 0xa3, '2', '.', '0',
+  0xa6, 'm', 'e', 't', 'h', 'o', 'd',
+  0xb0, 'l', 'i', 'b', 'r', 'a', 'r', 'y', '.', 'g', 'e', 't', '_', 'l', 'i',
+  's', 't',
+  0xa6, 'p', 'a', 'r', 'a', 'm', 's', 0x81, 0xa4, 'p', 'a', 't', 'h', 0xa1, '/',
+  0xa2, 'i', 'd', 0x01
+};
+
+/* Browser returning tags with a cover for any path */
+typedef struct {
+  MeloBrowser parent;
+} CheckBrowser;
+
+typedef struct {
+  MeloBrowserClass parent_class;
+} CheckBrowserClass;
+
+G_DEFINE_TYPE (CheckBrowser, check_browser, MELO_TYPE_BROWSER)
+
+static MeloTags *
+check_browser_get_tags (MeloBrowser *browser, const gchar *path,
+                        MeloTagsFields fields)
+{
+  MeloTags *tags;
+
+  /* Create tags with a cover */
+  tags = melo_tags_new ();
+  tags->title = g_strdup (path);
+  melo_tags_take_cover (tags, g_bytes_new_static (check_cover,
+                                                  sizeof (check_cover)),
+                        "image/png");
+
+  return tags;
+}
+
+static void
+check_browser_class_init (CheckBrowserClass *klass)
+{
+  MeloBrowserClass *bclass = MELO_BROWSER_CLASS (klass);
+
+  bclass->get_tags = check_browser_get_tags;
+}
+
+static void
+check_browser_init (CheckBrowser *self)
+{
+}
+
+static gboolean
+check_msgpack_has_cover (GBytes *msgpack)
+{
+  const guint8 *data;
+  gsize len, i;
+
+  /* Find cover as bin 8 */
+  data = g_bytes_get_data (msgpack, &len);
+  for (i = 0; i + 2 + sizeof (check_cover) <= len; i++)
+    if (data[i] == 0xc4 && data[i + 1] == sizeof (check_cover) &&
+        !memcmp (data + i + 2, check_cover, sizeof (check_cover)))
+      return TRUE;
+
+  return FALSE;
+}
+
+static gboolean
+check_msgpack_is_valid (const guint8 *data, gsize len)
+{
+  JsonNode *node;
+
+  /* Decode document */
+  node = melo_httpd_msgpack_decode (data, len);
+  if (!node)
+    return FALSE;
+  json_node_free (node);
+
+  return TRUE;
+}
+
+static void
+check_msgpack_truncated (void)
+{
+  static const guint8 str8[] = { 0xd9 };
+  static const guint8 str[] = { 0xa3, 'a', 'b' };
+  static const guint8 bin16[] = { 0xc5, 0x00 };
+  static const guint8 array32[] = { 0xdd, 0x00, 0x00, 0x00 };
+  static const guint8 map[] = { 0x81, 0xa1, 'a' };
+  static const guint8 float64[] = { 0xcb, 0x3f, 0xf0, 0x00 };
+  static const guint8 int32[] = { 0xd2, 0x00, 0x01 };
+
+  /* Empty document and headers without their value */
+  g_assert_false (check_msgpack_is_valid (str8, 0));
+  g_assert_false (check_msgpack_is_valid (str8, sizeof (str8)));
+  g_assert_false (check_msgpack_is_valid (str, sizeof (str)));
+  g_assert_false (check_msgpack_is_valid (bin16, sizeof (bin16)));
+  g_assert_false (check_msgpack_is_valid (array32, sizeof (array32)));
+  g_assert_false (check_msgpack_is_valid (map, sizeof (map)));
+  g_assert_false (check_msgpack_is_valid (float64, sizeof (float64)));
+  g_assert_false (check_msgpack_is_valid (int32, sizeof (int32)));
+  g_assert_false (check_msgpack_is_valid (check_get_list,
+                                          sizeof (check_get_list) - 1));
+
+  /* Trailing data */
+  g_assert_true (check_msgpack_is_valid (int32 + 2, 1));
+  g_assert_false (check_msgpack_is_valid (int32 + 1, 2));
+}
+
+static void
+check_msgpack_oversized (void)
+{
+  static const guint8 str32[] = { 0xdb, 0xff, 0xff, 0xff, 0xff, 'a' };
+  static const guint8 str16[] = { 0xda, 0x01, 0x00, 'a', 'b' };
+  static const guint8 bin32[] = { 0xc6, 0xff, 0xff, 0xff, 0xff, 0x00 };
+  static const guint8 bin8[] = { 0xc4, 0x10, 0x00 };
+  static const guint8 array32[] = { 0xdd, 0xff, 0xff, 0xff, 0xff, 0x01 };
+  static const guint8 array16[] = { 0xdc, 0x00, 0x03, 0x01, 0x01 };
+  static const guint8 map32[] = {
+    0xdf, 0xff, 0xff, 0xff, 0xff, 0xa1, 'a', 0x01
+  };
+
+  /* Lengths larger than document */
+  g_assert_false (check_msgpack_is_valid (str32, sizeof (str32)));
+  g_assert_false (check_msgpack_is_valid (str16, sizeof (str16)));
+  g_assert_false (check_msgpack_is_valid (bin32, sizeof (bin32)));
+  g_assert_false (check_msgpack_is_valid (bin8, sizeof (bin8)));
+  g_assert_false (check_msgpack_is_valid (array32, sizeof (array32)));
+  g_assert_false (check_msgpack_is_valid (array16, sizeof (array16)));
+  g_assert_false (check_msgpack_is_valid (map32, sizeof (map32)));
+}
+
+static void
+check_msgpack_depth (void)
+{
+  guint8 data[34];
+
+  /* 32 nested arrays are accepted */
+  memset (data, 0x91, 32);
+  data[32] = 0x01;
+  g_assert_true (check_msgpack_is_valid (data, 33));
+
+  /* 33 nested arrays are rejected */
+  memset (data, 0x91, 33);
+  data[33] = 0x01;
+  g_assert_false (check_msgpack_is_valid (data, 34));
+
+  /* Same with maps */
+  memset (data, 0x91, 33);
+  data[32] = 0x80;
+  g_assert_false (check_msgpack_is_valid (data, 33));
+}
+
+static void
+check_msgpack_keys (void)
+{
+  static const guint8 int_key[] = { 0x81, 0x01, 0x01 };
+  static const guint8 bin_key[] = { 0x81, 0xc4, 0x01, 'a', 0x01 };
+  static const guint8 nil_key[] = { 0x81, 0xc0, 0x01 };
+  static const guint8 map_key[] = { 0x81, 0x80, 0x01 };
+  static const guint8 str_key[] = { 0x81, 0xd9, 0x01, 'a', 0x01 };
+
+  /* Only string keys are supported */
+  g_assert_false (check_msgpack_is_valid (int_key, sizeof (int_key)));
+  g_assert_false (check_msgpack_is_valid (bin_key, sizeof (bin_key)));
+  g_assert_false (check_msgpack_is_valid (nil_key, sizeof (nil_key)));
+  g_assert_false (check_msgpack_is_valid (map_key, sizeof (map_key)));
+  g_assert_true (check_msgpack_is_valid (str_key, sizeof (str_key)));
+}
+
+static void
+check_msgpack_floats (void)
+{
+  static const guint8 nan64[] = {
+    0xcb, 0x7f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+  };
+  static const guint8 inf64[] = {
+    0xcb, 0xff, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+  };
+  static const guint8 inf32[] = { 0xca, 0x7f, 0x80, 0x00, 0x00 };
+  static const guint8 big64[] = {
+    0xcb, 0x44, 0x15, 0xaf, 0x1d, 0x78, 0xb5, 0x8c, 0x40
+  };
+  MeloJSONWriter *writer;
+  JsonParser *parser;
+  JsonNode *node;
+  gchar *json;
+
+  /* Non-finite values have no JSON representation */
+  g_assert_false (check_msgpack_is_valid (nan64, sizeof (nan64)));
+  g_assert_false (check_msgpack_is_valid (inf64, sizeof (inf64)));
+  g_assert_false (check_msgpack_is_valid (inf32, sizeof (inf32)));
+
+  /* Large values are written with an exponent: 1e+20 */
+  node = melo_httpd_msgpack_decode (big64, sizeof (big64));
+  g_assert_nonnull (node);
+  writer = melo_json_writer_new ();
+  melo_json_writer_node (writer, node);
+  json = melo_json_writer_free (writer, FALSE);
+  json_node_free (node);
+
+  /* Generated JSON must be valid */
+  parser = json_parser_new ();
+  g_assert_true (json_parser_load_from_data (parser, json, -1, NULL));
+  g_assert_cmpfloat (json_node_get_double (json_parser_get_root (parser)), ==,
+                     1e20);
+  g_object_unref (parser);
+  g_free (json);
+}
+
+static void
+check_msgpack_get_list_cb (const gchar *method,
+                           MeloJSONRPCSchema *s_params, JsonNode *params,
+                           MeloJSONWriter *result, JsonNode **error,
+                           gpointer user_data)
+{
+  MeloTags *tags = user_data;
+  MeloJSONWriter *items;
+
+  /* Write items with a separate writer, as the browser does */
+  items = melo_json_writer_new_full (result->format);
+  melo_json_writer_begin_array (items);
+  melo_json_writer_begin_object (items);
+  melo_json_writer_member (items, "id");
+  melo_json_writer_string (items, "song.mp3");
+  melo_json_writer_member (items, "name");
+  melo_json_writer_string (items, "Title");
+  melo_json_writer_member (items, "type");
+  melo_json_writer_string (items, "file");
+  melo_json_writer_member (items, "tags");
+  melo_tags_write_json (tags, items, MELO_TAGS_FIELDS_FULL);
+  melo_json_writer_end_object (items);
+  melo_json_writer_end_array (items);
+
+  /* Write list */
+  melo_json_writer_begin_object (result);
+  melo_json_writer_member (result, "path");
+  melo_json_writer_string (result, "/");
+  melo_json_writer_member (result, "count");
+  melo_json_writer_int (result, 1);
+  melo_json_writer_member (result, "prev_token");
+  melo_json_writer_string (result, NULL);
+  melo_json_writer_member (result, "next_token");
+  melo_json_writer_string (result, NULL);
+  melo_json_writer_member (result, "items");
+  melo_json_writer_raw (result, items->str->str, items->str->len);
+  melo_json_writer_end_object (result);
+  melo_json_writer_free (items, TRUE);
+}
+
+static void
+check_msgpack_round_trip (void)
+{
+  MeloJSONRPCMethod method = {
+    .method = "get_list",
+    .params = "[{\"name\": \"path\", \"type\": \"string\"}]",
+    .result = "{\"type\":\"object\"}",
+    .write_callback = check_msgpack_get_list_cb,
+  };
+  MeloJSONWriter *writer;
+  MeloTags *tags;
+  JsonNode *req, *res;
+  GBytes *msgpack;
+  const guint8 *data;
+  gchar *json, *cover;
+  gsize len;
+
+  /* Create tags with a cover */
+  tags = melo_tags_new ();
+  tags->title = g_strdup ("Title");
+  tags->track = 300;
+  tags->date = -1;
+  melo_tags_take_cover (tags, g_bytes_new_static (check_cover,
+                                                  sizeof (check_cover)),
+                        "image/png");
+  method.user_data = tags;
+  g_assert_cmpuint (melo_jsonrpc_register_methods ("library", &method, 1), ==,
+                    1);
+
+  /* Get response in MessagePack */
+  req = melo_httpd_msgpack_decode (check_get_list, sizeof (check_get_list));
+  g_assert_nonnull (req);
+  writer = melo_json_writer_new_full (MELO_JSON_WRITER_FORMAT_MSGPACK);
+  g_assert_true (melo_jsonrpc_parse_request_node (req, writer));
+  msgpack = melo_json_writer_free_to_bytes (writer);
+
+  /* Get same response in JSON */
+  writer = melo_json_writer_new ();
+  g_assert_true (melo_jsonrpc_parse_request_node (req, writer));
+  json = melo_json_writer_free (writer, FALSE);
+  json_node_free (req);
+
+  /* Cover is sent as raw binary data */
+  g_assert_true (check_msgpack_has_cover (msgpack));
+
+  /* Decoded response is the JSON response, with cover in base64 */
+  data = g_bytes_get_data (msgpack, &len);
+  res = melo_httpd_msgpack_decode (data, len);
+  g_assert_nonnull (res);
+  writer = melo_json_writer_new ();
+  melo_json_writer_node (writer, res);
+  g_assert_cmpstr (writer->str->str, ==, json);
+  melo_json_writer_free (writer, TRUE);
+  json_node_free (res);
+
+  /* Check cover content */
+  cover = g_base64_encode (check_cover, sizeof (check_cover));
+  g_assert_nonnull (strstr (json, cover));
+  g_free (cover);
+
+  melo_jsonrpc_unregister_methods ("library", &method, 1);
+  melo_tags_unref (tags);
+  g_bytes_unref (msgpack);
+  g_free (json);
+}
+
+static void
+check_msgpack_get_tags (void)
+{
+  static const gchar request[] =
+    "{\"jsonrpc\":\"2.0\",\"method\":\"browser.get_tags\","
+    "\"params\":{\"id\":\"check\",\"path\":\"/a\"},\"id\":1}";
+  MeloJSONWriter *writer;
+  MeloBrowser *bro;
+  JsonParser *parser;
+  JsonObject *obj;
+  JsonNode *res;
+  GBytes *msgpack;
+  const guint8 *data;
+  gchar *cover;
+  gsize len;
+
+  /* Register browser methods with a browser */
+  melo_browser_jsonrpc_register_methods ();
+  bro = melo_browser_new (check_browser_get_type (), "check");
+  g_assert_nonnull (bro);
+
+  /* Get response in MessagePack */
+  parser = json_parser_new ();
+  g_assert_true (json_parser_load_from_data (parser, request, -1, NULL));
+  writer = melo_json_writer_new_full (MELO_JSON_WRITER_FORMAT_MSGPACK);
+  g_assert_true (melo_jsonrpc_parse_request_node (json_parser_get_root (parser),
+                                                  writer));
+  msgpack = melo_json_writer_free_to_bytes (writer);
+  g_object_unref (parser);
+
+  /* Cover is sent as raw binary data */
+  g_assert_true (check_msgpack_has_cover (msgpack));
+
+  /* Check decoded tags */
+  data = g_bytes_get_data (msgpack, &len);
+  res = melo_httpd_msgpack_decode (data, len);
+  g_assert_nonnull (res);
+  obj = json_node_get_object (res);
+  g_assert_true (json_object_has_member (obj, "result"));
+  obj = json_object_get_object_member (obj, "result");
+  g_assert_cmpstr (json_object_get_string_member (obj, "title"), ==, "/a");
+  g_assert_cmpstr (json_object_get_string_member (obj, "cover_type"), ==,
+                   "image/png");
+  cover = g_base64_encode (check_cover, sizeof (check_cover));
+  g_assert_cmpstr (json_object_get_string_member (obj, "cover"), ==, cover);
+  g_free (cover);
+  json_node_free (res);
+
+  melo_browser_jsonrpc_unregister_methods ();
+  g_object_unref (bro);
+  g_bytes_unref (msgpack);
+}
+
+static void
+check_msgpack_parse_error (void)
+{
+  MeloJSONWriter *writer;
+  JsonObject *obj;
+  JsonNode *res;
+  GBytes *bytes;
+  const guint8 *data;
+  gsize len;
+
+  /* Invalid document is answered with a parse error in MessagePack */
+  writer = melo_json_writer_new_full (MELO_JSON_WRITER_FORMAT_MSGPACK);
+  g_assert_true (melo_jsonrpc_parse_request_node (NULL, writer));
+  bytes = melo_json_writer_free_to_bytes (writer);
+  data = g_bytes_get_data (bytes, &len);
+  res = melo_httpd_msgpack_decode (data, len);
+  g_assert_nonnull (res);
+
+  /* Check error code */
+  obj = json_node_get_object (res);
+  g_assert_true (json_object_has_member (obj, "error"));
+  obj = json_object_get_object_member (obj, "error");
+  g_assert_cmpint (json_object_get_int_member (obj, "code"), ==,
+                   MELO_JSONRPC_ERROR_PARSE_ERROR);
+  json_node_free (res);
+  g_bytes_unref (bytes);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/msgpack/truncated", check_msgpack_truncated);
+  g_test_add_func ("/msgpack/oversized", check_msgpack_oversized);
+  g_test_add_func ("/msgpack/depth", check_msgpack_depth);
+  g_test_add_func ("/msgpack/keys", check_msgpack_keys);
+  g_test_add_func ("/msgpack/floats", check_msgpack_floats);
+  g_test_add_func ("/msgpack/round_trip", check_msgpack_round_trip);
+  g_test_add_func ("/msgpack/get_tags", check_msgpack_get_tags);
+  g_test_add_func ("/msgpack/parse_error", check_msgpack_parse_error);
+
+  return g_test_run ();
+}
@@ -0,0 +1,457 @@
+/*
+ * check_tags_file.c: Tests of native tag reader of File module
+ *
+ * Copyright (C) 2016 Alexandre Dilly <dillya@sparod.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "melo_tags_file.h"
+
+/* MPEG-1 layer III frame header: 128 kbps, 44100 Hz, joint stereo */
+static const guint8 check_mpeg_frame[] = { 0xff, 0xfb, 0x90, 0x64 };
+
+/* ADTS AAC frame header: sync word with layer 0 */
+static const guint8 check_adts_frame[] = {
+  0xff, 0xf1, 0x50, 0x80, 0x02, 0x1f, 0xfc
+};
+
+/* ID3v2.3 tag with a TIT2 frame set to "Title" */
+static const guint8 check_id3_title[] = {
+  'I', 'D', '3', 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10,
+  'T', 'I', 'T', '2', 0x00, 0x00, 0x00, 0x06, 0x00, 0x00,
+  0x00, 'T', 'i', 't', 'l', 'e'
+};
+
+/* ID3v2.3 tag without frames */
+static const guint8 check_id3_empty[] = {
+  'I', 'D', '3', 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* ID3v2.3 tag with a size larger than file */
+static const guint8 check_id3_truncated[] = {
+  'I', 'D', '3', 0x03, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x7f,
+  'T', 'I', 'T', '2'
+};
+
+/* ID3v2.3 tag with a frame larger than tag */
+static const guint8 check_id3_bad_frame[] = {
+  'I', 'D', '3', 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10,
+  'T', 'I', 'T', '2', 0x00, 0x00, 0x00, 0xff, 0x00, 0x00,
+  0x00, 'T', 'i', 't', 'l', 'e'
+};
+
+/* ID3v2.4 unsynchronised tag with a TIT2 frame and an APIC frame: APIC size
+ * is a syncsafe 129 and its JPEG data contains an unsynchronisation byte
+ */
+static const guint8 check_id3v24[10 + 16 + 10 + 129] = {
+  'I', 'D', '3', 0x04, 0x00, 0x80, 0x00, 0x00, 0x01, 0x1b,
+  'T', 'I', 'T', '2', 0x00, 0x00, 0x00, 0x06, 0x00, 0x00,
+  0x03, 'T', 'i', 't', 'l', 'e',
+  'A', 'P', 'I', 'C', 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,
+  0x00, 'i', 'm', 'a', 'g', 'e', '/', 'j', 'p', 'e', 'g', 0x00, 0x03, 0x00,
+  0xff, 0xd8, 0xff, 0x00, 0xe0
+};
+
+/* FLAC stream info: 44100 Hz, stereo, 16 bits and 88200 samples */
+static const guint8 check_flac_streaminfo[34] = {
+  0x10, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x0a, 0xc4, 0x42, 0xf0, 0x00, 0x01, 0x58, 0x88
+};
+
+/* FLAC picture block: front cover with JPEG data */
+static const guint8 check_flac_picture[] = {
+  0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x0a,
+  'i', 'm', 'a', 'g', 'e', '/', 'j', 'p', 'e', 'g',
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04,
+  0xff, 0xd8, 0xff, 0xe0
+};
+
+/* Vorbis identification header: stereo, 44100 Hz */
+static const guint8 check_vorbis_head[] = {
+  0x01, 'v', 'o', 'r', 'b', 'i', 's', 0x00, 0x00, 0x00, 0x00, 0x02,
+  0x44, 0xac, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xb8, 0x01
+};
+
+/* Opus identification header: stereo, 312 samples of pre-skip, 48000 Hz */
+static const guint8 check_opus_head[] = {
+  'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 0x01, 0x02, 0x38, 0x01,
+  0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* MP4 file: 2 seconds long movie, with title, track and cover items */
+static const guint8 check_mp4[] = {
+  0x00, 0x00, 0x00, 0x10, 'f', 't', 'y', 'p', 'M', '4', 'A', ' ',
+  0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xa5, 'm', 'o', 'o', 'v',
+  0x00, 0x00, 0x00, 0x28, 'm', 'v', 'h', 'd', 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xe8,
+  0x00, 0x00, 0x07, 0xd0, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x75, 'u', 'd', 't', 'a',
+  0x00, 0x00, 0x00, 0x6d, 'm', 'e', 't', 'a', 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x61, 'i', 'l', 's', 't',
+  0x00, 0x00, 0x00, 0x1d, 0xa9, 'n', 'a', 'm',
+  0x00, 0x00, 0x00, 0x15, 'd', 'a', 't', 'a', 0x00, 0x00, 0x00, 0x01,
+  0x00, 0x00, 0x00, 0x00, 'T', 'i', 't', 'l', 'e',
+  0x00, 0x00, 0x00, 0x20, 't', 'r', 'k', 'n',
+  0x00, 0x00, 0x00, 0x18, 'd', 'a', 't', 'a', 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x0c, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x1c, 'c', 'o', 'v', 'r',
+  0x00, 0x00, 0x00, 0x14, 'd', 'a', 't', 'a', 0x00, 0x00, 0x00, 0x0d,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0xd8, 0xff, 0xe0
+};
+
+static MeloTags *
+check_tags_file_read (const guint8 *head, gsize head_len, const guint8 *data,
+                      gsize data_len, gsize size)
+{
+  GByteArray *array;
+  MeloTags *tags;
+  gchar *filename;
+  gint fd;
+
+  /* Generate file content: padded with zeros up to size */
+  array = g_byte_array_new ();
+  if (head)
+    g_byte_array_append (array, head, head_len);
+  if (data)
+    g_byte_array_append (array, data, data_len);
+  if (array->len < size) {
+    guint len = array->len;
+
+    g_byte_array_set_size (array, size);
+    memset (array->data + len, 0, size - len);
+  }
+
+  /* Write temporary file */
+  fd = g_file_open_tmp ("check_tags_file_XXXXXX", &filename, NULL);
+  g_assert_cmpint (fd, >=, 0);
+  g_assert_cmpint (write (fd, array->data, array->len), ==, array->len);
+  close (fd);
+  g_byte_array_unref (array);
+
+  /* Read tags */
+  tags = melo_tags_file_read (filename, MELO_TAGS_FIELDS_FULL);
+  g_unlink (filename);
+  g_free (filename);
+
+  return tags;
+}
+
+static void
+check_tags_file_append_le32 (GByteArray *array, guint32 value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (array, (const guint8 *) &value, 4);
+}
+
+static void
+check_tags_file_append_comment (GByteArray *array, const gchar *comment)
+{
+  check_tags_file_append_le32 (array, strlen (comment));
+  g_byte_array_append (array, (const guint8 *) comment, strlen (comment));
+}
+
+static void
+check_tags_file_append_comments (GByteArray *array, gboolean picture)
+{
+  gchar *pic, *comment;
+
+  /* Empty vendor string, title and artist */
+  check_tags_file_append_le32 (array, 0);
+  check_tags_file_append_le32 (array, picture ? 3 : 2);
+  check_tags_file_append_comment (array, "TITLE=Title");
+  check_tags_file_append_comment (array, "ARTIST=Artist");
+
+  /* Cover is a FLAC picture block encoded in base64 */
+  if (picture) {
+    pic = g_base64_encode (check_flac_picture, sizeof (check_flac_picture));
+    comment = g_strconcat ("METADATA_BLOCK_PICTURE=", pic, NULL);
+    check_tags_file_append_comment (array, comment);
+    g_free (comment);
+    g_free (pic);
+  }
+}
+
+static void
+check_tags_file_append_flac_block (GByteArray *array, guint8 type,
+                                   const guint8 *data, gsize len)
+{
+  guint8 hdr[4];
+
+  /* Block header: type with last flag and 24-bits length */
+  hdr[0] = type;
+  hdr[1] = len >> 16;
+  hdr[2] = len >> 8;
+  hdr[3] = len;
+  g_byte_array_append (array, hdr, sizeof (hdr));
+  g_byte_array_append (array, data, len);
+}
+
+static void
+check_tags_file_append_ogg_page (GByteArray *array, guint8 type,
+                                 guint64 granule, guint8 seq,
+                                 const guint8 *packet, guint8 len)
+{
+  guint8 hdr[28] = { 'O', 'g', 'g', 'S' };
+
+  /* Page header with a single segment: CRC is not checked by reader */
+  granule = GUINT64_TO_LE (granule);
+  hdr[5] = type;
+  memcpy (hdr + 6, &granule, 8);
+  hdr[14] = 0x34;
+  hdr[15] = 0x12;
+  hdr[18] = seq;
+  hdr[26] = 1;
+  hdr[27] = len;
+  g_byte_array_append (array, hdr, sizeof (hdr));
+  if (len)
+    g_byte_array_append (array, packet, len);
+}
+
+static MeloTags *
+check_tags_file_read_ogg (const guint8 *head, gsize head_len,
+                          const gchar *magic, gsize magic_len,
+                          guint64 granule)
+{
+  GByteArray *array, *packet;
+  MeloTags *tags;
+
+  /* Comment header: Vorbis packet ends with a framing bit */
+  packet = g_byte_array_new ();
+  g_byte_array_append (packet, (const guint8 *) magic, magic_len);
+  check_tags_file_append_comments (packet, TRUE);
+  if (magic[0] == 0x03)
+    g_byte_array_append (packet, (const guint8 *) "\x01", 1);
+
+  /* Identification, comment and last audio pages */
+  array = g_byte_array_new ();
+  check_tags_file_append_ogg_page (array, 0x02, 0, 0, head, head_len);
+  check_tags_file_append_ogg_page (array, 0x00, 0, 1, packet->data,
+                                   packet->len);
+  check_tags_file_append_ogg_page (array, 0x04, granule, 2, NULL, 0);
+  g_byte_array_unref (packet);
+
+  /* Read tags */
+  tags = check_tags_file_read (NULL, 0, array->data, array->len, 0);
+  g_byte_array_unref (array);
+
+  return tags;
+}
+
+static void
+check_tags_file_cover (MeloTags *tags)
+{
+  gchar *type = NULL;
+  GBytes *cover;
+
+  /* Cover is the JPEG image of fixture */
+  cover = melo_tags_get_cover (tags, &type);
+  g_assert_nonnull (cover);
+  g_assert_cmpstr (type, ==, "image/jpeg");
+  g_assert_cmpuint (g_bytes_get_size (cover), >=, 4);
+  g_assert (!memcmp (g_bytes_get_data (cover, NULL), "\xff\xd8\xff\xe0", 4));
+  g_bytes_unref (cover);
+  g_free (type);
+}
+
+static void
+check_tags_file_mpeg (void)
+{
+  MeloTags *tags;
+
+  /* Stream details are read from first frame */
+  tags = check_tags_file_read (NULL, 0, check_mpeg_frame,
+                               sizeof (check_mpeg_frame), 4096);
+  g_assert_nonnull (tags);
+  g_assert_cmpuint (tags->samplerate, ==, 44100);
+  g_assert_cmpuint (tags->channels, ==, 2);
+  g_assert_cmpuint (tags->bitrate, ==, 128000);
+  melo_tags_unref (tags);
+
+  /* ID3v2 frames are read before audio data */
+  tags = check_tags_file_read (check_id3_title, sizeof (check_id3_title),
+                               check_mpeg_frame, sizeof (check_mpeg_frame),
+                               4096);
+  g_assert_nonnull (tags);
+  g_assert_cmpstr (tags->title, ==, "Title");
+  g_assert_cmpuint (tags->samplerate, ==, 44100);
+  melo_tags_unref (tags);
+}
+
+static void
+check_tags_file_id3v24 (void)
+{
+  MeloTags *tags;
+
+  /* Syncsafe frame sizes and unsynchronisation are handled per frame */
+  tags = check_tags_file_read (check_id3v24, sizeof (check_id3v24),
+                               check_mpeg_frame, sizeof (check_mpeg_frame),
+                               sizeof (check_id3v24) + 16000);
+  g_assert_nonnull (tags);
+  g_assert_cmpstr (tags->title, ==, "Title");
+  g_assert_cmpint (tags->duration, ==, 1000);
+  check_tags_file_cover (tags);
+  melo_tags_unref (tags);
+}
+
+static void
+check_tags_file_flac (void)
+{
+  GByteArray *array, *comments;
+  MeloTags *tags;
+
+  /* Stream info, Vorbis comments and picture blocks */
+  comments = g_byte_array_new ();
+  check_tags_file_append_comments (comments, FALSE);
+  array = g_byte_array_new ();
+  g_byte_array_append (array, (const guint8 *) "fLaC", 4);
+  check_tags_file_append_flac_block (array, 0, check_flac_streaminfo,
+                                     sizeof (check_flac_streaminfo));
+  check_tags_file_append_flac_block (array, 4, comments->data,
+                                     comments->len);
+  check_tags_file_append_flac_block (array, 0x80 | 6, check_flac_picture,
+                                     sizeof (check_flac_picture));
+  g_byte_array_unref (comments);
+
+  tags = check_tags_file_read (NULL, 0, array->data, array->len, 4096);
+  g_byte_array_unref (array);
+  g_assert_nonnull (tags);
+  g_assert_cmpstr (tags->title, ==, "Title");
+  g_assert_cmpstr (tags->artist, ==, "Artist");
+  g_assert_cmpint (tags->duration, ==, 2000);
+  g_assert_cmpuint (tags->samplerate, ==, 44100);
+  g_assert_cmpuint (tags->channels, ==, 2);
+  check_tags_file_cover (tags);
+  melo_tags_unref (tags);
+}
+
+static void
+check_tags_file_ogg (void)
+{
+  MeloTags *tags;
+
+  /* Ogg Vorbis: duration from granule position of last page */
+  tags = check_tags_file_read_ogg (check_vorbis_head,
+                                   sizeof (check_vorbis_head), "\x03vorbis",
+                                   7, 88200);
+  g_assert_nonnull (tags);
+  g_assert_cmpstr (tags->title, ==, "Title");
+  g_assert_cmpstr (tags->artist, ==, "Artist");
+  g_assert_cmpint (tags->duration, ==, 2000);
+  g_assert_cmpuint (tags->samplerate, ==, 44100);
+  g_assert_cmpuint (tags->channels, ==, 2);
+  check_tags_file_cover (tags);
+  melo_tags_unref (tags);
+
+  /* Ogg Opus: granule position is at 48kHz and includes pre-skip */
+  tags = check_tags_file_read_ogg (check_opus_head, sizeof (check_opus_head),
+                                   "OpusTags", 8, 96000 + 312);
+  g_assert_nonnull (tags);
+  g_assert_cmpstr (tags->title, ==, "Title");
+  g_assert_cmpstr (tags->artist, ==, "Artist");
+  g_assert_cmpint (tags->duration, ==, 2000);
+  g_assert_cmpuint (tags->samplerate, ==, 48000);
+  g_assert_cmpuint (tags->channels, ==, 2);
+  check_tags_file_cover (tags);
+  melo_tags_unref (tags);
+}
+
+static void
+check_tags_file_mp4 (void)
+{
+  MeloTags *tags;
+
+  /* Duration from movie header and items from moov.udta.meta.ilst */
+  tags = check_tags_file_read (NULL, 0, check_mp4, sizeof (check_mp4), 4096);
+  g_assert_nonnull (tags);
+  g_assert_cmpstr (tags->title, ==, "Title");
+  g_assert_cmpuint (tags->track, ==, 3);
+  g_assert_cmpuint (tags->tracks, ==, 12);
+  g_assert_cmpint (tags->duration, ==, 2000);
+  check_tags_file_cover (tags);
+  melo_tags_unref (tags);
+}
+
+static void
+check_tags_file_truncated (void)
+{
+  /* File shorter than a header */
+  g_assert_null (check_tags_file_read (NULL, 0, check_mpeg_frame, 2, 0));
+
+  /* Sync word without a valid frame header */
+  g_assert_null (check_tags_file_read (NULL, 0, check_mpeg_frame, 2, 64));
+
+  /* ID3v2 tag larger than file, without audio data */
+  g_assert_null (check_tags_file_read (check_id3_truncated,
+                                       sizeof (check_id3_truncated), NULL, 0,
+                                       0));
+}
+
+static void
+check_tags_file_misidentified (void)
+{
+  MeloTags *tags;
+
+  /* ADTS AAC is not MPEG audio */
+  g_assert_null (check_tags_file_read (NULL, 0, check_adts_frame,
+                                       sizeof (check_adts_frame), 64));
+
+  /* ADTS AAC after an empty ID3v2 tag */
+  g_assert_null (check_tags_file_read (check_id3_empty,
+                                       sizeof (check_id3_empty),
+                                       check_adts_frame,
+                                       sizeof (check_adts_frame), 64));
+
+  /* Other format after an empty ID3v2 tag */
+  g_assert_null (check_tags_file_read (check_id3_empty,
+                                       sizeof (check_id3_empty),
+                                       (const guint8 *) "RIFF", 4, 64));
+
+  /* ID3v2 frame larger than tag is skipped */
+  tags = check_tags_file_read (check_id3_bad_frame,
+                               sizeof (check_id3_bad_frame),
+                               check_mpeg_frame, sizeof (check_mpeg_frame),
+                               4096);
+  g_assert_nonnull (tags);
+  g_assert_null (tags->title);
+  g_assert_cmpuint (tags->samplerate, ==, 44100);
+  melo_tags_unref (tags);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/tags_file/mpeg", check_tags_file_mpeg);
+  g_test_add_func ("/tags_file/id3v24", check_tags_file_id3v24);
+  g_test_add_func ("/tags_file/flac", check_tags_file_flac);
+  g_test_add_func ("/tags_file/ogg", check_tags_file_ogg);
+  g_test_add_func ("/tags_file/mp4", check_tags_file_mp4);
+  g_test_add_func ("/tags_file/truncated", check_tags_file_truncated);
+  g_test_add_func ("/tags_file/misidentified", check_tags_file_misidentified);
+
+  return g_test_run ();
+}